@@ -6,41 +6,43 @@ extern int yylineno;
 
 namespace ast {
 
-    Node::Node() : line(yylineno) {}
+    Node::Node(Kind kind) : line(yylineno), kind(kind) {}
 
-    Num::Num(const char *str) : Exp(), value(std::stoi(str)) {}
+    Num::Num(const char *str) : Node(KIND), Exp(), value(std::stoi(str)) {}
 
-    NumB::NumB(const char *str) : Exp(), value(std::stoi(str)) {}
+    NumB::NumB(const char *str) : Node(KIND), Exp(), value(std::stoi(str)) {}
 
-    String::String(const char *str) : Exp(), value(str) {
+    String::String(const char *str) : Node(KIND), Exp(), value(str) {
         // Remove the quotes
         value = value.substr(1, value.size() - 2);
     }
 
-    Bool::Bool(bool value) : Exp(), value(value) {}
+    Bool::Bool(bool value) : Node(KIND), Exp(), value(value) {}
 
-    ID::ID(const char *str) : Exp(), value(str) {}
+    ID::ID(const char *str) : Node(KIND), Exp(), value(str) {}
 
     BinOp::BinOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, BinOpType op)
-            : Exp(), left(std::move(left)), right(std::move(right)), op(op) {}
+            : Node(KIND), Exp(), left(std::move(left)), right(std::move(right)), op(op) {}
 
     RelOp::RelOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, RelOpType op)
-            : Exp(), left(std::move(left)), right(std::move(right)), op(op) {}
+            : Node(KIND), Exp(), left(std::move(left)), right(std::move(right)), op(op) {}
 
-    Type::Type(BuiltInType type) : Node(), type(type) {}
+    Type::Type(BuiltInType type) : Node(KIND), type(type) {}
 
     Cast::Cast(std::shared_ptr<Exp> exp, std::shared_ptr<Type> target_type)
-            : Exp(), exp(std::move(exp)), target_type(std::move(target_type)) {}
+            : Node(KIND), Exp(), exp(std::move(exp)), target_type(std::move(target_type)) {}
 
-    Not::Not(std::shared_ptr<Exp> exp) : Exp(), exp(std::move(exp)) {}
+    Not::Not(std::shared_ptr<Exp> exp) : Node(KIND), Exp(), exp(std::move(exp)) {}
 
     And::And(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right)
-            : Exp(), left(std::move(left)), right(std::move(right)) {}
+            : Node(KIND), Exp(), left(std::move(left)), right(std::move(right)) {}
 
     Or::Or(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right)
-            : Exp(), left(std::move(left)), right(std::move(right)) {}
+            : Node(KIND), Exp(), left(std::move(left)), right(std::move(right)) {}
 
-    ExpList::ExpList(std::shared_ptr<Exp> exp) : Node(), exps({std::move(exp)}) {}
+    ExpList::ExpList() : Node(KIND) {}
+
+    ExpList::ExpList(std::shared_ptr<Exp> exp) : Node(KIND), exps({std::move(exp)}) {}
 
     void ExpList::push_front(const std::shared_ptr<Exp> &exp) {
         exps.insert(exps.begin(), exp);
@@ -51,12 +53,14 @@ namespace ast {
     }
 
     Call::Call(std::shared_ptr<ID> func_id, std::shared_ptr<ExpList> args)
-            : Exp(), func_id(std::move(func_id)), args(std::move(args)) {}
+            : Node(KIND), Exp(), func_id(std::move(func_id)), args(std::move(args)) {}
 
     Call::Call(std::shared_ptr<ID> func_id)
-            : Exp(), func_id(std::move(func_id)), args(std::make_shared<ExpList>()) {}
+            : Node(KIND), Exp(), func_id(std::move(func_id)), args(std::make_shared<ExpList>()) {}
+
+    Statements::Statements() : Node(KIND), Statement() {}
 
-    Statements::Statements(std::shared_ptr<Statement> statement) : Statement(), statements({std::move(statement)}) {}
+    Statements::Statements(std::shared_ptr<Statement> statement) : Node(KIND), Statement(), statements({std::move(statement)}) {}
 
     void Statements::push_front(const std::shared_ptr<Statement> &statement) {
         statements.insert(statements.begin(), statement);
@@ -66,25 +70,31 @@ namespace ast {
         statements.push_back(statement);
     }
 
-    Return::Return(std::shared_ptr<Exp> exp) : Statement(), exp(std::move(exp)) {}
+    Break::Break() : Node(KIND), Statement() {}
+
+    Continue::Continue() : Node(KIND), Statement() {}
+
+    Return::Return(std::shared_ptr<Exp> exp) : Node(KIND), Statement(), exp(std::move(exp)) {}
 
     If::If(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> then, std::shared_ptr<Statement> otherwise)
-            : Statement(), condition(std::move(condition)), then(std::move(then)), otherwise(std::move(otherwise)) {}
+            : Node(KIND), Statement(), condition(std::move(condition)), then(std::move(then)), otherwise(std::move(otherwise)) {}
 
     While::While(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> body)
-            : Statement(), condition(std::move(condition)),
+            : Node(KIND), Statement(), condition(std::move(condition)),
               body(std::move(body)) {}
 
     VarDecl::VarDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> type, std::shared_ptr<Exp> init_exp)
-            : Statement(), id(std::move(std::move(id))), type(std::move(type)), init_exp(std::move(init_exp)) {}
+            : Node(KIND), Statement(), id(std::move(std::move(id))), type(std::move(type)), init_exp(std::move(init_exp)) {}
 
     Assign::Assign(std::shared_ptr<ID> id, std::shared_ptr<Exp> exp)
-            : Statement(), id(std::move(id)), exp(std::move(exp)) {}
+            : Node(KIND), Statement(), id(std::move(id)), exp(std::move(exp)) {}
 
     Formal::Formal(std::shared_ptr<ID> id, std::shared_ptr<Type> type)
-            : Node(), id(std::move(id)), type(std::move(type)) {}
+            : Node(KIND), id(std::move(id)), type(std::move(type)) {}
+
+    Formals::Formals() : Node(KIND) {}
 
-    Formals::Formals(std::shared_ptr<Formal> formal) : Node(), formals({std::move(formal)}) {}
+    Formals::Formals(std::shared_ptr<Formal> formal) : Node(KIND), formals({std::move(formal)}) {}
 
     void Formals::push_front(const std::shared_ptr<Formal> &formal) {
         formals.insert(formals.begin(), formal);
@@ -96,10 +106,12 @@ namespace ast {
 
     FuncDecl::FuncDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> return_type, std::shared_ptr<Formals> formals,
                        std::shared_ptr<Statements> body)
-            : Node(), id(std::move(id)), return_type(std::move(return_type)), formals(std::move(formals)),
+            : Node(KIND), id(std::move(id)), return_type(std::move(return_type)), formals(std::move(formals)),
               body(std::move(body)) {}
 
-    Funcs::Funcs(std::shared_ptr<FuncDecl> func) : Node(), funcs({std::move(func)}) {}
+    Funcs::Funcs() : Node(KIND) {}
+
+    Funcs::Funcs(std::shared_ptr<FuncDecl> func) : Node(KIND), funcs({std::move(func)}) {}
 
     void Funcs::push_front(const std::shared_ptr<FuncDecl> &func) {
         funcs.insert(funcs.begin(), func);
@@ -105,11 +105,11 @@ namespace output {
         print_indented("BinOp: " + op);
 
         enter_child();
-        node.left->accept(*this);
+        dispatch(*node.left);
         leave_child();
 
         enter_last_child();
-        node.right->accept(*this);
+        dispatch(*node.right);
         leave_child();
     }
 
@@ -140,12 +140,12 @@ namespace output {
         print_indented("RelOp: " + op);
 
         enter_child();
-        node.left->accept(*this);
+        dispatch(*node.left);
         leave_child();
 
 
         enter_last_child();
-        node.right->accept(*this);
+        dispatch(*node.right);
         leave_child();
     }
 
@@ -157,11 +157,11 @@ namespace output {
         print_indented("Cast");
 
         enter_child();
-        node.exp->accept(*this);
+        dispatch(*node.exp);
         leave_child();
 
         enter_last_child();
-        node.target_type->accept(*this);
+        dispatch(*node.target_type);
         leave_child();
     }
 
@@ -169,7 +169,7 @@ namespace output {
         print_indented("Not");
 
         enter_last_child();
-        node.exp->accept(*this);
+        dispatch(*node.exp);
         leave_child();
     }
 
@@ -177,11 +177,11 @@ namespace output {
         print_indented("And");
 
         enter_child();
-        node.left->accept(*this);
+        dispatch(*node.left);
         leave_child();
 
         enter_last_child();
-        node.right->accept(*this);
+        dispatch(*node.right);
         leave_child();
     }
 
@@ -189,11 +189,11 @@ namespace output {
         print_indented("Or");
 
         enter_child();
-        node.left->accept(*this);
+        dispatch(*node.left);
         leave_child();
 
         enter_last_child();
-        node.right->accept(*this);
+        dispatch(*node.right);
         leave_child();
     }
 
@@ -206,7 +206,7 @@ namespace output {
             } else {
                 enter_last_child();
             }
-            (*it)->accept(*this);
+            dispatch(**it);
             leave_child();
         }
     }
@@ -215,11 +215,11 @@ namespace output {
         print_indented("Call");
 
         enter_child();
-        node.func_id->accept(*this);
+        dispatch(*node.func_id);
         leave_child();
 
         enter_last_child();
-        node.args->accept(*this);
+        dispatch(*node.args);
         leave_child();
     }
 
@@ -232,7 +232,7 @@ namespace output {
             } else {
                 enter_last_child();
             }
-            (*it)->accept(*this);
+            dispatch(**it);
             leave_child();
         }
     }
@@ -250,7 +250,7 @@ namespace output {
 
         if (node.exp) {
             enter_last_child();
-            node.exp->accept(*this);
+            dispatch(*node.exp);
             leave_child();
         }
     }
@@ -259,7 +259,7 @@ namespace output {
         print_indented("If");
 
         enter_child();
-        node.condition->accept(*this);
+        dispatch(*node.condition);
         leave_child();
 
         if (node.otherwise) {
@@ -267,12 +267,12 @@ namespace output {
         } else {
             enter_last_child();
         }
-        node.then->accept(*this);
+        dispatch(*node.then);
         leave_child();
 
         if (node.otherwise) {
             enter_last_child();
-            node.otherwise->accept(*this);
+            dispatch(*node.otherwise);
             leave_child();
         }
     }
@@ -281,11 +281,11 @@ namespace output {
         print_indented("While");
 
         enter_child();
-        node.condition->accept(*this);
+        dispatch(*node.condition);
         leave_child();
 
         enter_last_child();
-        node.body->accept(*this);
+        dispatch(*node.body);
         leave_child();
     }
 
@@ -293,7 +293,7 @@ namespace output {
         print_indented("VarDecl");
 
         enter_child();
-        node.id->accept(*this);
+        dispatch(*node.id);
         leave_child();
 
         if (node.init_exp) {
@@ -301,12 +301,12 @@ namespace output {
         } else {
             enter_last_child();
         }
-        node.type->accept(*this);
+        dispatch(*node.type);
         leave_child();
 
         if (node.init_exp) {
             enter_last_child();
-            node.init_exp->accept(*this);
+            dispatch(*node.init_exp);
             leave_child();
         }
     }
@@ -315,11 +315,11 @@ namespace output {
         print_indented("Assign");
 
         enter_child();
-        node.id->accept(*this);
+        dispatch(*node.id);
         leave_child();
 
         enter_last_child();
-        node.exp->accept(*this);
+        dispatch(*node.exp);
         leave_child();
     }
 
@@ -327,11 +327,11 @@ namespace output {
         print_indented("Formal");
 
         enter_child();
-        node.id->accept(*this);
+        dispatch(*node.id);
         leave_child();
 
         enter_last_child();
-        node.type->accept(*this);
+        dispatch(*node.type);
         leave_child();
     }
 
@@ -344,7 +344,7 @@ namespace output {
             } else {
                 enter_last_child();
             }
-            (*it)->accept(*this);
+            dispatch(**it);
             leave_child();
         }
     }
@@ -353,19 +353,19 @@ namespace output {
         print_indented("FuncDecl");
 
         enter_child();
-        node.id->accept(*this);
+        dispatch(*node.id);
         leave_child();
 
         enter_child();
-        node.return_type->accept(*this);
+        dispatch(*node.return_type);
         leave_child();
 
         enter_child();
-        node.formals->accept(*this);
+        dispatch(*node.formals);
         leave_child();
 
         enter_last_child();
-        node.body->accept(*this);
+        dispatch(*node.body);
         leave_child();
     }
 
@@ -378,7 +378,7 @@ namespace output {
             } else {
                 enter_last_child();
             }
-            (*it)->accept(*this);
+            dispatch(**it);
             leave_child();
         }
     }
@@ -17,7 +17,7 @@ namespace output {
     /* PrintVisitor class
      * This class is used to print the AST in a human-readable format.
      */
-    class PrintVisitor : public Visitor {
+    class PrintVisitor final : public Visitor, public ast::StaticVisitor<PrintVisitor> {
     private:
         std::vector<std::string> indents;
         std::vector<std::string> prefixes;
@@ -1,6 +1,7 @@
 #ifndef NODES_HPP
 #define NODES_HPP
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <vector>
@@ -35,14 +36,49 @@ namespace ast {
         STRING
     };
 
+    /* Kinds of nodes, one for each class below. A node knows its kind, so it can be told apart from the
+     * others (and visited) with a switch, without RTTI or a virtual call.
+     */
+    enum class Kind : uint8_t {
+        Num,
+        NumB,
+        String,
+        Bool,
+        ID,
+        BinOp,
+        RelOp,
+        Not,
+        And,
+        Or,
+        Type,
+        Cast,
+        ExpList,
+        Call,
+        Statements,
+        Break,
+        Continue,
+        Return,
+        If,
+        While,
+        VarDecl,
+        Assign,
+        Formal,
+        Formals,
+        FuncDecl,
+        Funcs
+    };
+
     /* Base class for all AST nodes */
     class Node {
     public:
         // Line number in the source code
         int line;
 
+        // Kind of the node, the class it is an object of
+        const Kind kind;
+
         // Use this constructor only while parsing in bison or flex
-        Node();
+        explicit Node(Kind kind);
 
         // Accept method for visitor pattern
         virtual void accept(Visitor &visitor) = 0;
@@ -50,17 +86,22 @@ namespace ast {
 
     /* Base class for all expressions */
     class Exp : virtual public Node {
-    public:
-        Exp() = default;
+    protected:
+        // Node is a virtual base, so the class of the node initializes it
+        Exp() {}
     };
 
     /* Base class for all statements */
     class Statement : virtual public Node {
+    protected:
+        Statement() {}
     };
 
     /* Number literal */
     class Num : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Num;
+
         // Value of the number
         int value;
 
@@ -75,6 +116,8 @@ namespace ast {
     /* Byte literal */
     class NumB : public Exp {
     public:
+        static constexpr Kind KIND = Kind::NumB;
+
         // Value of the number
         int value;
 
@@ -89,6 +132,8 @@ namespace ast {
     /* String literal */
     class String : public Exp {
     public:
+        static constexpr Kind KIND = Kind::String;
+
         // Value of the string
         std::string value;
 
@@ -103,6 +148,8 @@ namespace ast {
     /* Boolean literal */
     class Bool : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Bool;
+
         // Value of the boolean
         bool value;
 
@@ -117,6 +164,8 @@ namespace ast {
     /* Identifier */
     class ID : public Exp {
     public:
+        static constexpr Kind KIND = Kind::ID;
+
         // Name of the identifier
         std::string value;
 
@@ -131,6 +180,8 @@ namespace ast {
     /* Binary arithmetic operation */
     class BinOp : public Exp {
     public:
+        static constexpr Kind KIND = Kind::BinOp;
+
         // Left operand
         std::shared_ptr<Exp> left;
         // Right operand
@@ -149,6 +200,8 @@ namespace ast {
     /* Binary relational operation */
     class RelOp : public Exp {
     public:
+        static constexpr Kind KIND = Kind::RelOp;
+
         // Left operand
         std::shared_ptr<Exp> left;
         // Right operand
@@ -167,6 +220,8 @@ namespace ast {
     /* Unary logical NOT operation */
     class Not : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Not;
+
         // Operand
         std::shared_ptr<Exp> exp;
 
@@ -181,6 +236,8 @@ namespace ast {
     /* Binary logical AND operation */
     class And : public Exp {
     public:
+        static constexpr Kind KIND = Kind::And;
+
         // Left operand
         std::shared_ptr<Exp> left;
         // Right operand
@@ -197,6 +254,8 @@ namespace ast {
     /* Binary logical OR operation */
     class Or : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Or;
+
         // Left operand
         std::shared_ptr<Exp> left;
         // Right operand
@@ -213,6 +272,8 @@ namespace ast {
     /* Type symbol */
     class Type : public Node {
     public:
+        static constexpr Kind KIND = Kind::Type;
+
         // Type
         BuiltInType type;
 
@@ -227,6 +288,8 @@ namespace ast {
     /* Type cast */
     class Cast : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Cast;
+
         // Expression to be cast
         std::shared_ptr<Exp> exp;
         // Target type
@@ -243,11 +306,13 @@ namespace ast {
     /* List of expressions */
     class ExpList : public Node {
     public:
+        static constexpr Kind KIND = Kind::ExpList;
+
         // List of expressions
         std::vector<std::shared_ptr<Exp>> exps;
 
         // Constructor that receives no expressions
-        ExpList() = default;
+        ExpList();
 
         // Constructor that receives the first expression
         explicit ExpList(std::shared_ptr<Exp> exp);
@@ -266,6 +331,8 @@ namespace ast {
     /* Function call */
     class Call : public Exp, public Statement {
     public:
+        static constexpr Kind KIND = Kind::Call;
+
         // Function identifier
         std::shared_ptr<ID> func_id;
         // List of arguments as expressions
@@ -285,11 +352,13 @@ namespace ast {
     /* List of statements */
     class Statements : public Statement {
     public:
+        static constexpr Kind KIND = Kind::Statements;
+
         // List of statements
         std::vector<std::shared_ptr<Statement>> statements;
 
         // Constructor that receives no statements
-        Statements() = default;
+        Statements();
 
         // Constructor that receives the first statement
         explicit Statements(std::shared_ptr<Statement> statement);
@@ -307,6 +376,11 @@ namespace ast {
 
     /* Break statement */
     class Break : public Statement {
+    public:
+        static constexpr Kind KIND = Kind::Break;
+
+        Break();
+
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
@@ -314,6 +388,11 @@ namespace ast {
 
     /* Continue statement */
     class Continue : public Statement {
+    public:
+        static constexpr Kind KIND = Kind::Continue;
+
+        Continue();
+
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
@@ -322,6 +401,8 @@ namespace ast {
     /* Return statement */
     class Return : public Statement {
     public:
+        static constexpr Kind KIND = Kind::Return;
+
         // Expression to be returned. If the return is expressionless, this field is nullptr
         std::shared_ptr<Exp> exp;
 
@@ -336,6 +417,8 @@ namespace ast {
     /* If statement */
     class If : public Statement {
     public:
+        static constexpr Kind KIND = Kind::If;
+
         // Condition expression
         std::shared_ptr<Exp> condition;
         // Statement to be executed if the condition is true
@@ -355,6 +438,8 @@ namespace ast {
     /* While statement */
     class While : public Statement {
     public:
+        static constexpr Kind KIND = Kind::While;
+
         // Condition expression
         std::shared_ptr<Exp> condition;
         // Statement to be executed while the condition is true
@@ -371,6 +456,8 @@ namespace ast {
     /* Variable declaration */
     class VarDecl : public Statement {
     public:
+        static constexpr Kind KIND = Kind::VarDecl;
+
         // Identifier of the variable
         std::shared_ptr<ID> id;
         // Type of the variable
@@ -389,6 +476,8 @@ namespace ast {
     /* Assignment statement */
     class Assign : public Statement {
     public:
+        static constexpr Kind KIND = Kind::Assign;
+
         // Identifier of the variable
         std::shared_ptr<ID> id;
         // Expression to be assigned
@@ -405,6 +494,8 @@ namespace ast {
     /* Formal parameter */
     class Formal : public Node {
     public:
+        static constexpr Kind KIND = Kind::Formal;
+
         // Identifier of the parameter
         std::shared_ptr<ID> id;
         // Type of the parameter
@@ -421,11 +512,13 @@ namespace ast {
     /* List of formal parameters */
     class Formals : public Node {
     public:
+        static constexpr Kind KIND = Kind::Formals;
+
         // List of formal parameters
         std::vector<std::shared_ptr<Formal>> formals;
 
         // Constructor that receives no parameters
-        Formals() = default;
+        Formals();
 
         // Constructor that receives the first formal parameter
         explicit Formals(std::shared_ptr<Formal> formal);
@@ -444,6 +537,8 @@ namespace ast {
     /* Function declaration */
     class FuncDecl : public Node {
     public:
+        static constexpr Kind KIND = Kind::FuncDecl;
+
         // Identifier of the function
         std::shared_ptr<ID> id;
         // Return type of the function
@@ -465,11 +560,13 @@ namespace ast {
     /* List of function declarations */
     class Funcs : public Node {
     public:
+        static constexpr Kind KIND = Kind::Funcs;
+
         // List of function declarations
         std::vector<std::shared_ptr<FuncDecl>> funcs;
 
         // Constructor that receives no function declarations
-        Funcs() = default;
+        Funcs();
 
         // Constructor that receives the first function declaration
         explicit Funcs(std::shared_ptr<FuncDecl> func);
@@ -484,6 +581,83 @@ namespace ast {
             visitor.visit(*this);
         }
     };
+
+    /* StaticVisitor class
+     * Visits the nodes without virtual calls: an expression or a statement is dispatched with a switch
+     * on its kind (one indexed jump), and any other node by its class. Derived has a visit() for each
+     * class of nodes it meets, and is final, so that those calls are direct too.
+     * Exp and Statement are virtual bases, which a Node can not be cast down from without RTTI, so a
+     * node is dispatched from the most derived of them that is known.
+     */
+    template<typename Derived>
+    class StaticVisitor {
+    public:
+        template<typename T>
+        void dispatch(T &node) {
+            derived().visit(node);
+        }
+
+        void dispatch(Exp &exp) {
+            switch (exp.kind) {
+                case Kind::Num:
+                    return derived().visit(static_cast<Num &>(exp));
+                case Kind::NumB:
+                    return derived().visit(static_cast<NumB &>(exp));
+                case Kind::String:
+                    return derived().visit(static_cast<String &>(exp));
+                case Kind::Bool:
+                    return derived().visit(static_cast<Bool &>(exp));
+                case Kind::ID:
+                    return derived().visit(static_cast<ID &>(exp));
+                case Kind::BinOp:
+                    return derived().visit(static_cast<BinOp &>(exp));
+                case Kind::RelOp:
+                    return derived().visit(static_cast<RelOp &>(exp));
+                case Kind::Not:
+                    return derived().visit(static_cast<Not &>(exp));
+                case Kind::And:
+                    return derived().visit(static_cast<And &>(exp));
+                case Kind::Or:
+                    return derived().visit(static_cast<Or &>(exp));
+                case Kind::Cast:
+                    return derived().visit(static_cast<Cast &>(exp));
+                case Kind::Call:
+                    return derived().visit(static_cast<Call &>(exp));
+                default:
+                    return;
+            }
+        }
+
+        void dispatch(Statement &statement) {
+            switch (statement.kind) {
+                case Kind::Call:
+                    return derived().visit(static_cast<Call &>(statement));
+                case Kind::Statements:
+                    return derived().visit(static_cast<Statements &>(statement));
+                case Kind::Break:
+                    return derived().visit(static_cast<Break &>(statement));
+                case Kind::Continue:
+                    return derived().visit(static_cast<Continue &>(statement));
+                case Kind::Return:
+                    return derived().visit(static_cast<Return &>(statement));
+                case Kind::If:
+                    return derived().visit(static_cast<If &>(statement));
+                case Kind::While:
+                    return derived().visit(static_cast<While &>(statement));
+                case Kind::VarDecl:
+                    return derived().visit(static_cast<VarDecl &>(statement));
+                case Kind::Assign:
+                    return derived().visit(static_cast<Assign &>(statement));
+                default:
+                    return;
+            }
+        }
+
+    private:
+        Derived &derived() {
+            return static_cast<Derived &>(*this);
+        }
+    };
 }
 
 #define YYSTYPE std::shared_ptr<ast::Node>
@@ -176,12 +176,12 @@ namespace output {
     void MyVisitor::visit(ast::If& node){
         begin_scope(table_stack.top(), false);
         
-        node.condition->accept(*this);
+        dispatch(*node.condition);
         // Check if condition isn't bool
         if (this->last_type != ast::BuiltInType::BOOL)
             errorMismatch(node.condition->line);
 
-        node.then->accept(*this);
+        dispatch(*node.then);
         // Removing from scope stack
         end_scope();
 
@@ -190,38 +190,38 @@ namespace output {
         if (node.otherwise){
             begin_scope(table_stack.top(), false);
             is_func_body = true;
-            node.otherwise->accept(*this);
+            dispatch(*node.otherwise);
             is_func_body = false;
             end_scope();
         }
     }
 
     void MyVisitor::visit(ast::Or &node) {
-        node.left->accept(*this);
+        dispatch(*node.left);
         if (this->last_type != ast::BuiltInType::BOOL) {
             errorMismatch(node.line);
         }
 
-        node.right->accept(*this);
+        dispatch(*node.right);
         if (this->last_type != ast::BuiltInType::BOOL) {
             errorMismatch(node.line);
         }
     }
 
     void MyVisitor::visit(ast::And &node) {
-        node.left->accept(*this);
+        dispatch(*node.left);
         if (this->last_type != ast::BuiltInType::BOOL) {
             errorMismatch(node.line);
         }
 
-        node.right->accept(*this);
+        dispatch(*node.right);
         if (this->last_type != ast::BuiltInType::BOOL) {
             errorMismatch(node.line);
         }
     }
 
     void MyVisitor::visit(ast::Not &node) {
-        node.exp->accept(*this);
+        dispatch(*node.exp);
 
         // TODO: Type of not is always boolean?
         if (this->last_type != ast::BuiltInType::BOOL) {
@@ -257,7 +257,7 @@ namespace output {
 
         // Check argument types
         for (size_t i = 0; i < args.size(); i++){
-            args[i]->accept(*this);
+            dispatch(*args[i]);
             ast::BuiltInType arg_type = last_type;
             ast::BuiltInType expected = expected_types[i];
 
@@ -279,10 +279,10 @@ namespace output {
     }
 
     void MyVisitor::visit(ast::Cast& node){
-        node.exp->accept(*this);
+        dispatch(*node.exp);
         ast::BuiltInType exp_type = last_type;
 
-        node.target_type->accept(*this);
+        dispatch(*node.target_type);
         ast::BuiltInType target_type = last_type;
 
         if (!is_numeric_type(exp_type) || !is_numeric_type(target_type))
@@ -304,10 +304,10 @@ namespace output {
     void MyVisitor::visit(ast::BinOp &node) {
         ast::BuiltInType left, right;
 
-        node.left->accept(*this);
+        dispatch(*node.left);
         left = this->last_type;
 
-        node.right->accept(*this);
+        dispatch(*node.right);
         right = this->last_type;
 
         bool isLeftNum = (left == ast::BuiltInType::INT || left == ast::BuiltInType::BYTE);
@@ -365,7 +365,7 @@ namespace output {
 
         for (const auto& func : node.funcs){
             last_func_id = func->id->value;
-            func->accept(*this);
+            dispatch(*func);
         }
 
         table_stack.pop();
@@ -375,10 +375,10 @@ namespace output {
     void MyVisitor::visit(ast::RelOp& node){
         ast::BuiltInType left, right;
 
-        node.left->accept(*this);
+        dispatch(*node.left);
         left = last_type;
 
-        node.right->accept(*this);
+        dispatch(*node.right);
         right = last_type;
 
         if (!is_numeric_type(left) || !is_numeric_type(right)) {
@@ -391,7 +391,7 @@ namespace output {
     void MyVisitor::visit(ast::While& node){
         begin_scope(table_stack.top(), false);
 
-        node.condition->accept(*this);
+        dispatch(*node.condition);
         // Check if condition isn't bool
         if (this->last_type != ast::BuiltInType::BOOL)
             errorMismatch(node.condition->line);
@@ -399,7 +399,7 @@ namespace output {
         //TODO: do we need to do check if (table_stack.top() == nullptr)?
         begin_scope(table_stack.top(), true);
         is_func_body = true;
-        node.body->accept(*this);
+        dispatch(*node.body);
         is_func_body = false;
 
         end_scope();
@@ -407,10 +407,10 @@ namespace output {
     }
 
     void MyVisitor::visit(ast::Assign &node) {
-        node.id->accept(*this);
+        dispatch(*node.id);
         ast::BuiltInType id_type = this->last_type;
 
-        node.exp->accept(*this);
+        dispatch(*node.exp);
         ast::BuiltInType exp_type = this->last_type;
 
         if (id_type != exp_type){
@@ -440,7 +440,7 @@ namespace output {
         if (node.exp == nullptr)
             last_type = ast::BuiltInType::VOID;
         else
-            node.exp->accept(*this);
+            dispatch(*node.exp);
 
         if (return_type != last_type && !(last_type == ast::BuiltInType::BYTE && return_type == ast::BuiltInType::INT))
             errorMismatch(node.line);
@@ -460,7 +460,7 @@ namespace output {
 
         size_t i = 0;
         for (; i < node.exps.size(); i++){
-            node.exps[i]->accept(*this);
+            dispatch(*node.exps[i]);
             if (i >= types.size() || types[i] != last_type || (types[i] == ast::BuiltInType::STRING && last_func_id != "print"))
                 errorPrototypeMismatch(node.line, last_func_id, str_types);
         }
@@ -473,7 +473,7 @@ namespace output {
 
         for (const auto& formal : node.formals){
             arg_offset--;
-            formal->accept(*this);
+            dispatch(*formal);
         }
 
         arg_offset = 0;
@@ -488,7 +488,7 @@ namespace output {
             errorDef(node.line, node.id->value);
         
         if (node.init_exp != nullptr){
-            node.init_exp->accept(*this);
+            dispatch(*node.init_exp);
             ast::BuiltInType init_type = last_type;
 
             if (init_type != node.type->type){
@@ -521,9 +521,9 @@ namespace output {
 
         return_type = node.return_type->type;
 
-        node.return_type->accept(*this);
-        node.formals->accept(*this);
-        node.body->accept(*this);
+        dispatch(*node.return_type);
+        dispatch(*node.formals);
+        dispatch(*node.body);
 
         end_scope();
     }
@@ -536,7 +536,7 @@ namespace output {
 
         is_func_body = false;
         for (const auto& stmt : node.statements)
-            stmt->accept(*this);
+            dispatch(*stmt);
 
         if (clean)
             end_scope();
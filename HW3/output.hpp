@@ -66,7 +66,7 @@ namespace output{
         friend std::ostream &operator<<(std::ostream &os, const ScopePrinter &printer);
     };
 
-    class MyVisitor : public Visitor {
+    class MyVisitor final : public Visitor, public ast::StaticVisitor<MyVisitor> {
     private:
         struct SymbolData {
             std::string name;
@@ -69,7 +69,7 @@ Program:  Funcs { program = dynamic_pointer_cast<ast::Funcs>($1); }
 
 // TODO: Define grammar here
 Funcs: /* empty */ { $$ = make_shared<ast::Funcs>(); }
-    | FuncDecl Funcs { $$ = dynamic_pointer_cast<ast::Funcs>($2); dynamic_pointer_cast<ast::Funcs>($$)->push_front(dynamic_pointer_cast<ast::FuncDecl>($1)); }
+    | Funcs FuncDecl { $$ = dynamic_pointer_cast<ast::Funcs>($1); dynamic_pointer_cast<ast::Funcs>($$)->push_back(dynamic_pointer_cast<ast::FuncDecl>($2)); }
 ;
 
 FuncDecl: RetType ID LPAREN Formals RPAREN LBRACE Statements RBRACE
@@ -85,7 +85,7 @@ Formals: /* empty */ { $$ = make_shared<ast::Formals>(); }
 ;
 
 FormalsList: FormalDecl { $$ = make_shared<ast::Formals>(dynamic_pointer_cast<ast::Formal>($1)); }
-    | FormalDecl COMMA FormalsList { $$ = dynamic_pointer_cast<ast::Formals>($3); dynamic_pointer_cast<ast::Formals>($$)->push_front(dynamic_pointer_cast<ast::Formal>($1)); }
+    | FormalsList COMMA FormalDecl { $$ = dynamic_pointer_cast<ast::Formals>($1); dynamic_pointer_cast<ast::Formals>($$)->push_back(dynamic_pointer_cast<ast::Formal>($3)); }
 ;
 
 FormalDecl: Type ID { $$ = make_shared<ast::Formal>(dynamic_pointer_cast<ast::ID>($2), dynamic_pointer_cast<ast::Type>($1)); }
@@ -114,7 +114,7 @@ Call: ID LPAREN ExpList RPAREN { $$ = make_shared<ast::Call>(dynamic_pointer_cas
 ;
 
 ExpList: Exp { $$ = make_shared<ast::ExpList>(dynamic_pointer_cast<ast::Exp>($1)); }
-    | Exp COMMA ExpList { $$ = dynamic_pointer_cast<ast::ExpList>($3); dynamic_pointer_cast<ast::ExpList>($$)->push_front(dynamic_pointer_cast<ast::Exp>($1)); }
+    | ExpList COMMA Exp { $$ = dynamic_pointer_cast<ast::ExpList>($1); dynamic_pointer_cast<ast::ExpList>($$)->push_back(dynamic_pointer_cast<ast::Exp>($3)); }
 ;
 
 Type: INT { $$ = make_shared<ast::Type>(ast::BuiltInType::INT);; }
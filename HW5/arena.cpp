@@ -0,0 +1,40 @@
+#include "arena.hpp"
+#include <algorithm>
+#include <cstdint>
+
+namespace ast {
+
+    Arena::~Arena() {
+        for (Finalizer *finalizer = finalizers; finalizer != nullptr; finalizer = finalizer->next)
+            finalizer->destroy(finalizer->object);
+    }
+
+    void Arena::rewind(const Mark &mark) {
+        for (; finalizers != mark.finalizers; finalizers = finalizers->next)
+            finalizers->destroy(finalizers->object);
+        blocks.resize(mark.blocks);
+        next = mark.next;
+        end = mark.end;
+        objects = mark.objects;
+        reserved = mark.reserved;
+    }
+
+    static uintptr_t align_up(uintptr_t address, size_t align) {
+        return (address + align - 1) & ~static_cast<uintptr_t>(align - 1);
+    }
+
+    void *Arena::allocate(size_t size, size_t align) {
+        uintptr_t address = align_up(reinterpret_cast<uintptr_t>(next), align);
+        if (next == nullptr || address + size > reinterpret_cast<uintptr_t>(end)) {
+            // The rest of the current block is left unused
+            size_t block_size = std::max(BLOCK_SIZE, size + align);
+            blocks.emplace_back(new char[block_size]);
+            reserved += block_size;
+            next = blocks.back().get();
+            end = next + block_size;
+            address = align_up(reinterpret_cast<uintptr_t>(next), align);
+        }
+        next = reinterpret_cast<char *>(address + size);
+        return reinterpret_cast<void *>(address);
+    }
+}
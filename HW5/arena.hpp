@@ -0,0 +1,92 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ast {
+
+    /* Arena class
+     * Bump allocator for the objects of one compilation: objects are placed one after the other in
+     * big blocks, and are never freed one by one - they all go away together with the arena.
+     * Only objects that own memory themselves (e.g. a string) have their destructor called.
+     */
+    class Arena {
+        struct Finalizer;
+
+    public:
+        static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+        /* Position in the arena, to later drop everything made after it with rewind() */
+        struct Mark {
+            size_t blocks;
+            char *next;
+            char *end;
+            Finalizer *finalizers;
+            size_t objects;
+            size_t reserved;
+        };
+
+        Arena() = default;
+
+        Arena(const Arena &) = delete;
+
+        Arena &operator=(const Arena &) = delete;
+
+        ~Arena();
+
+        // Constructs an object in the arena. The arena owns it, the pointer is valid as long as the arena is.
+        template<typename T, typename... Args>
+        T *make(Args &&... args) {
+            T *object = new(allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if constexpr (!std::is_trivially_destructible<T>::value) {
+                finalizers = new(allocate(sizeof(Finalizer), alignof(Finalizer)))
+                        Finalizer{[](void *p) { static_cast<T *>(p)->~T(); }, object, finalizers};
+            }
+            objects++;
+            return object;
+        }
+
+        // Number of objects constructed in the arena
+        size_t size() const {
+            return objects;
+        }
+
+        // Bytes of the blocks of the arena
+        size_t capacity() const {
+            return reserved;
+        }
+
+        Mark mark() const {
+            return {blocks.size(), next, end, finalizers, objects, reserved};
+        }
+
+        // Destroys the objects made after the mark, and frees the blocks allocated after it
+        void rewind(const Mark &mark);
+
+    private:
+        /* Destructor to call when the arena is destroyed */
+        struct Finalizer {
+            void (*destroy)(void *);
+            void *object;
+            Finalizer *next;
+        };
+
+        std::vector<std::unique_ptr<char[]>> blocks;
+        // Free part of the last block
+        char *next = nullptr;
+        char *end = nullptr;
+        // Last registered finalizer, they run in the opposite order of construction
+        Finalizer *finalizers = nullptr;
+        size_t objects = 0;
+        size_t reserved = 0;
+
+        void *allocate(size_t size, size_t align);
+    };
+}
+
+#endif //ARENA_HPP
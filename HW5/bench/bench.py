@@ -0,0 +1,98 @@
+"""
+Measures the compiler on large synthetic FanC programs: wall time and peak memory (max RSS).
+
+Usage:
+    python3 bench/bench.py [--funcs N] [--stmts M] [--runs R] [--same-output] COMPILER [COMPILER ...]
+
+Each COMPILER is a path to an hw5 binary, optionally followed by flags (e.g. "./hw5 --ssa").
+Every compiler gets the same program, and its output is written to a file like in real use.
+Whatever a compiler prints to stderr in the last run (e.g. with --stats) is shown after its results.
+With --same-output the benchmark fails unless every compiler wrote exactly the same output, e.g. to check
+that "./hw5 --threads 8" generates the same code as "./hw5".
+"""
+import argparse
+import hashlib
+import os
+import shlex
+import subprocess
+import tempfile
+import time
+
+
+def generate_program(funcs, stmts):
+    """A program of `funcs` functions with about `stmts` statements each, that calls all of them"""
+    lines = []
+    for f in range(funcs):
+        lines.append(f"int f{f}(int a, byte b) {{")
+        lines.append("    int x = a;")
+        lines.append("    byte y = b;")
+        for s in range(stmts):
+            kind = s % 4
+            if kind == 0:
+                lines.append(f"    x = x * {s % 7 + 1} + a / (b + 1b) - {s};")
+            elif kind == 1:
+                lines.append(f"    if (x > {s} and y < 200b) {{ y = y + 1b; }} else {{ x = x - 1; }}")
+            elif kind == 2:
+                lines.append(f"    while (y > {s % 100}b) {{ y = y - 1b; if (y == 3b) break; }}")
+            else:
+                lines.append(f"    print(\"function {f} statement {s}\");")
+        lines.append("    return x + y;")
+        lines.append("}")
+    lines.append("void main() {")
+    for f in range(funcs):
+        lines.append(f"    printi(f{f}({f}, 5b));")
+    lines.append("}")
+    return "\n".join(lines) + "\n"
+
+
+def measure(command, source_path, output_path, stderr_path):
+    """Runs the command once, returns (seconds, max RSS in KiB)"""
+    with open(source_path) as source, open(output_path, "w") as output, open(stderr_path, "w") as stderr:
+        start = time.perf_counter()
+        process = subprocess.Popen(command, stdin=source, stdout=output, stderr=stderr)
+        _, status, usage = os.wait4(process.pid, 0)
+        elapsed = time.perf_counter() - start
+    if status != 0:
+        raise RuntimeError(f"{' '.join(command)} failed with status {status}")
+    return elapsed, usage.ru_maxrss
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--funcs", type=int, default=2000)
+    parser.add_argument("--stmts", type=int, default=40)
+    parser.add_argument("--runs", type=int, default=3)
+    parser.add_argument("--same-output", action="store_true")
+    parser.add_argument("compilers", nargs="+")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        source_path = os.path.join(tmp, "program.fanc")
+        output_path = os.path.join(tmp, "program.ll")
+        stderr_path = os.path.join(tmp, "stderr.txt")
+        with open(source_path, "w") as source:
+            source.write(generate_program(args.funcs, args.stmts))
+        print(f"program: {args.funcs} functions x {args.stmts} statements, "
+              f"{os.path.getsize(source_path) // 1024} KiB")
+
+        digests = set()
+        for compiler in args.compilers:
+            command = shlex.split(compiler)
+            results = [measure(command, source_path, output_path, stderr_path) for _ in range(args.runs)]
+            best_time = min(r[0] for r in results)
+            peak_rss = max(r[1] for r in results)
+            output_size = os.path.getsize(output_path) // 1024
+            print(f"{compiler}: {best_time:.3f} s (best of {args.runs}), peak RSS {peak_rss / 1024:.1f} MiB, "
+                  f"output {output_size} KiB")
+            with open(stderr_path) as stderr:
+                for line in stderr:
+                    print(f"    {line.rstrip()}")
+            with open(output_path, "rb") as output:
+                digests.add(hashlib.sha256(output.read()).hexdigest())
+
+        if args.same_output and len(digests) > 1:
+            raise SystemExit("the compilers wrote different output")
+
+
+if __name__ == "__main__":
+    main()
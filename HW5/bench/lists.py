@@ -0,0 +1,81 @@
+"""
+Measures how the parse time of the compiler grows with the length of the lists in the grammar: the
+functions of a program, the formals of a function and the arguments of a call. Each list is parsed at
+doubling lengths; if building a list is linear, the time per element stays about the same as it grows.
+
+Usage:
+    python3 bench/lists.py [--max N] [--steps S] [--runs R] COMPILER [COMPILER ...]
+
+Each COMPILER is a path to an hw5 binary, optionally followed by flags (e.g. "./hw5 --ssa"). It runs with
+--check --stats, and the parse time it reports is used, so code generation does not hide the parser.
+"""
+import argparse
+import os
+import re
+import shlex
+import subprocess
+import tempfile
+
+
+def functions(n):
+    """A program of n functions"""
+    lines = [f"int f{f}(int a) {{ return a + {f}; }}" for f in range(n)]
+    lines.append("void main() { printi(f0(1)); }")
+    return "\n".join(lines) + "\n"
+
+
+def formals(n):
+    """A function of n formals"""
+    params = ", ".join(f"int a{i}" for i in range(n))
+    return f"int f({params}) {{ return a0; }}\nvoid main() {{ printi(1); }}\n"
+
+
+def arguments(n):
+    """A function of n formals, called with n arguments"""
+    params = ", ".join(f"int a{i}" for i in range(n))
+    args = ", ".join(str(i) for i in range(n))
+    return f"int f({params}) {{ return a0; }}\nvoid main() {{ printi(f({args})); }}\n"
+
+
+SHAPES = {"functions": functions, "formals": formals, "arguments": arguments}
+
+
+def parse_time(command, source_path):
+    """Runs the command once, returns the parse time it reports in milliseconds"""
+    with open(source_path) as source:
+        process = subprocess.run(command + ["--check", "--stats"], stdin=source, capture_output=True, text=True)
+    if process.returncode != 0 or process.stdout:
+        raise RuntimeError(f"{' '.join(command)} failed: {process.stdout.strip()}")
+    match = re.search(r"^parse: \d+ nodes in ([\d.]+) ms", process.stderr, re.MULTILINE)
+    if match is None:
+        raise RuntimeError(f"{' '.join(command)} reported no parse time")
+    return float(match.group(1))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--max", type=int, default=100000, help="longest list")
+    parser.add_argument("--steps", type=int, default=5, help="number of lengths, halving from --max")
+    parser.add_argument("--runs", type=int, default=3)
+    parser.add_argument("compilers", nargs="+")
+    args = parser.parse_args()
+
+    lengths = [args.max >> step for step in reversed(range(args.steps))]
+    with tempfile.TemporaryDirectory() as tmp:
+        source_path = os.path.join(tmp, "program.fanc")
+        for compiler in args.compilers:
+            command = shlex.split(compiler)
+            print(f"{compiler}:")
+            for shape, generate in SHAPES.items():
+                previous = None
+                for n in lengths:
+                    with open(source_path, "w") as source:
+                        source.write(generate(n))
+                    best = min(parse_time(command, source_path) for _ in range(args.runs))
+                    growth = f"x{best / previous:.2f}" if previous else ""
+                    print(f"    {shape:<10} {n:>8}  {best:10.2f} ms  {best * 1e6 / n:8.1f} ns/element  {growth}")
+                    previous = best
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,322 @@
+/* Measures the dispatch of the AST visitors: walks a synthetic tree of about a million nodes with
+ * virtual accept() calls, as Visitor does, and with a switch on the kind of the node, as StaticVisitor
+ * does. Both walks run the same visit functions and must count the same nodes.
+ *
+ * Usage:
+ *     make traverse && bench/traverse [NODES] [RUNS]
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include "../arena.hpp"
+#include "../flat_ast.hpp"
+
+using namespace ast;
+
+namespace {
+
+    /* Builds a random program of at least the given number of nodes, with every kind of node in it */
+    class Generator {
+    public:
+        explicit Generator(FlatTree &tree) : tree(tree) {}
+
+        NodeId program(size_t nodes) {
+            NodeId funcs = tree.list(Kind::Funcs);
+            while (tree.size() < nodes)
+                tree.push_back(funcs, func());
+            return funcs;
+        }
+
+    private:
+        FlatTree &tree;
+        uint32_t seed = 12345;
+
+        uint32_t random(uint32_t n) {
+            seed = seed * 1103515245 + 12345;
+            return (seed >> 16) % n;
+        }
+
+        NodeId id() {
+            return tree.node(Kind::ID, random(16));
+        }
+
+        NodeId type() {
+            return tree.node(Kind::Type, NoNode, NoNode, static_cast<uint8_t>(INT));
+        }
+
+        NodeId exp(int depth) {
+            if (depth == 0)
+                return random(2) ? id() : tree.literal(Kind::Num, static_cast<int>(random(100)));
+            switch (random(10)) {
+                case 0:
+                    return tree.literal(Kind::NumB, static_cast<int>(random(100)));
+                case 1:
+                    return tree.literal(Kind::Bool, static_cast<int>(random(2)));
+                case 2:
+                    return tree.node(Kind::RelOp, exp(depth - 1), exp(depth - 1), static_cast<uint8_t>(LT));
+                case 3:
+                    return tree.node(Kind::Not, exp(depth - 1));
+                case 4:
+                    return tree.node(Kind::And, exp(depth - 1), exp(depth - 1));
+                case 5:
+                    return tree.node(Kind::Or, exp(depth - 1), exp(depth - 1));
+                case 6:
+                    return tree.node(Kind::Cast, exp(depth - 1), type());
+                case 7: {
+                    NodeId args = tree.list(Kind::ExpList);
+                    tree.push_back(args, exp(depth - 1));
+                    return tree.node(Kind::Call, id(), args);
+                }
+                default:
+                    return tree.node(Kind::BinOp, exp(depth - 1), exp(depth - 1), static_cast<uint8_t>(random(4)));
+            }
+        }
+
+        NodeId statement(int depth) {
+            switch (depth == 0 ? random(4) : random(8)) {
+                case 0:
+                    return tree.node(Kind::Assign, id(), exp(3));
+                case 1:
+                    return tree.node(Kind::VarDecl, id(), {type(), exp(3)});
+                case 2: {
+                    NodeId args = tree.list(Kind::ExpList);
+                    tree.push_back(args, tree.string("\"text\""));
+                    return tree.node(Kind::Call, id(), args);
+                }
+                case 3:
+                    return tree.node(Kind::Return, exp(2));
+                case 4:
+                    return tree.node(Kind::If, exp(2), {statement(depth - 1), statement(depth - 1)});
+                case 5: {
+                    NodeId body = tree.list(Kind::Statements);
+                    tree.push_back(body, statement(depth - 1));
+                    tree.push_back(body, tree.node(random(2) ? Kind::Break : Kind::Continue));
+                    return tree.node(Kind::While, exp(2), body);
+                }
+                default:
+                    return statements(depth - 1, 3);
+            }
+        }
+
+        NodeId statements(int depth, int count) {
+            NodeId list = tree.list(Kind::Statements);
+            for (int i = 0; i < count; i++)
+                tree.push_back(list, statement(depth));
+            return list;
+        }
+
+        NodeId func() {
+            NodeId formals = tree.list(Kind::Formals);
+            for (int i = 0; i < 2; i++)
+                tree.push_back(formals, tree.node(Kind::Formal, id(), type()));
+            return tree.node(Kind::FuncDecl, id(), {type(), formals, statements(3, 100)});
+        }
+    };
+
+    /* Counts the nodes of a tree, and sums its numbers. Goes down to the children through accept() or
+     * through dispatch(), with the same visit functions.
+     */
+    class Counter final : public Visitor, public StaticVisitor<Counter> {
+    public:
+        bool virtual_calls = false;
+        size_t nodes = 0;
+        long sum = 0;
+
+        template<typename T>
+        void child(T *node) {
+            if (node == nullptr)
+                return;
+            if (virtual_calls)
+                node->accept(*this);
+            else
+                dispatch(*node);
+        }
+
+        void visit(Num &node) override {
+            nodes++;
+            sum += node.value;
+        }
+
+        void visit(NumB &node) override {
+            nodes++;
+            sum += node.value;
+        }
+
+        void visit(String &node) override {
+            nodes++;
+        }
+
+        void visit(Bool &node) override {
+            nodes++;
+            sum += node.value;
+        }
+
+        void visit(ID &node) override {
+            nodes++;
+            sum += node.symbol;
+        }
+
+        void visit(BinOp &node) override {
+            nodes++;
+            child(node.left);
+            child(node.right);
+        }
+
+        void visit(RelOp &node) override {
+            nodes++;
+            child(node.left);
+            child(node.right);
+        }
+
+        void visit(Not &node) override {
+            nodes++;
+            child(node.exp);
+        }
+
+        void visit(And &node) override {
+            nodes++;
+            child(node.left);
+            child(node.right);
+        }
+
+        void visit(Or &node) override {
+            nodes++;
+            child(node.left);
+            child(node.right);
+        }
+
+        void visit(Type &node) override {
+            nodes++;
+        }
+
+        void visit(Cast &node) override {
+            nodes++;
+            child(node.exp);
+            child(node.target_type);
+        }
+
+        void visit(ExpList &node) override {
+            nodes++;
+            for (Exp *exp : node.exps)
+                child(exp);
+        }
+
+        void visit(Call &node) override {
+            nodes++;
+            child(node.func_id);
+            child(node.args);
+        }
+
+        void visit(Statements &node) override {
+            nodes++;
+            for (Statement *statement : node.statements)
+                child(statement);
+        }
+
+        void visit(Break &node) override {
+            nodes++;
+        }
+
+        void visit(Continue &node) override {
+            nodes++;
+        }
+
+        void visit(Return &node) override {
+            nodes++;
+            child(node.exp);
+        }
+
+        void visit(If &node) override {
+            nodes++;
+            child(node.condition);
+            child(node.then);
+            child(node.otherwise);
+        }
+
+        void visit(While &node) override {
+            nodes++;
+            child(node.condition);
+            child(node.body);
+        }
+
+        void visit(VarDecl &node) override {
+            nodes++;
+            child(node.id);
+            child(node.type);
+            child(node.init_exp);
+        }
+
+        void visit(Assign &node) override {
+            nodes++;
+            child(node.id);
+            child(node.exp);
+        }
+
+        void visit(Formal &node) override {
+            nodes++;
+            child(node.id);
+            child(node.type);
+        }
+
+        void visit(Formals &node) override {
+            nodes++;
+            for (Formal *formal : node.formals)
+                child(formal);
+        }
+
+        void visit(FuncDecl &node) override {
+            nodes++;
+            child(node.id);
+            child(node.return_type);
+            child(node.formals);
+            child(node.body);
+        }
+
+        void visit(Funcs &node) override {
+            nodes++;
+            for (FuncDecl *func : node.funcs)
+                child(func);
+        }
+    };
+
+    // Best time of the runs in milliseconds, and the counter of the last run
+    double measure(Funcs &program, bool virtual_calls, int runs, Counter &counter) {
+        double best = 1e30;
+        for (int run = 0; run < runs; run++) {
+            counter = Counter();
+            counter.virtual_calls = virtual_calls;
+            auto start = std::chrono::steady_clock::now();
+            counter.visit(program);
+            std::chrono::duration<double, std::milli> time = std::chrono::steady_clock::now() - start;
+            best = std::min(best, time.count());
+        }
+        return best;
+    }
+}
+
+int main(int argc, char *argv[]) {
+    size_t size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    int runs = argc > 2 ? std::atoi(argv[2]) : 10;
+
+    FlatTree tree;
+    tree.root = Generator(tree).program(size);
+    Arena arena;
+    auto *program = static_cast<Funcs *>(tree.expand(tree.root, arena));
+
+    Counter virtual_counter, static_counter;
+    double virtual_time = measure(*program, true, runs, virtual_counter);
+    double static_time = measure(*program, false, runs, static_counter);
+    if (virtual_counter.nodes != tree.size() || static_counter.nodes != tree.size() ||
+        virtual_counter.sum != static_counter.sum) {
+        std::fprintf(stderr, "the walks disagree: %zu and %zu nodes of %zu\n", virtual_counter.nodes,
+                     static_counter.nodes, tree.size());
+        return 1;
+    }
+
+    std::printf("%zu nodes, best of %d runs\n", tree.size(), runs);
+    std::printf("virtual accept    %8.2f ms  %6.2f ns/node\n", virtual_time, virtual_time * 1e6 / tree.size());
+    std::printf("switch dispatch   %8.2f ms  %6.2f ns/node\n", static_time, static_time * 1e6 / tree.size());
+    return 0;
+}
@@ -0,0 +1,49 @@
+#include "compilation.hpp"
+#include "parser.tab.h"
+#include <charconv>
+#include <memory>
+
+// Extern from the flex-generated scanner
+int yylex_init_extra(Compilation *extra, yyscan_t *scanner);
+struct yy_buffer_state *yy_scan_bytes(const char *bytes, int len, yyscan_t scanner);
+void yyset_lineno(int line, yyscan_t scanner);
+int yylex_destroy(yyscan_t scanner);
+
+Compilation::Compilation(const output::Options &options) : options(options) {}
+
+void Compilation::parse(std::string_view source) {
+    yyscan_t scanner;
+    yylex_init_extra(this, &scanner);
+    // Frees the scanner also when an error stops the parser
+    std::unique_ptr<void, int (*)(yyscan_t)> scanner_owner(scanner, yylex_destroy);
+    yy_scan_bytes(source.data(), static_cast<int>(source.size()), scanner);
+    // A buffer scanned from memory does not start counting lines by itself
+    yyset_lineno(1, scanner);
+    yyparse(scanner, tree);
+}
+
+ast::NodeId Compilation::number(ast::Kind kind, std::string_view digits) {
+    int value = 0;
+    if (std::from_chars(digits.data(), digits.data() + digits.size(), value).ec != std::errc()) {
+        if (kind == ast::Kind::NumB)
+            output::errorByteTooLarge(tree.line, std::string(digits));
+        output::errorIntTooLarge(tree.line, std::string(digits));
+    }
+    return tree.literal(kind, value);
+}
+
+void Compilation::check() {
+    sema::analyze(tree, symbols, annotations);
+}
+
+std::string Compilation::generate(int fd) {
+    // The nodes of each function exist only while it is visited
+    ast::Node *program = tree.expand_program(arena);
+    output::MyVisitor visitor(symbols, annotations, options, fd, cache);
+    program->accept(visitor);
+
+    visitor.print_buf();
+    if (options.stats)
+        visitor.print_stats(std::cerr);
+    return visitor.code_str();
+}
@@ -0,0 +1,51 @@
+#ifndef COMPILATION_HPP
+#define COMPILATION_HPP
+
+#include <string>
+#include <string_view>
+#include "flat_ast.hpp"
+#include "output.hpp"
+#include "sema.hpp"
+
+/* Compilation class
+ * Everything one compilation of a program uses: the parser builds the tree, interning the identifiers
+ * in symbols, semantic analysis annotates the tree, and the code generator expands the tree into the
+ * arena to visit it. Compilations share
+ * no state, so any number of them may run at the same time, each on its own thread.
+ */
+class Compilation {
+public:
+    // Identifiers of the program
+    ast::Interner symbols;
+    // The AST built by the parser
+    ast::FlatTree tree;
+    // Types and declarations of the nodes of the tree
+    sema::Annotations annotations;
+    // Nodes expanded from the tree for the visitors
+    ast::Arena arena;
+    output::Options options;
+    // Where the code generator looks up the code of each function, if anywhere
+    fanc::CompileCache *cache = nullptr;
+
+    explicit Compilation(const output::Options &options = output::Options());
+
+    Compilation(const Compilation &) = delete;
+
+    Compilation &operator=(const Compilation &) = delete;
+
+    // Parses the program into the tree. Errors in the program throw output::CompileError.
+    void parse(std::string_view source);
+
+    // Adds the Num or NumB literal of the digits (without the b of a byte), for the scanner. The tree
+    // holds ints, so a literal too large for one is reported right away.
+    ast::NodeId number(ast::Kind kind, std::string_view digits);
+
+    // Checks the parsed program and annotates its tree. Errors in the program throw output::CompileError.
+    void check();
+
+    // Generates the code of the checked program and writes it to the file descriptor, or returns it when
+    // fd is -1
+    std::string generate(int fd = -1);
+};
+
+#endif //COMPILATION_HPP
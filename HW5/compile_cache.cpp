@@ -0,0 +1,354 @@
+#include "compile_cache.hpp"
+#include "fanc.hpp"
+#include "sha256.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <sstream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fanc {
+
+    // An entry is this header, then the code, then the diagnostics
+    static const char HEADER_FORMAT[] = "fanc-cache %llu %llu\n";
+
+    // Temporary files left by a process that died while storing an entry are removed after this long
+    static const time_t STALE_TEMPORARY_SECONDS = 3600;
+
+    static bool write_all(int fd, const char *data, size_t len) {
+        while (len > 0) {
+            ssize_t written = write(fd, data, len);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            data += written;
+            len -= written;
+        }
+        return true;
+    }
+
+    static bool pread_all(int fd, char *data, size_t len, off_t offset) {
+        while (len > 0) {
+            ssize_t got = pread(fd, data, len, offset);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                return false;
+            data += got;
+            len -= got;
+            offset += got;
+        }
+        return true;
+    }
+
+    // Copies len bytes of the file from the offset to the file descriptor, without reading them into memory
+    // when the kernel can do it. copied counts the bytes that reached the file descriptor, also on failure.
+    static bool copy_out(int in, off_t offset, size_t len, int out, size_t &copied) {
+        while (len > 0) {
+            ssize_t sent = sendfile(out, in, &offset, len);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            if (sent <= 0)
+                break;
+            len -= sent;
+            copied += sent;
+        }
+        // sendfile() does not write to every kind of file (e.g. one opened with O_APPEND)
+        char chunk[64 * 1024];
+        while (len > 0) {
+            size_t size = std::min(len, sizeof(chunk));
+            if (!pread_all(in, chunk, size, offset))
+                return false;
+            for (size_t done = 0; done < size;) {
+                ssize_t written = ::write(out, chunk + done, size - done);
+                if (written < 0 && errno == EINTR)
+                    continue;
+                if (written <= 0)
+                    return false;
+                done += written;
+                copied += written;
+            }
+            offset += size;
+            len -= size;
+        }
+        return true;
+    }
+
+    // Where output written to the file descriptor starts in its file, -1 if it is not a regular file
+    static off_t output_start(int fd) {
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+            return -1;
+        // Appending writes go to the end of the file wherever the offset is
+        int flags = fcntl(fd, F_GETFL);
+        return (flags >= 0 && (flags & O_APPEND)) ? st.st_size : lseek(fd, 0, SEEK_CUR);
+    }
+
+    /* An entry file, found by scan() */
+    struct CacheFile {
+        std::string path;
+        struct timespec used;
+        uint64_t size;
+    };
+
+    // The entries of the cache directory, and the total of their sizes. Removes stale temporary files.
+    static std::vector<CacheFile> scan(const std::string &dir, uint64_t &total) {
+        std::vector<CacheFile> files;
+        total = 0;
+        std::error_code error;
+        time_t now = time(nullptr);
+        for (const auto &subdir : std::filesystem::directory_iterator(dir, error)) {
+            if (!subdir.is_directory(error))
+                continue;
+            for (const auto &file : std::filesystem::directory_iterator(subdir.path(), error)) {
+                std::string path = file.path().string();
+                struct stat st;
+                if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+                    continue;
+                if (file.path().filename().string().rfind(".tmp-", 0) == 0) {
+                    if (now - st.st_mtime > STALE_TEMPORARY_SECONDS)
+                        unlink(path.c_str());
+                    continue;
+                }
+                files.push_back({path, st.st_mtim, static_cast<uint64_t>(st.st_size)});
+                total += st.st_size;
+            }
+        }
+        return files;
+    }
+
+    CompileCache::CompileCache(std::string dir, uint64_t max_bytes) : dir(std::move(dir)), max_bytes(max_bytes) {
+        std::error_code error;
+        std::filesystem::create_directories(this->dir, error);
+    }
+
+    // Hash of what is compiled, with what compiles it
+    static std::string hash(std::string_view kind, std::string_view data, const output::Options &options) {
+        // stats and stream change how the code is reported and written, not the code
+        std::string flags = options.ssa ? "ssa" : "";
+        Sha256 hash;
+        hash.update(VERSION);
+        hash.update("", 1);
+        hash.update(flags);
+        hash.update("", 1);
+        hash.update(kind);
+        hash.update("", 1);
+        hash.update(data);
+        return hash.hex();
+    }
+
+    std::string CompileCache::key(std::string_view source, const output::Options &options) {
+        return hash("program", source, options);
+    }
+
+    std::string CompileCache::function_key(std::string_view fingerprint, const output::Options &options) {
+        return hash("function", fingerprint, options);
+    }
+
+    std::string CompileCache::path(const std::string &key) const {
+        // Entries are spread over 256 subdirectories, by the first byte of the key
+        return dir + "/" + key.substr(0, 2) + "/" + key.substr(2);
+    }
+
+    bool CompileCache::load(const std::string &key, int fd, Result &result) {
+        Lookup lookup = read(key, fd, result);
+        Stats counts;
+        (lookup == Lookup::Hit ? counts.hits : counts.misses) = 1;
+        count(counts);
+        return lookup != Lookup::Miss;
+    }
+
+    bool CompileCache::load_function(const std::string &key, std::string &data) {
+        Result result;
+        if (read(key, -1, result) != Lookup::Hit)
+            return false;
+        data = std::move(result.ir);
+        return true;
+    }
+
+    CompileCache::Lookup CompileCache::read(const std::string &key, int fd, Result &result) {
+        std::string entry = path(key);
+        int in = open(entry.c_str(), O_RDONLY | O_CLOEXEC);
+        if (in < 0)
+            return Lookup::Miss;
+
+        char header[64] = {};
+        unsigned long long ir_length = 0, diagnostics_length = 0;
+        int header_length = 0;
+        struct stat st;
+        ssize_t got = pread(in, header, sizeof(header) - 1, 0);
+        bool valid = got > 0 && fstat(in, &st) == 0 &&
+                     std::sscanf(header, "fanc-cache %llu %llu\n%n", &ir_length, &diagnostics_length,
+                                 &header_length) == 2 && header_length > 0 &&
+                     static_cast<unsigned long long>(st.st_size) == header_length + ir_length + diagnostics_length;
+        if (valid) {
+            result.diagnostics.resize(diagnostics_length);
+            valid = pread_all(in, &result.diagnostics[0], diagnostics_length, header_length + ir_length);
+        }
+        if (valid && fd < 0) {
+            result.ir.resize(ir_length);
+            valid = pread_all(in, &result.ir[0], ir_length, header_length);
+        } else if (valid) {
+            off_t start = output_start(fd);
+            size_t copied = 0;
+            if (!copy_out(in, header_length, ir_length, fd, copied)) {
+                int error = errno;
+                close(in);
+                // The entry is fine, the program is compiled and written again if the output can be taken back
+                result = Result();
+                if (copied == 0 || (start >= 0 && ftruncate(fd, start) == 0 && lseek(fd, start, SEEK_SET) == start))
+                    return Lookup::Miss;
+                result.diagnostics = std::string("fanc: cannot write the code: ") + std::strerror(error) + "\n";
+                return Lookup::WriteError;
+            }
+        }
+        close(in);
+
+        if (valid) {
+            utimensat(AT_FDCWD, entry.c_str(), nullptr, 0);
+        } else {
+            // A damaged entry is compiled again and replaced
+            result = Result();
+            unlink(entry.c_str());
+        }
+        return valid ? Lookup::Hit : Lookup::Miss;
+    }
+
+    void CompileCache::store(const std::string &key, const Result &result) {
+        if (write(key, result))
+            evict();
+    }
+
+    void CompileCache::store_function(const std::string &key, const std::string &data) {
+        Result result;
+        result.ir = data;
+        write(key, result);
+    }
+
+    bool CompileCache::write(const std::string &key, const Result &result) {
+        std::string entry = path(key);
+        std::string temporary = entry.substr(0, entry.rfind('/'));
+        std::error_code error;
+        std::filesystem::create_directories(temporary, error);
+        temporary += "/.tmp-XXXXXX";
+        int out = mkstemp(&temporary[0]);
+        if (out < 0)
+            return false;
+
+        char header[64];
+        int header_length = std::snprintf(header, sizeof(header), HEADER_FORMAT,
+                                          static_cast<unsigned long long>(result.ir.size()),
+                                          static_cast<unsigned long long>(result.diagnostics.size()));
+        bool written = write_all(out, header, header_length) &&
+                       write_all(out, result.ir.data(), result.ir.size()) &&
+                       write_all(out, result.diagnostics.data(), result.diagnostics.size());
+        if (close(out) != 0 || !written || rename(temporary.c_str(), entry.c_str()) != 0) {
+            unlink(temporary.c_str());
+            return false;
+        }
+        // An entry that replaced the same one from another process is counted twice, which at worst
+        // brings the next scan forward
+        Stats added;
+        added.bytes = header_length + result.ir.size() + result.diagnostics.size();
+        count(added);
+        return true;
+    }
+
+    void CompileCache::evict() {
+        std::optional<uint64_t> known = count(Stats());
+        if (known && *known <= max_bytes)
+            return;
+        uint64_t total;
+        std::vector<CacheFile> files = scan(dir, total);
+        if (total > max_bytes) {
+            std::sort(files.begin(), files.end(), [](const CacheFile &a, const CacheFile &b) {
+                if (a.used.tv_sec != b.used.tv_sec)
+                    return a.used.tv_sec < b.used.tv_sec;
+                return a.used.tv_nsec < b.used.tv_nsec;
+            });
+            for (const CacheFile &file : files) {
+                if (total <= max_bytes)
+                    break;
+                if (unlink(file.path.c_str()) == 0)
+                    total -= file.size;
+            }
+        }
+        // What other processes stored during the scan is missed until the next one
+        count(Stats(), total);
+    }
+
+    // The counts file holds the hits and misses of programs, then of functions, then the running total of
+    // the size of the entries (missing until the first scan)
+    static const char COUNTS_FORMAT[] = "%llu %llu %llu %llu %llu\n";
+
+    void CompileCache::count_functions(uint64_t hits, uint64_t misses) {
+        Stats counts;
+        counts.function_hits = hits;
+        counts.function_misses = misses;
+        count(counts);
+    }
+
+    std::optional<uint64_t> CompileCache::count(const Stats &counts, std::optional<uint64_t> scanned_bytes) {
+        int fd = open((dir + "/stats").c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0)
+            return std::nullopt;
+        std::optional<uint64_t> bytes;
+        // The counts are shared by every process using the directory
+        if (flock(fd, LOCK_EX) == 0) {
+            char text[160] = {};
+            unsigned long long totals[5] = {};
+            int known = 0;
+            if (pread(fd, text, sizeof(text) - 1, 0) > 0)
+                known = std::sscanf(text, COUNTS_FORMAT, &totals[0], &totals[1], &totals[2], &totals[3], &totals[4]);
+            if (scanned_bytes)
+                bytes = *scanned_bytes;
+            else if (known == 5)
+                bytes = totals[4] + counts.bytes;
+            int length = std::snprintf(text, sizeof(text), bytes ? COUNTS_FORMAT : "%llu %llu %llu %llu\n",
+                                       totals[0] + counts.hits, totals[1] + counts.misses,
+                                       totals[2] + counts.function_hits, totals[3] + counts.function_misses,
+                                       static_cast<unsigned long long>(bytes.value_or(0)));
+            if (pwrite(fd, text, length, 0) == length)
+                ftruncate(fd, length);
+        }
+        close(fd);
+        return bytes;
+    }
+
+    CompileCache::Stats CompileCache::stats() const {
+        Stats stats;
+        FILE *file = std::fopen((dir + "/stats").c_str(), "r");
+        if (file != nullptr) {
+            unsigned long long totals[5] = {};
+            std::fscanf(file, COUNTS_FORMAT, &totals[0], &totals[1], &totals[2], &totals[3], &totals[4]);
+            stats.hits = totals[0];
+            stats.misses = totals[1];
+            stats.function_hits = totals[2];
+            stats.function_misses = totals[3];
+            std::fclose(file);
+        }
+        uint64_t total;
+        stats.entries = scan(dir, total).size();
+        stats.bytes = total;
+        return stats;
+    }
+
+    std::string CompileCache::report() const {
+        Stats counts = stats();
+        std::ostringstream out;
+        out << "cache: " << counts.hits << " hits, " << counts.misses << " misses (functions: "
+            << counts.function_hits << " hits, " << counts.function_misses << " misses), " << counts.entries
+            << " entries, " << counts.bytes / 1024 << " KiB of " << max_bytes / 1024 << " KiB in " << dir << "\n";
+        return out.str();
+    }
+}
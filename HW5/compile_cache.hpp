@@ -0,0 +1,109 @@
+#ifndef COMPILE_CACHE_HPP
+#define COMPILE_CACHE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include "output.hpp"
+
+namespace fanc {
+
+    struct Result;
+
+    /* CompileCache class
+     * Results of compilations kept in a directory, so that compiling a program again returns the stored
+     * result without compiling. An entry is named by the SHA-256 of everything its result depends on:
+     * the version of the compiler, the options that change the code, and the source. It holds the code,
+     * or the diagnostics of a program with an error.
+     *
+     * Entries are written to a temporary file and renamed into place, so several processes (or threads)
+     * may share a directory and never see half an entry. When the entries take more than max_bytes,
+     * the least recently used ones are removed - using an entry updates its modification time.
+     * The directory also keeps the hit and miss counts of all the compilations that used it, and a running
+     * total of the size of its entries: a store adds to it, and the directory is only scanned to evict
+     * once the total is over max_bytes.
+     *
+     * A compilation that misses looks up the code of each of its functions in the same directory, so a
+     * change to one function of a big program only generates that function again (see MyVisitor).
+     */
+    class CompileCache {
+    public:
+        static constexpr uint64_t DEFAULT_MAX_BYTES = 256ull << 20;
+
+        /* Counts of the cache, for --cache-stats */
+        struct Stats {
+            uint64_t hits = 0;
+            uint64_t misses = 0;
+            uint64_t function_hits = 0;
+            uint64_t function_misses = 0;
+            uint64_t entries = 0;
+            uint64_t bytes = 0;
+        };
+
+        // Creates the directory if needed
+        explicit CompileCache(std::string dir, uint64_t max_bytes = DEFAULT_MAX_BYTES);
+
+        // The name of the entry for compiling the source with the options
+        static std::string key(std::string_view source, const output::Options &options);
+
+        // Looks the entry up, and counts a hit or a miss. On a hit, the code is written to the file
+        // descriptor (or put in result.ir when fd is -1) and the diagnostics are put in result.
+        // Code that cannot be written is a miss, once what was written of it is taken back. When it
+        // cannot be taken back, the write error is in result.diagnostics and load() returns true: the
+        // caller must not write the code again.
+        bool load(const std::string &key, int fd, Result &result);
+
+        // Adds the entry, then removes the least recently used ones if the cache is over its size
+        void store(const std::string &key, const Result &result);
+
+        /* Entries of single functions. Their data is up to the code generator, and they are not counted
+         * one by one: the code generator adds up its hits and misses with count_functions().
+         * Storing a function does not evict, the store of the whole program that follows does.
+         */
+
+        // The name of the entry for the code of a function. The fingerprint is everything the code depends on.
+        static std::string function_key(std::string_view fingerprint, const output::Options &options);
+
+        bool load_function(const std::string &key, std::string &data);
+
+        void store_function(const std::string &key, const std::string &data);
+
+        void count_functions(uint64_t hits, uint64_t misses);
+
+        Stats stats() const;
+
+        // The counts as one line
+        std::string report() const;
+
+    private:
+        enum class Lookup {
+            Hit,
+            Miss,
+            // The code of the entry was only partly written out
+            WriteError
+        };
+
+        std::string dir;
+        uint64_t max_bytes;
+
+        std::string path(const std::string &key) const;
+
+        // Reads the entry, writing the code to the file descriptor or to result.ir when fd is -1.
+        // Removes a damaged entry.
+        Lookup read(const std::string &key, int fd, Result &result);
+
+        // Adds the entry, and its size to the running total
+        bool write(const std::string &key, const Result &result);
+
+        // Adds to the counts kept in the directory, counts.bytes to the running total. The total is set
+        // to scanned_bytes instead when given. Returns the total, nullopt when it was never scanned.
+        std::optional<uint64_t> count(const Stats &counts, std::optional<uint64_t> scanned_bytes = std::nullopt);
+
+        // Scans the directory and removes the least recently used entries, if the running total is over
+        // max_bytes or unknown
+        void evict();
+    };
+}
+
+#endif //COMPILE_CACHE_HPP
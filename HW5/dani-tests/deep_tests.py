@@ -0,0 +1,86 @@
+"""
+Writes the deep nesting tests: programs nested LEVELS deep (1e5 by default) in expressions, else if
+chains, blocks and ifs, as NAME.in.txt with the output each prints in NAME.out, like the other tests.
+run_tests.sh writes them to its build directory and runs them with the rest.
+
+Usage:
+    python3 deep_tests.py [--levels N] DIR
+"""
+import argparse
+import os
+
+
+def deep_expressions(n):
+    lines = [
+        f"// {n} levels of nesting in expressions",
+        "void main() {",
+        "    int parens = " + "(" * n + "7" + ")" * n + ";",
+        "    printi(parens);",
+        "    int left = 0" + "+1" * n + ";",
+        "    printi(left);",
+        "    int right = " + "1+(" * n + "0" + ")" * n + ";",
+        "    printi(right);",
+        "    bool b = " + "not " * n + "true;",
+        '    if (b) print("even"); else print("odd");',
+        "    if (" + "not " * (n - 1) + 'b) print("even"); else print("odd");',
+        "}",
+    ]
+    # b is n nots of true, and the last condition 2n - 1 nots of true
+    return lines, [7, n, n, "even" if n % 2 == 0 else "odd", "odd"]
+
+
+def deep_else_if(n):
+    chain = "else ".join(f"if(x=={i})y={i + 1};" for i in range(n))
+    lines = [
+        f"// An else if chain of {n} branches",
+        "void main() {",
+        f"    int x = {n - 1};",
+        "    int y = 0;",
+        "    " + chain + "else y=0-1;",
+        "    printi(y);",
+        "}",
+    ]
+    return lines, [n]
+
+
+def deep_statements(n):
+    lines = [
+        f"// {n} levels of nesting in blocks and ifs",
+        "void main() {",
+        "    int x = 1;",
+        "    bool b = true;",
+        "    " + "{" * n + "x = x + 1;" + "}" * n,
+        "    printi(x);",
+        "    " + "if(b)" * n + "x = x + 1;",
+        "    printi(x);",
+        "    " + "if(not b)" * n + "x = x + 1;",
+        "    printi(x);",
+        "}",
+    ]
+    return lines, [2, 3, 3]
+
+
+TESTS = {
+    "t17-deep-expressions": deep_expressions,
+    "t18-deep-else-if": deep_else_if,
+    "t19-deep-statements": deep_statements,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--levels", type=int, default=100000)
+    parser.add_argument("dir")
+    args = parser.parse_args()
+
+    os.makedirs(args.dir, exist_ok=True)
+    for name, generate in TESTS.items():
+        lines, outputs = generate(args.levels)
+        with open(os.path.join(args.dir, name + ".in.txt"), "w") as source:
+            source.write("\n".join(lines) + "\n")
+        with open(os.path.join(args.dir, name + ".out"), "w") as expected:
+            expected.write("".join(f"{line}\n" for line in outputs))
+
+
+if __name__ == "__main__":
+    main()
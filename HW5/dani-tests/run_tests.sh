@@ -5,9 +5,12 @@ set -u
 # ROOT assumes this script is inside 'dani-tests', so root is one level up
 ROOT="$(cd "$(dirname "${BASH_SOURCE[0]}")/.." && pwd)"
 BIN="${BIN:-$ROOT/hw5}"
+HW5_FLAGS="${HW5_FLAGS:-}"  # extra compiler flags, e.g. HW5_FLAGS=--ssa
 TESTS_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 BUILD_DIR="${BUILD_DIR:-$ROOT/test_build}"
 LLI_BIN="${LLI:-}"
+DEEP_LEVELS="${DEEP_LEVELS:-100000}"  # nesting depth of the generated deep tests
+DEEP_DIR="$BUILD_DIR/deep"
 
 mkdir -p "$BUILD_DIR"
 
@@ -41,24 +44,33 @@ find_lli() {
     fi
 }
 
+# 5. Generate the deep nesting tests, too big to keep in the tree
+generate_deep_tests() {
+    if ! python3 "$TESTS_DIR/deep_tests.py" --levels "$DEEP_LEVELS" "$DEEP_DIR"; then
+        red "[build] Failed to generate the deep tests."
+        exit 2
+    fi
+}
+
 ensure_built
 find_lli
+generate_deep_tests
 
-# 5. Run the tests
+# 6. Run the tests
 PASS=0
 FAIL=0
 SKIP=0
 
 echo "Running tests from: $TESTS_DIR"
 
-# Loop over all .in.txt files (e.g., t01.in.txt)
-for test_file in "$TESTS_DIR"/*.in.txt; do
+# Loop over all .in.txt files (e.g., t01.in.txt), then the generated ones
+for test_file in "$TESTS_DIR"/*.in.txt "$DEEP_DIR"/*.in.txt; do
     # Extract base name (e.g., "t01")
     filename=$(basename "$test_file")
     test_name="${filename%.in.txt}"
 
     # Define expected files
-    expected_out="$TESTS_DIR/$test_name.out"
+    expected_out="$(dirname "$test_file")/$test_name.out"
     generated_ll="$BUILD_DIR/$test_name.ll"
     generated_out="$BUILD_DIR/$test_name.res"
 
@@ -70,7 +82,7 @@ for test_file in "$TESTS_DIR"/*.in.txt; do
     fi
 
     # Run your compiler (hw5) -> produces .ll
-    "$BIN" < "$test_file" > "$generated_ll" 2>/dev/null
+    "$BIN" $HW5_FLAGS < "$test_file" > "$generated_ll" 2>/dev/null
     if [[ $? -ne 0 ]]; then
         red "[FAIL] $test_name: Compiler crashed or returned error."
         FAIL=$((FAIL + 1))
@@ -0,0 +1,81 @@
+#include "fanc.hpp"
+#include "compilation.hpp"
+#include "out_buffer.hpp"
+#include <chrono>
+#include <exception>
+#include <iostream>
+
+namespace fanc {
+
+    const char *const VERSION = "fanc 1.0 (built " __DATE__ " " __TIME__ ")";
+
+    // Compiles the program, looking up the code of each function in the cache if there is one
+    static Result compile(std::string_view source, const Options &options, int fd, CompileCache *cache) {
+        Result result;
+        Compilation compilation(options);
+        compilation.cache = cache;
+        try {
+            auto parse_start = std::chrono::steady_clock::now();
+            compilation.parse(source);
+            std::chrono::duration<double> parse_time = std::chrono::steady_clock::now() - parse_start;
+
+            const ast::FlatTree &tree = compilation.tree;
+            if (options.stats) {
+                std::cerr << "parse: " << tree.size() << " nodes in " << parse_time.count() * 1000 << " ms ("
+                          << static_cast<long long>(tree.size() / parse_time.count()) << " nodes/s), AST "
+                          << tree.memory() / 1024 << " KiB" << std::endl;
+            }
+
+            auto check_start = std::chrono::steady_clock::now();
+            compilation.check();
+            std::chrono::duration<double> check_time = std::chrono::steady_clock::now() - check_start;
+            if (options.stats) {
+                std::cerr << "check: " << check_time.count() * 1000 << " ms, annotations "
+                          << compilation.annotations.memory() / 1024 << " KiB" << std::endl;
+            }
+
+            if (!options.check)
+                result.ir = compilation.generate(fd);
+        } catch (const output::CompileError &error) {
+            result.diagnostics = error.what();
+        } catch (const std::exception &error) {
+            // Not an error in the program, but it is reported the same way instead of leaving the library
+            result = Result();
+            result.diagnostics = std::string("fanc: ") + error.what() + "\n";
+            result.failed = true;
+        }
+        return result;
+    }
+
+    Result compile(std::string_view source, const Options &options) {
+        return compile(source, options, -1, nullptr);
+    }
+
+    Result compile(std::string_view source, const Options &options, int fd) {
+        return compile(source, options, fd, nullptr);
+    }
+
+    Result compile(std::string_view source, const Options &options, int fd, CompileCache &cache) {
+        // Checking alone is cheap, and has no code to store
+        if (options.check)
+            return compile(source, options, fd, nullptr);
+
+        std::string key = CompileCache::key(source, options);
+        Result result;
+        if (cache.load(key, fd, result))
+            return result;
+
+        Options buffered = options;
+        buffered.stream = false;
+        result = compile(source, buffered, -1, &cache);
+        if (!result.failed)
+            cache.store(key, result);
+        if (fd >= 0) {
+            output::OutputBuffer out(fd);
+            out << result.ir;
+            out.flush();
+            result.ir.clear();
+        }
+        return result;
+    }
+}
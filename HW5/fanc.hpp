@@ -0,0 +1,48 @@
+#ifndef FANC_HPP
+#define FANC_HPP
+
+#include <string>
+#include <string_view>
+#include "compile_cache.hpp"
+#include "output.hpp"
+
+/* The compiler as a library (libfanc): compiles FanC programs to LLVM IR inside the calling process.
+ * Compilations are independent, so compile() may be called from several threads at the same time.
+ */
+namespace fanc {
+
+    using output::Options;
+
+    // Version of the compiler, which changes with every build of it
+    extern const char *const VERSION;
+
+    /* Result of compiling a program */
+    struct Result {
+        // The generated code. Empty when the program has an error, or when the code was written to a
+        // file descriptor.
+        std::string ir;
+        // The error in the program, as hw5 prints it. Empty when the program compiled.
+        std::string diagnostics;
+        // Whether the compiler itself failed (e.g. ran out of memory), which diagnostics then tells
+        bool failed = false;
+
+        bool ok() const {
+            return diagnostics.empty();
+        }
+    };
+
+    // Compiles the program and returns its code. With options.check the program is only checked for
+    // errors, and there is no code.
+    Result compile(std::string_view source, const Options &options = Options());
+
+    // Compiles the program and writes its code to the file descriptor. With options.stream the code is
+    // written function by function as it is generated, and taken back if an error is found later.
+    Result compile(std::string_view source, const Options &options, int fd);
+
+    // Like compile() to a file descriptor, but returns the result stored in the cache when there is one.
+    // Otherwise compiles and stores the result, taking the code of the functions that did not change
+    // from the cache. Code that goes to the cache is not streamed.
+    Result compile(std::string_view source, const Options &options, int fd, CompileCache &cache);
+}
+
+#endif //FANC_HPP
@@ -0,0 +1,69 @@
+#include "protocol.hpp"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* fancc: client of the fancd compile server, used like hw5: `fancc [--ssa] [--stream] < in > out`.
+ * The source is compiled by the server, and the code or the error is printed as hw5 prints it.
+ *
+ * Other requests: `fancc --server-stats` prints the latency percentiles of the server, and
+ * `fancc --shutdown` stops it. --socket PATH selects the server.
+ */
+int main(int argc, char *argv[]) {
+    const char *path = nullptr;
+    fancd::RequestHeader request{fancd::RequestKind::Compile, 0, 0};
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--ssa") == 0)
+            request.flags |= fancd::SSA;
+        else if (std::strcmp(argv[i], "--stream") == 0)
+            request.flags |= fancd::STREAM;
+        else if (std::strcmp(argv[i], "--server-stats") == 0)
+            request.kind = fancd::RequestKind::Stats;
+        else if (std::strcmp(argv[i], "--shutdown") == 0)
+            request.kind = fancd::RequestKind::Shutdown;
+        else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+            path = argv[++i];
+    }
+    std::string socket_path = fancd::socket_path(path);
+
+    std::string source;
+    if (request.kind == fancd::RequestKind::Compile) {
+        char chunk[64 * 1024];
+        size_t len;
+        while ((len = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+            source.append(chunk, len);
+    }
+    request.length = source.size();
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket_path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+        std::cerr << "fancc: cannot connect to the compile server at " << socket_path << ": "
+                  << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    fancd::ResponseHeader response;
+    if (!fancd::write_all(fd, &request, sizeof(request)) || !fancd::write_all(fd, source.data(), source.size()) ||
+        !fancd::read_all(fd, &response, sizeof(response))) {
+        std::cerr << "fancc: the compile server did not answer" << std::endl;
+        return 1;
+    }
+    std::string output(response.ir_length + response.diagnostics_length, '\0');
+    if (!fancd::read_all(fd, &output[0], output.size())) {
+        std::cerr << "fancc: the compile server did not answer" << std::endl;
+        return 1;
+    }
+    close(fd);
+
+    // The code, or the error in the program
+    fancd::write_all(STDOUT_FILENO, output.data(), output.size());
+    return 0;
+}
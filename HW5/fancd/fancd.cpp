@@ -0,0 +1,342 @@
+#include "protocol.hpp"
+#include "../fanc.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <csignal>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* fancd: compile server. Keeps one warm compiler process that serves compile requests from local
+ * clients (fancc) on a Unix socket, on a pool of worker threads.
+ *
+ * Usage: fancd [--socket PATH] [--workers N]
+ * It stops on SIGINT, SIGTERM or a Shutdown request, and then prints the latency percentiles.
+ */
+namespace fancd {
+
+    using Clock = std::chrono::steady_clock;
+
+    /* Latencies class
+     * Time each compile request took, from its arrival at the server until its response was written.
+     * Shared by the workers.
+     */
+    class Latencies {
+    public:
+        void add(Clock::duration latency) {
+            std::lock_guard<std::mutex> lock(mutex);
+            samples.push_back(std::chrono::duration<double, std::milli>(latency).count());
+        }
+
+        // Number of requests and percentiles of their latencies, as one line
+        std::string report() const;
+
+    private:
+        mutable std::mutex mutex;
+        // In milliseconds
+        std::vector<double> samples;
+    };
+
+    std::string Latencies::report() const {
+        std::vector<double> sorted;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            sorted = samples;
+        }
+        std::ostringstream out;
+        out << "requests: " << sorted.size();
+        if (!sorted.empty()) {
+            std::sort(sorted.begin(), sorted.end());
+            // Nearest rank
+            auto percentile = [&](double p) {
+                size_t rank = static_cast<size_t>(std::ceil(p / 100 * sorted.size()));
+                return sorted[std::max<size_t>(rank, 1) - 1];
+            };
+            out << ", latency ms: p50 " << percentile(50) << " p90 " << percentile(90) << " p99 "
+                << percentile(99) << " max " << sorted.back();
+        }
+        out << "\n";
+        return out.str();
+    }
+
+    // A client that stops in the middle of a request or of its response is dropped after this long
+    constexpr int IO_TIMEOUT_SECONDS = 10;
+
+    /* Server class
+     * Accepts the connections on the listening socket and watches them for requests. A connection with a
+     * request is queued for a fixed pool of workers, and a worker serves that one request and hands the
+     * connection back to be watched, so an idle client does not hold a worker.
+     */
+    class Server {
+    public:
+        // stop_fd becomes readable when the server has to stop
+        Server(int listen_fd, int stop_fd, int wake_fd, unsigned workers);
+
+        ~Server();
+
+        // Serves until the server is stopped, then waits for the queued requests to be served and closes
+        // the idle connections
+        void run();
+
+        const Latencies &latencies() const {
+            return latencies_;
+        }
+
+    private:
+        struct Connection {
+            int fd;
+            // When its request was seen to arrive
+            Clock::time_point arrived;
+        };
+
+        int listen_fd;
+        int stop_fd;
+        // Write end of stop_fd, for a Shutdown request
+        int wake_fd;
+        unsigned worker_count;
+
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::deque<Connection> queue;
+        // Connections the workers are done with, to be watched again, and the pipe that tells run()
+        std::vector<int> returned;
+        int return_pipe[2];
+        bool stopping = false;
+
+        Latencies latencies_;
+
+        void work();
+
+        // Serves the request waiting on the connection. False if the connection has to be closed.
+        bool serve(const Connection &connection);
+    };
+
+    Server::Server(int listen_fd, int stop_fd, int wake_fd, unsigned workers) :
+            listen_fd(listen_fd), stop_fd(stop_fd), wake_fd(wake_fd), worker_count(workers) {
+        if (pipe2(return_pipe, O_CLOEXEC | O_NONBLOCK) != 0)
+            throw std::runtime_error(std::string("pipe: ") + std::strerror(errno));
+    }
+
+    Server::~Server() {
+        close(return_pipe[0]);
+        close(return_pipe[1]);
+    }
+
+    void Server::run() {
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < worker_count; i++)
+            workers.emplace_back(&Server::work, this);
+
+        // Connections waiting for their next request
+        std::vector<int> idle;
+        for (;;) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                idle.insert(idle.end(), returned.begin(), returned.end());
+                returned.clear();
+            }
+            std::vector<struct pollfd> fds = {{listen_fd, POLLIN, 0}, {stop_fd, POLLIN, 0},
+                                              {return_pipe[0], POLLIN, 0}};
+            for (int fd : idle)
+                fds.push_back({fd, POLLIN, 0});
+            if (poll(fds.data(), fds.size(), -1) < 0) {
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            if (fds[1].revents != 0)
+                break;
+            if (fds[2].revents != 0) {
+                char drained[64];
+                while (read(return_pipe[0], drained, sizeof(drained)) > 0) {}
+            }
+
+            // A request, or the client closing the connection, which the worker finds out
+            std::vector<int> still_idle;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                for (size_t i = 3; i < fds.size(); i++) {
+                    if (fds[i].revents != 0)
+                        queue.push_back({fds[i].fd, Clock::now()});
+                    else
+                        still_idle.push_back(fds[i].fd);
+                }
+            }
+            if (still_idle.size() < idle.size())
+                ready.notify_all();
+            idle = std::move(still_idle);
+
+            if (fds[0].revents & POLLIN) {
+                int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd < 0)
+                    continue;
+                struct timeval timeout = {IO_TIMEOUT_SECONDS, 0};
+                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+                idle.push_back(fd);
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            idle.insert(idle.end(), returned.begin(), returned.end());
+            returned.clear();
+        }
+        ready.notify_all();
+        for (int fd : idle)
+            close(fd);
+        for (auto &worker : workers)
+            worker.join();
+    }
+
+    void Server::work() {
+        for (;;) {
+            Connection connection;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                ready.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;
+                connection = queue.front();
+                queue.pop_front();
+            }
+            bool open = serve(connection);
+            std::lock_guard<std::mutex> lock(mutex);
+            if (open && !stopping) {
+                returned.push_back(connection.fd);
+                ssize_t ignored = write(return_pipe[1], "", 1);
+                (void) ignored;
+            } else {
+                close(connection.fd);
+            }
+        }
+    }
+
+    bool Server::serve(const Connection &connection) {
+        RequestHeader request;
+        if (!read_all(connection.fd, &request, sizeof(request)))
+            return false;
+        // The scanner takes the source length as an int
+        if (request.length > INT32_MAX)
+            return false;
+        std::string source(request.length, '\0');
+        if (!read_all(connection.fd, &source[0], source.size()))
+            return false;
+
+        std::string ir, diagnostics;
+        switch (request.kind) {
+            case RequestKind::Compile: {
+                fanc::Options options;
+                options.ssa = (request.flags & SSA) != 0;
+                options.stream = (request.flags & STREAM) != 0;
+                // Errors of the compiler come back in the diagnostics too, the server keeps serving
+                fanc::Result result = fanc::compile(source, options);
+                ir = std::move(result.ir);
+                diagnostics = std::move(result.diagnostics);
+                break;
+            }
+            case RequestKind::Stats:
+                ir = latencies_.report();
+                break;
+            case RequestKind::Shutdown:
+                if (write(wake_fd, "", 1) < 0)
+                    diagnostics = "fancd: cannot stop\n";
+                break;
+            default:
+                diagnostics = "fancd: unknown request\n";
+                break;
+        }
+
+        ResponseHeader response{ir.size(), diagnostics.size()};
+        if (!write_all(connection.fd, &response, sizeof(response)) ||
+            !write_all(connection.fd, ir.data(), ir.size()) ||
+            !write_all(connection.fd, diagnostics.data(), diagnostics.size()))
+            return false;
+        if (request.kind == RequestKind::Compile)
+            latencies_.add(Clock::now() - connection.arrived);
+        return true;
+    }
+}
+
+// Write end of the pipe that stops the server, for the signal handler
+static int signal_fd = -1;
+
+static void on_signal(int) {
+    ssize_t ignored = write(signal_fd, "", 1);
+    (void) ignored;
+}
+
+int main(int argc, char *argv[]) {
+    const char *path = nullptr;
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc)
+            path = argv[++i];
+        else if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+            workers = std::max(1, std::atoi(argv[++i]));
+    }
+    std::string socket_path = fancd::socket_path(path);
+
+    struct sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "fancd: socket path too long: " << socket_path << std::endl;
+        return 1;
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        std::cerr << "fancd: socket: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    // A socket file nobody listens on is left over from a server that did not stop cleanly
+    if (connect(listen_fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) == 0) {
+        std::cerr << "fancd: a server is already listening on " << socket_path << std::endl;
+        return 1;
+    }
+    close(listen_fd);
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    unlink(socket_path.c_str());
+    if (listen_fd < 0 || bind(listen_fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0 ||
+        listen(listen_fd, SOMAXCONN) != 0) {
+        std::cerr << "fancd: cannot listen on " << socket_path << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    int stop_pipe[2];
+    if (pipe2(stop_pipe, O_CLOEXEC) != 0) {
+        std::cerr << "fancd: pipe: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+    signal_fd = stop_pipe[1];
+    struct sigaction action = {};
+    action.sa_handler = on_signal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    // A client that goes away must not kill the server
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cerr << "fancd: listening on " << socket_path << " with " << workers << " workers" << std::endl;
+    fancd::Server server(listen_fd, stop_pipe[0], stop_pipe[1], workers);
+    server.run();
+
+    close(listen_fd);
+    unlink(socket_path.c_str());
+    std::cerr << "fancd: " << server.latencies().report();
+    return 0;
+}
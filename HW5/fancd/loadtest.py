@@ -0,0 +1,105 @@
+"""
+Checks the fancd compile server against hw5 and measures its latency, all on the local machine.
+
+Usage:
+    python3 fancd/loadtest.py [--requests N] [--clients C] [--workers W] HW5 FANCD FANCC
+
+Starts FANCD on a temporary socket, then:
+  1. compiles every test program with FANCC and with HW5 (with and without --ssa), and checks the
+     outputs are the same,
+  2. sends N compile requests from C concurrent clients, and does the same with HW5 alone, and
+     prints the latency percentiles of both, and the ones measured by the server.
+Exits with status 1 if an output differs.
+"""
+import argparse
+import glob
+import math
+import os
+import subprocess
+import sys
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+
+
+def test_programs():
+    root = os.path.dirname(HERE)
+    return sorted(glob.glob(os.path.join(root, "staff-tests", "*.in")) +
+                  glob.glob(os.path.join(root, "dani-tests", "*.in.txt")))
+
+
+def run(command, source):
+    """Runs the command on the source, returns (stdout, seconds)"""
+    start = time.perf_counter()
+    result = subprocess.run(command, input=source, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    elapsed = time.perf_counter() - start
+    if result.returncode != 0:
+        raise RuntimeError(f"{' '.join(command)} failed: {result.stderr.decode(errors='replace')}")
+    return result.stdout, elapsed
+
+
+def percentiles(seconds):
+    """p50, p90, p99 and max in milliseconds, by nearest rank"""
+    ordered = sorted(seconds)
+    rank = lambda p: ordered[max(math.ceil(p / 100 * len(ordered)), 1) - 1] * 1000
+    return f"p50 {rank(50):.2f} p90 {rank(90):.2f} p99 {rank(99):.2f} max {ordered[-1] * 1000:.2f} ms"
+
+
+def load(command, sources, requests, clients):
+    """Compiles requests sources round robin from concurrent clients, returns the latencies and the wall time"""
+    start = time.perf_counter()
+    with ThreadPoolExecutor(max_workers=clients) as pool:
+        latencies = list(pool.map(lambda i: run(command, sources[i % len(sources)])[1], range(requests)))
+    return latencies, time.perf_counter() - start
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--requests", type=int, default=1000)
+    parser.add_argument("--clients", type=int, default=8)
+    parser.add_argument("--workers", type=int, default=os.cpu_count())
+    parser.add_argument("hw5")
+    parser.add_argument("fancd")
+    parser.add_argument("fancc")
+    args = parser.parse_args()
+
+    with tempfile.TemporaryDirectory() as tmp:
+        socket = os.path.join(tmp, "fancd.sock")
+        server = subprocess.Popen([args.fancd, "--socket", socket, "--workers", str(args.workers)],
+                                  stderr=subprocess.PIPE, text=True)
+        try:
+            while not os.path.exists(socket):
+                if server.poll() is not None:
+                    sys.exit(f"fancd exited: {server.stderr.read()}")
+                time.sleep(0.01)
+            client = [args.fancc, "--socket", socket]
+
+            programs = test_programs()
+            sources = [open(path, "rb").read() for path in programs]
+            mismatches = 0
+            for path, source in zip(programs, sources):
+                for flags in ([], ["--ssa"]):
+                    if run([args.hw5] + flags, source)[0] != run(client + flags, source)[0]:
+                        print(f"DIFFERENT OUTPUT: {os.path.basename(path)} {' '.join(flags)}")
+                        mismatches += 1
+            print(f"{len(programs) * 2} compilations compared with hw5, {mismatches} different")
+
+            for name, command in (("hw5", [args.hw5]), ("fancc", client)):
+                latencies, wall = load(command, sources, args.requests, args.clients)
+                print(f"{name}: {args.requests} requests from {args.clients} clients in {wall:.2f} s, "
+                      f"{percentiles(latencies)}")
+            print("fancd:", run(client + ["--server-stats"], b"")[0].decode().strip())
+            run(client + ["--shutdown"], b"")
+            server.wait(timeout=30)
+        finally:
+            if server.poll() is None:
+                server.terminate()
+                server.wait()
+        print(server.stderr.read().strip())
+    sys.exit(1 if mismatches else 0)
+
+
+if __name__ == "__main__":
+    main()
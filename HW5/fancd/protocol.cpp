@@ -0,0 +1,43 @@
+#include "protocol.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <unistd.h>
+
+namespace fancd {
+
+    std::string socket_path(const char *path) {
+        if (path != nullptr)
+            return path;
+        if (const char *env = std::getenv("FANCD_SOCKET"))
+            return env;
+        return "/tmp/fancd-" + std::to_string(getuid()) + ".sock";
+    }
+
+    bool read_all(int fd, void *data, size_t len) {
+        char *next = static_cast<char *>(data);
+        while (len > 0) {
+            ssize_t got = read(fd, next, len);
+            if (got < 0 && errno == EINTR)
+                continue;
+            if (got <= 0)
+                return false;
+            next += got;
+            len -= got;
+        }
+        return true;
+    }
+
+    bool write_all(int fd, const void *data, size_t len) {
+        const char *next = static_cast<const char *>(data);
+        while (len > 0) {
+            ssize_t written = write(fd, next, len);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+                return false;
+            next += written;
+            len -= written;
+        }
+        return true;
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef FANCD_PROTOCOL_HPP
+#define FANCD_PROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/* Protocol between the fancd compile server and its clients, over a local Unix socket.
+ * A client sends a RequestHeader followed by `length` bytes (the FanC source of a Compile request),
+ * and the server answers with a ResponseHeader followed by the code and then the diagnostics.
+ * Both ends run on the same machine, so the integers are sent in the native byte order.
+ */
+namespace fancd {
+
+    enum class RequestKind : uint32_t {
+        // Compile the source that follows
+        Compile,
+        // Report the latency of the requests served so far, in the code of the response
+        Stats,
+        // Stop the server once the requests in progress are done
+        Shutdown
+    };
+
+    enum RequestFlags : uint32_t {
+        SSA = 1,
+        STREAM = 2
+    };
+
+    struct RequestHeader {
+        RequestKind kind;
+        uint32_t flags;
+        uint64_t length;
+    };
+
+    struct ResponseHeader {
+        uint64_t ir_length;
+        uint64_t diagnostics_length;
+    };
+
+    // Path of the socket: the one given, else $FANCD_SOCKET, else one per user in /tmp
+    std::string socket_path(const char *path);
+
+    // Read or write exactly len bytes, retrying after partial transfers. False on an error or end of file.
+    bool read_all(int fd, void *data, size_t len);
+
+    bool write_all(int fd, const void *data, size_t len);
+}
+
+#endif //FANCD_PROTOCOL_HPP
@@ -0,0 +1,166 @@
+#include "fingerprint.hpp"
+
+namespace output {
+
+    void Fingerprint::number(long long value){
+        text += std::to_string(value);
+        text += ';';
+    }
+
+    void Fingerprint::visit(ast::Num& node){
+        text += 'N';
+        number(node.value);
+    }
+
+    void Fingerprint::visit(ast::NumB& node){
+        text += 'b';
+        number(node.value);
+    }
+
+    void Fingerprint::visit(ast::String& node){
+        // Strings cannot hold a NUL, which ends them
+        text += 'S';
+        text += node.value;
+        text += '\0';
+    }
+
+    void Fingerprint::visit(ast::Bool& node){
+        text += node.value ? 'T' : 'F';
+    }
+
+    void Fingerprint::visit(ast::ID& node){
+        text += 'I';
+        text += symbols.name(node.symbol);
+        text += '\0';
+        if (seen.insert(node.symbol).second)
+            identifiers.push_back(node.symbol);
+    }
+
+    void Fingerprint::visit(ast::BinOp& node){
+        text += 'O';
+        number(node.op);
+        child(node.left);
+        child(node.right);
+    }
+
+    void Fingerprint::visit(ast::RelOp& node){
+        text += 'R';
+        number(node.op);
+        child(node.left);
+        child(node.right);
+    }
+
+    void Fingerprint::visit(ast::Not& node){
+        text += '!';
+        child(node.exp);
+    }
+
+    void Fingerprint::visit(ast::And& node){
+        text += '&';
+        child(node.left);
+        child(node.right);
+    }
+
+    void Fingerprint::visit(ast::Or& node){
+        text += '|';
+        child(node.left);
+        child(node.right);
+    }
+
+    void Fingerprint::visit(ast::Type& node){
+        text += 't';
+        number(node.type);
+    }
+
+    void Fingerprint::visit(ast::Cast& node){
+        text += 'C';
+        child(node.exp);
+        child(node.target_type);
+    }
+
+    void Fingerprint::visit(ast::ExpList& node){
+        text += '(';
+        for (ast::Exp* exp : node.exps)
+            child(exp);
+        text += ')';
+    }
+
+    void Fingerprint::visit(ast::Call& node){
+        text += 'c';
+        child(node.func_id);
+        child(node.args);
+    }
+
+    void Fingerprint::visit(ast::Statements& node){
+        text += '{';
+        for (ast::Statement* statement : node.statements)
+            child(statement);
+        text += '}';
+    }
+
+    void Fingerprint::visit(ast::Break& node){
+        text += 'k';
+    }
+
+    void Fingerprint::visit(ast::Continue& node){
+        text += 'n';
+    }
+
+    void Fingerprint::visit(ast::Return& node){
+        text += 'r';
+        child(node.exp);
+    }
+
+    void Fingerprint::visit(ast::If& node){
+        text += 'i';
+        child(node.condition);
+        child(node.then);
+        child(node.otherwise);
+    }
+
+    void Fingerprint::visit(ast::While& node){
+        text += 'w';
+        child(node.condition);
+        child(node.body);
+    }
+
+    void Fingerprint::visit(ast::VarDecl& node){
+        text += 'v';
+        child(node.id);
+        child(node.type);
+        child(node.init_exp);
+    }
+
+    void Fingerprint::visit(ast::Assign& node){
+        text += '=';
+        child(node.id);
+        child(node.exp);
+    }
+
+    void Fingerprint::visit(ast::Formal& node){
+        text += 'p';
+        child(node.id);
+        child(node.type);
+    }
+
+    void Fingerprint::visit(ast::Formals& node){
+        text += '[';
+        for (ast::Formal* formal : node.formals)
+            child(formal);
+        text += ']';
+    }
+
+    void Fingerprint::visit(ast::FuncDecl& node){
+        text += 'f';
+        child(node.id);
+        child(node.return_type);
+        child(node.formals);
+        child(node.body);
+    }
+
+    void Fingerprint::visit(ast::Funcs& node){
+        text += 'P';
+        for (ast::FuncDecl* func : node.funcs)
+            child(func);
+    }
+}
@@ -0,0 +1,95 @@
+#ifndef FINGERPRINT_HPP
+#define FINGERPRINT_HPP
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+#include "visitor.hpp"
+#include "nodes.hpp"
+
+namespace output {
+
+    /* Fingerprint class
+     * Writes a function, or any other subtree, as a string that two subtrees share exactly when they
+     * are the same code: same structure, identifiers, literals and string constants. Lines are left
+     * out, so moving a function in its file keeps its fingerprint.
+     * What the code means also depends on the identifiers it uses that are declared outside of it,
+     * so the distinct identifiers are collected in the order they first appear.
+     */
+    class Fingerprint final : public ast::StaticVisitor<Fingerprint> {
+    public:
+        explicit Fingerprint(const ast::Interner& symbols) : symbols(symbols) {}
+
+        std::string text;
+        std::vector<ast::SymbolId> identifiers;
+
+        void visit(ast::Num& node);
+
+        void visit(ast::NumB& node);
+
+        void visit(ast::String& node);
+
+        void visit(ast::Bool& node);
+
+        void visit(ast::ID& node);
+
+        void visit(ast::BinOp& node);
+
+        void visit(ast::RelOp& node);
+
+        void visit(ast::Not& node);
+
+        void visit(ast::And& node);
+
+        void visit(ast::Or& node);
+
+        void visit(ast::Type& node);
+
+        void visit(ast::Cast& node);
+
+        void visit(ast::ExpList& node);
+
+        void visit(ast::Call& node);
+
+        void visit(ast::Statements& node);
+
+        void visit(ast::Break& node);
+
+        void visit(ast::Continue& node);
+
+        void visit(ast::Return& node);
+
+        void visit(ast::If& node);
+
+        void visit(ast::While& node);
+
+        void visit(ast::VarDecl& node);
+
+        void visit(ast::Assign& node);
+
+        void visit(ast::Formal& node);
+
+        void visit(ast::Formals& node);
+
+        void visit(ast::FuncDecl& node);
+
+        void visit(ast::Funcs& node);
+
+    private:
+        const ast::Interner& symbols;
+        std::unordered_set<ast::SymbolId> seen;
+
+        // Every node starts with a tag character. A missing child is written as '_'.
+        template<typename T>
+        void child(T* node){
+            if (node == nullptr)
+                text += '_';
+            else
+                dispatch(*node);
+        }
+
+        void number(long long value);
+    };
+}
+
+#endif //FINGERPRINT_HPP
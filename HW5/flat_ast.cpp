@@ -0,0 +1,255 @@
+#include "flat_ast.hpp"
+
+namespace ast {
+
+    NodeId FlatTree::node(Kind kind, uint32_t lhs, uint32_t rhs, uint8_t op) {
+        kinds.push_back(kind);
+        ops.push_back(op);
+        lines.push_back(line);
+        this->lhs.push_back(lhs);
+        this->rhs.push_back(rhs);
+        return static_cast<NodeId>(kinds.size() - 1);
+    }
+
+    NodeId FlatTree::node(Kind kind, uint32_t lhs, std::initializer_list<NodeId> children) {
+        auto index = static_cast<uint32_t>(extra.size());
+        extra.insert(extra.end(), children);
+        return node(kind, lhs, index);
+    }
+
+    NodeId FlatTree::literal(Kind kind, int value) {
+        return node(kind, static_cast<uint32_t>(value));
+    }
+
+    NodeId FlatTree::string(const char *text) {
+        return node(Kind::String, strings.intern(text));
+    }
+
+    NodeId FlatTree::list(Kind kind) {
+        return node(kind);
+    }
+
+    void FlatTree::push_front(NodeId list, NodeId element) {
+        auto cell = static_cast<uint32_t>(extra.size());
+        extra.push_back(element);
+        extra.push_back(lhs[list]);
+        lhs[list] = cell;
+        if (rhs[list] == NoNode)
+            rhs[list] = cell;
+    }
+
+    void FlatTree::push_back(NodeId list, NodeId element) {
+        auto cell = static_cast<uint32_t>(extra.size());
+        extra.push_back(element);
+        extra.push_back(NoNode);
+        if (rhs[list] == NoNode)
+            lhs[list] = cell;
+        else
+            extra[rhs[list] + 1] = cell;
+        rhs[list] = cell;
+    }
+
+    size_t FlatTree::memory() const {
+        size_t bytes = kinds.capacity() * sizeof(Kind) + ops.capacity() + lines.capacity() * sizeof(int) +
+                       (lhs.capacity() + rhs.capacity() + extra.capacity()) * sizeof(uint32_t);
+        return bytes + strings.memory();
+    }
+
+    std::vector<NodeId> FlatTree::elements(NodeId list) const {
+        std::vector<NodeId> result;
+        for (uint32_t cell = lhs[list]; cell != NoNode; cell = extra[cell + 1])
+            result.push_back(extra[cell]);
+        return result;
+    }
+
+    /* Builds the nodes of a FlatTree. Every function returns the node as the class its parent holds. */
+    class Expander {
+    public:
+        Expander(const FlatTree &tree, Arena &arena) : tree(tree), arena(arena) {}
+
+        template<typename T, typename... Args>
+        T *make(NodeId id, Args &&... args) {
+            T *node = arena.make<T>(std::forward<Args>(args)...);
+            node->line = tree.lines[id];
+            node->tree_id = id;
+            return node;
+        }
+
+        ID *id(NodeId id) {
+            return make<ID>(id, tree.lhs[id]);
+        }
+
+        Type *type(NodeId id) {
+            return make<Type>(id, static_cast<BuiltInType>(tree.ops[id]));
+        }
+
+        Call *call(NodeId id) {
+            return make<Call>(id, this->id(tree.lhs[id]), exp_list(tree.rhs[id]));
+        }
+
+        ExpList *exp_list(NodeId id) {
+            auto list = make<ExpList>(id);
+            for (NodeId element : tree.elements(id))
+                list->push_back(exp(element));
+            return list;
+        }
+
+        Exp *exp(NodeId id) {
+            if (id == NoNode)
+                return nullptr;
+            if (stack_low())
+                return ensure_stack([&] { return exp(id); });
+            uint32_t lhs = tree.lhs[id], rhs = tree.rhs[id];
+            switch (tree.kinds[id]) {
+                case Kind::Num:
+                    return make<Num>(id, static_cast<int>(lhs));
+                case Kind::NumB:
+                    return make<NumB>(id, static_cast<int>(lhs));
+                case Kind::String:
+                    return make<String>(id, tree.strings.name(lhs).c_str());
+                case Kind::Bool:
+                    return make<Bool>(id, lhs != 0);
+                case Kind::ID:
+                    return this->id(id);
+                case Kind::BinOp:
+                    return make<BinOp>(id, exp(lhs), exp(rhs), static_cast<BinOpType>(tree.ops[id]));
+                case Kind::RelOp:
+                    return make<RelOp>(id, exp(lhs), exp(rhs), static_cast<RelOpType>(tree.ops[id]));
+                case Kind::Not:
+                    return make<Not>(id, exp(lhs));
+                case Kind::And:
+                    return make<And>(id, exp(lhs), exp(rhs));
+                case Kind::Or:
+                    return make<Or>(id, exp(lhs), exp(rhs));
+                case Kind::Cast:
+                    return make<Cast>(id, exp(lhs), type(rhs));
+                case Kind::Call:
+                    return call(id);
+                default:
+                    return nullptr;
+            }
+        }
+
+        Statements *statements(NodeId id) {
+            auto list = make<Statements>(id);
+            for (NodeId element : tree.elements(id))
+                list->push_back(statement(element));
+            return list;
+        }
+
+        Statement *statement(NodeId id) {
+            if (id == NoNode)
+                return nullptr;
+            if (stack_low())
+                return ensure_stack([&] { return statement(id); });
+            uint32_t lhs = tree.lhs[id], rhs = tree.rhs[id];
+            switch (tree.kinds[id]) {
+                case Kind::Statements:
+                    return statements(id);
+                case Kind::Break:
+                    return make<Break>(id);
+                case Kind::Continue:
+                    return make<Continue>(id);
+                case Kind::Return:
+                    return make<Return>(id, exp(lhs));
+                case Kind::If:
+                    return make<If>(id, exp(lhs), statement(tree.extra[rhs]), statement(tree.extra[rhs + 1]));
+                case Kind::While:
+                    return make<While>(id, exp(lhs), statement(rhs));
+                case Kind::VarDecl:
+                    return make<VarDecl>(id, this->id(lhs), type(tree.extra[rhs]), exp(tree.extra[rhs + 1]));
+                case Kind::Assign:
+                    return make<Assign>(id, this->id(lhs), exp(rhs));
+                case Kind::Call:
+                    return call(id);
+                default:
+                    return nullptr;
+            }
+        }
+
+        Formals *formals(NodeId id) {
+            auto list = make<Formals>(id);
+            for (NodeId element : tree.elements(id))
+                list->push_back(make<Formal>(element, this->id(tree.lhs[element]), type(tree.rhs[element])));
+            return list;
+        }
+
+        // Without the body, the function builds it whenever it is visited
+        FuncDecl *func_decl(NodeId id, bool body);
+
+        Funcs *funcs(NodeId id, bool bodies) {
+            auto list = make<Funcs>(id);
+            for (NodeId element : tree.elements(id))
+                list->push_back(func_decl(element, bodies));
+            return list;
+        }
+
+        Node *node(NodeId id) {
+            switch (tree.kinds[id]) {
+                case Kind::Type:
+                    return type(id);
+                case Kind::ExpList:
+                    return exp_list(id);
+                case Kind::Formal:
+                    return make<Formal>(id, this->id(tree.lhs[id]), type(tree.rhs[id]));
+                case Kind::Formals:
+                    return formals(id);
+                case Kind::FuncDecl:
+                    return func_decl(id, true);
+                case Kind::Funcs:
+                    return funcs(id, true);
+                default:
+                    break;
+            }
+            if (Exp *exp = this->exp(id))
+                return exp;
+            return statement(id);
+        }
+
+    private:
+        const FlatTree &tree;
+        Arena &arena;
+    };
+
+    /* Function whose body is built in the arena only while the function is visited */
+    class DeferredFuncDecl : public FuncDecl {
+    public:
+        DeferredFuncDecl(ID *id, Type *return_type, Formals *formals, const FlatTree &tree, Arena &arena,
+                         NodeId body_id)
+                : FuncDecl(id, return_type, formals, nullptr), tree(tree), arena(arena), body_id(body_id) {}
+
+        void accept(Visitor &visitor) override {
+            accept(visitor, arena);
+        }
+
+        void accept(Visitor &visitor, Arena &body_arena) override {
+            Arena::Mark mark = body_arena.mark();
+            body = Expander(tree, body_arena).statements(body_id);
+            visitor.visit(*this);
+            body = nullptr;
+            body_arena.rewind(mark);
+        }
+
+    private:
+        const FlatTree &tree;
+        Arena &arena;
+        NodeId body_id;
+    };
+
+    FuncDecl *Expander::func_decl(NodeId id, bool body) {
+        const uint32_t *children = &tree.extra[tree.rhs[id]];
+        if (body)
+            return make<FuncDecl>(id, this->id(tree.lhs[id]), type(children[0]), formals(children[1]),
+                                  statements(children[2]));
+        return make<DeferredFuncDecl>(id, this->id(tree.lhs[id]), type(children[0]), formals(children[1]), tree,
+                                      arena, children[2]);
+    }
+
+    Node *FlatTree::expand(NodeId id, Arena &arena) const {
+        return Expander(*this, arena).node(id);
+    }
+
+    Funcs *FlatTree::expand_program(Arena &arena) const {
+        return Expander(*this, arena).funcs(root, false);
+    }
+}
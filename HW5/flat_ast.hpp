@@ -0,0 +1,102 @@
+#ifndef FLAT_AST_HPP
+#define FLAT_AST_HPP
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+#include "nodes.hpp"
+
+namespace ast {
+
+    /* Index of a node in a FlatTree */
+    using NodeId = uint32_t;
+
+    constexpr NodeId NoNode = UINT32_MAX;
+
+    /* FlatTree class
+     * The AST in a few dense arrays (struct of arrays): a node is an index into them, and refers to
+     * its children by their indices. What lhs and rhs hold depends on the kind of the node:
+     *   Num, NumB, Bool                    lhs: the value
+     *   ID                                 lhs: the SymbolId of the identifier
+     *   String                             lhs: the id in strings (strings keep their quotes)
+     *   BinOp, RelOp, And, Or              lhs, rhs: the operands. op: the BinOpType or RelOpType
+     *   Not                                lhs: the operand
+     *   Type                               op: the BuiltInType
+     *   Cast                               lhs: the expression, rhs: the target Type
+     *   Call                               lhs: the ID, rhs: the ExpList (empty without arguments)
+     *   Return                             lhs: the expression, NoNode without one
+     *   While                              lhs: the condition, rhs: the body
+     *   Assign, Formal                     lhs: the ID, rhs: the expression or the Type
+     *   If                                 lhs: the condition, rhs: index in extra of [then, otherwise]
+     *   VarDecl                            lhs: the ID, rhs: index in extra of [type, init expression]
+     *   FuncDecl                           lhs: the ID, rhs: index in extra of [return Type, Formals, Statements]
+     *   ExpList, Statements, Formals, Funcs    lhs, rhs: first and last cell of the list
+     * A list cell is a pair [element, next cell] in extra. Missing children are NoNode.
+     */
+    class FlatTree {
+    public:
+        // The Funcs node of the program
+        NodeId root = NoNode;
+
+        std::vector<Kind> kinds;
+        std::vector<uint8_t> ops;
+        std::vector<int> lines;
+        std::vector<uint32_t> lhs;
+        std::vector<uint32_t> rhs;
+        // Children that do not fit in lhs and rhs, and list cells
+        std::vector<uint32_t> extra;
+        // String literals, each distinct one stored once
+        Interner strings;
+
+        /* Building the tree, in the parser. Nodes get the current line of the scanner. */
+
+        // Line of the scanner, kept up to date by the scanner as it matches tokens
+        int line = 1;
+
+        NodeId node(Kind kind, uint32_t lhs = NoNode, uint32_t rhs = NoNode, uint8_t op = 0);
+
+        // A node whose rhs points to more children in extra
+        NodeId node(Kind kind, uint32_t lhs, std::initializer_list<NodeId> children);
+
+        // Num, NumB or Bool
+        NodeId literal(Kind kind, int value);
+
+        NodeId string(const char *text);
+
+        // An empty list
+        NodeId list(Kind kind);
+
+        void push_front(NodeId list, NodeId element);
+
+        void push_back(NodeId list, NodeId element);
+
+        /* Reading the tree */
+
+        size_t size() const {
+            return kinds.size();
+        }
+
+        // Bytes used by the tree
+        size_t memory() const;
+
+        // The elements of a list
+        std::vector<NodeId> elements(NodeId list) const;
+
+        /* Adapter for the visitors of nodes.hpp: builds the nodes of the tree in an arena */
+
+        // Builds the node and all the nodes below it
+        Node *expand(NodeId id, Arena &arena) const;
+
+        // Builds the program without the bodies of the functions. A body is built when its function
+        // accepts a visitor, and is dropped from the arena right after the visit. A function accepting a
+        // visitor with an arena builds its body there instead, so different functions may be visited on
+        // different threads, each with its own arena.
+        Funcs *expand_program(Arena &arena) const;
+    };
+}
+
+#define YYSTYPE ast::NodeId
+// A NodeId may be copied as bytes, which lets bison grow its stacks
+#define YYSTYPE_IS_TRIVIAL 1
+
+#endif //FLAT_AST_HPP
@@ -0,0 +1,23 @@
+#include "interner.hpp"
+
+namespace ast {
+
+    SymbolId Interner::intern(std::string_view str) {
+        auto found = ids.find(str);
+        if (found != ids.end())
+            return found->second;
+
+        auto id = static_cast<SymbolId>(names.size());
+        names.emplace_back(str);
+        ids.emplace(names.back(), id);
+        return id;
+    }
+
+    size_t Interner::memory() const {
+        size_t bytes = ids.bucket_count() * sizeof(void *) +
+                       ids.size() * (sizeof(std::pair<std::string_view, SymbolId>) + sizeof(void *));
+        for (const auto &name : names)
+            bytes += sizeof(std::string) + (name.capacity() > 15 ? name.capacity() + 1 : 0);
+        return bytes;
+    }
+}
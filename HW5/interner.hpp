@@ -0,0 +1,43 @@
+#ifndef INTERNER_HPP
+#define INTERNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ast {
+
+    /* Id of an interned string. Ids are dense: 0, 1, 2, ... in the order the strings were first seen. */
+    using SymbolId = uint32_t;
+
+    constexpr SymbolId NoSymbol = UINT32_MAX;
+
+    /* Interner class
+     * Stores every distinct string once and maps it to its id, so strings are compared and looked up
+     * as integers. The strings never move, so references returned by name() stay valid.
+     */
+    class Interner {
+    public:
+        SymbolId intern(std::string_view str);
+
+        const std::string &name(SymbolId id) const {
+            return names[id];
+        }
+
+        size_t size() const {
+            return names.size();
+        }
+
+        // Bytes used by the strings and the index
+        size_t memory() const;
+
+    private:
+        std::deque<std::string> names;
+        std::unordered_map<std::string_view, SymbolId> ids;
+    };
+}
+
+#endif //INTERNER_HPP
@@ -0,0 +1,482 @@
+#include "ir.hpp"
+
+// Branch weights of branches that are (almost) never taken
+#define UNLIKELY_WEIGHTS "!0"
+
+namespace ir {
+
+    Type pointer_to(Type type) {
+        switch (type) {
+            case Type::I1:
+                return Type::I1Ptr;
+            case Type::I8:
+                return Type::I8Ptr;
+            default:
+                return Type::I32Ptr;
+        }
+    }
+
+    Type pointee(Type type) {
+        switch (type) {
+            case Type::I1Ptr:
+                return Type::I1;
+            case Type::I8Ptr:
+                return Type::I8;
+            default:
+                return Type::I32;
+        }
+    }
+
+    /* Function class */
+
+    Function::Function(std::string name, Type return_type, std::vector<Type> params) :
+        name(std::move(name)), return_type(return_type), params(std::move(params)),
+        current(NoBlock), reg_count(0), alloca_count(0) {
+        place(new_block());
+    }
+
+    BlockId Function::new_block() {
+        blocks.emplace_back();
+        return blocks.size() - 1;
+    }
+
+    void Function::place(BlockId block) {
+        blocks[block].placed = true;
+        layout.push_back(block);
+        current = block;
+    }
+
+    void Function::set_insert_point(BlockId block) {
+        current = block;
+    }
+
+    Value Function::arg(size_t index) const {
+        return {Value::Kind::Arg, params[index], static_cast<int32_t>(index)};
+    }
+
+    Value Function::append(Instruction inst) {
+        Value result;
+        if (inst.type != Type::Void) {
+            result = {Value::Kind::Reg, inst.type, reg_count++};
+            defs.push_back(NoInst);
+        }
+        if (current == NoBlock)
+            return result;
+
+        InstId id = insts.size();
+        if (result.kind == Value::Kind::Reg)
+            defs[result.id] = id;
+        inst.result = result;
+        insts.push_back(std::move(inst));
+        blocks[current].insts.push_back(id);
+        return result;
+    }
+
+    Value Function::binop(Opcode op, Value left, Value right) {
+        return append({op, left.type, Predicate::Eq, false, {}, {left, right}});
+    }
+
+    Value Function::icmp(Predicate pred, Value left, Value right) {
+        return append({Opcode::ICmp, Type::I1, pred, false, {}, {left, right}});
+    }
+
+    Value Function::zext(Value value, Type type) {
+        return append({Opcode::ZExt, type, Predicate::Eq, false, {}, {value}});
+    }
+
+    Value Function::trunc(Value value, Type type) {
+        return append({Opcode::Trunc, type, Predicate::Eq, false, {}, {value}});
+    }
+
+    Value Function::alloca(Type type) {
+        // Also emitted in code that can never run: the slot may be used by later code
+        Value result = {Value::Kind::Reg, pointer_to(type), reg_count++};
+        InstId id = insts.size();
+        defs.push_back(id);
+        insts.push_back({Opcode::Alloca, result.type, Predicate::Eq, false, result});
+        auto &entry = blocks[0].insts;
+        entry.insert(entry.begin() + alloca_count++, id);
+        return result;
+    }
+
+    Value Function::load(Value address) {
+        return append({Opcode::Load, pointee(address.type), Predicate::Eq, false, {}, {address}});
+    }
+
+    void Function::store(Value value, Value address) {
+        append({Opcode::Store, Type::Void, Predicate::Eq, false, {}, {value, address}});
+    }
+
+    Value Function::add_string(const std::string &str) {
+        auto known = string_ids.emplace(str, static_cast<int32_t>(strings.size()));
+        if (known.second)
+            strings.push_back(str);
+        return {Value::Kind::Global, Type::I8Ptr, known.first->second};
+    }
+
+    Value Function::str_ptr(Value str) {
+        return append({Opcode::StrPtr, Type::I8Ptr, Predicate::Eq, false, {}, {str}});
+    }
+
+    Value Function::call(Type return_type, const std::string &callee, const std::vector<Value> &args) {
+        return append({Opcode::Call, return_type, Predicate::Eq, false, {}, args, {}, callee});
+    }
+
+    Value Function::phi(Type type) {
+        return append({Opcode::Phi, type});
+    }
+
+    void Function::add_incoming(Value phi, Value value, BlockId block) {
+        if (defs[phi.id] == NoInst)
+            return;
+        InstId id = defs[phi.id];
+        insts[id].operands.push_back(value);
+        insts[id].targets.push_back(block);
+    }
+
+    void Function::br(BlockId target) {
+        append({Opcode::Br, Type::Void, Predicate::Eq, false, {}, {}, {target}});
+    }
+
+    void Function::cond_br(Value cond, BlockId if_true, BlockId if_false, bool unlikely) {
+        append({Opcode::CondBr, Type::Void, Predicate::Eq, unlikely, {}, {cond}, {if_true, if_false}});
+    }
+
+    void Function::ret(Value value) {
+        append({Opcode::Ret, Type::Void, Predicate::Eq, false, {}, {value}});
+    }
+
+    void Function::ret_void() {
+        append({Opcode::Ret});
+    }
+
+    void Function::unreachable() {
+        append({Opcode::Unreachable});
+    }
+
+    /* Module class */
+
+    std::vector<int32_t> Module::link(const Function &func) {
+        std::vector<int32_t> ids;
+        ids.reserve(func.strings.size());
+        for (const std::string &str : func.strings) {
+            auto known = string_ids.find(str);
+            if (known != string_ids.end()) {
+                ids.push_back(known->second);
+                continue;
+            }
+            ids.push_back(static_cast<int32_t>(strings.size()));
+            strings.push_back(str);
+            string_ids.emplace(strings.back(), ids.back());
+        }
+        return ids;
+    }
+
+    /* Passes */
+
+    void thread_jumps(Function &func) {
+        std::vector<bool> phi_pred(func.blocks.size()), has_phi(func.blocks.size());
+        for (BlockId block : func.layout) {
+            for (InstId id : func.blocks[block].insts) {
+                const Instruction &inst = func.insts[id];
+                if (inst.op != Opcode::Phi)
+                    continue;
+                has_phi[block] = true;
+                for (BlockId pred : inst.targets)
+                    phi_pred[pred] = true;
+            }
+        }
+
+        std::vector<BlockId> forward(func.blocks.size(), NoBlock);
+        auto resolve = [&forward](BlockId block) {
+            while (forward[block] != NoBlock)
+                block = forward[block];
+            return block;
+        };
+        bool changed = false;
+        for (size_t i = 1; i < func.layout.size(); i++) {
+            BlockId block = func.layout[i];
+            const auto &insts = func.blocks[block].insts;
+            if (insts.size() != 1 || func.insts[insts[0]].op != Opcode::Br || phi_pred[block])
+                continue;
+            BlockId target = resolve(func.insts[insts[0]].targets[0]);
+            // An empty infinite loop keeps one of its blocks
+            if (target == block || has_phi[target])
+                continue;
+            forward[block] = target;
+            changed = true;
+        }
+        if (!changed)
+            return;
+
+        std::vector<BlockId> layout;
+        for (BlockId block : func.layout) {
+            if (forward[block] != NoBlock) {
+                func.blocks[block].placed = false;
+                continue;
+            }
+            layout.push_back(block);
+            if (func.blocks[block].insts.empty())
+                continue;
+            Instruction &term = func.insts[func.blocks[block].insts.back()];
+            if (term.is_terminator()) {
+                for (auto &target : term.targets)
+                    target = resolve(target);
+            }
+        }
+        func.layout = std::move(layout);
+    }
+
+    /* Printer */
+
+    static const char *type_name(Type type) {
+        switch (type) {
+            case Type::Void:
+                return "void";
+            case Type::I1:
+                return "i1";
+            case Type::I8:
+                return "i8";
+            case Type::I32:
+                return "i32";
+            case Type::I1Ptr:
+                return "i1*";
+            case Type::I8Ptr:
+                return "i8*";
+            case Type::I32Ptr:
+                return "i32*";
+        }
+        return "void";
+    }
+
+    static const char *predicate_name(Predicate pred) {
+        switch (pred) {
+            case Predicate::Eq:
+                return "eq";
+            case Predicate::Ne:
+                return "ne";
+            case Predicate::Slt:
+                return "slt";
+            case Predicate::Sgt:
+                return "sgt";
+            case Predicate::Sle:
+                return "sle";
+            case Predicate::Sge:
+                return "sge";
+            case Predicate::Ult:
+                return "ult";
+            case Predicate::Ugt:
+                return "ugt";
+            case Predicate::Ule:
+                return "ule";
+            case Predicate::Uge:
+                return "uge";
+        }
+        return "eq";
+    }
+
+    // Global strings are printed with their number in string_ids, indexed by their number in the function
+    static void print_value(output::OutputBuffer &out, const Value &value, const std::vector<int32_t> &string_ids) {
+        switch (value.kind) {
+            case Value::Kind::None:
+                out << "undef";
+                break;
+            case Value::Kind::Const:
+                if (value.type == Type::I1)
+                    out << (value.id ? "true" : "false");
+                else
+                    out << value.id;
+                break;
+            case Value::Kind::Reg:
+                out << "%t" << value.id;
+                break;
+            case Value::Kind::Arg:
+                out << "%" << value.id;
+                break;
+            case Value::Kind::Global:
+                out << "@.str" << string_ids[value.id];
+                break;
+        }
+    }
+
+    static void print_typed(output::OutputBuffer &out, const Value &value, const std::vector<int32_t> &string_ids) {
+        out << type_name(value.type) << " ";
+        print_value(out, value, string_ids);
+    }
+
+    static void print_label(output::OutputBuffer &out, BlockId block) {
+        if (block == 0)
+            out << "%entry";
+        else
+            out << "%label_" << block;
+    }
+
+    static void print_instruction(output::OutputBuffer &out, const Function &func, const Instruction &inst,
+                                  const std::vector<int32_t> &string_ids) {
+        const std::vector<Value> &ops = inst.operands;
+        if (inst.result.kind == Value::Kind::Reg) {
+            print_value(out, inst.result, string_ids);
+            out << " = ";
+        }
+
+        switch (inst.op) {
+            case Opcode::Add:
+            case Opcode::Sub:
+            case Opcode::Mul:
+            case Opcode::SDiv:
+            case Opcode::UDiv:
+            case Opcode::Xor: {
+                static const char *names[] = {"add", "sub", "mul", "sdiv", "udiv", "xor"};
+                out << names[static_cast<int>(inst.op)] << " ";
+                print_typed(out, ops[0], string_ids);
+                out << ", ";
+                print_value(out, ops[1], string_ids);
+                break;
+            }
+            case Opcode::ICmp:
+                out << "icmp " << predicate_name(inst.pred) << " ";
+                print_typed(out, ops[0], string_ids);
+                out << ", ";
+                print_value(out, ops[1], string_ids);
+                break;
+            case Opcode::ZExt:
+            case Opcode::Trunc:
+                out << (inst.op == Opcode::ZExt ? "zext " : "trunc ");
+                print_typed(out, ops[0], string_ids);
+                out << " to " << type_name(inst.type);
+                break;
+            case Opcode::Alloca:
+                out << "alloca " << type_name(pointee(inst.type));
+                break;
+            case Opcode::Load:
+                out << "load " << type_name(inst.type) << ", ";
+                print_typed(out, ops[0], string_ids);
+                break;
+            case Opcode::Store:
+                out << "store ";
+                print_typed(out, ops[0], string_ids);
+                out << ", ";
+                print_typed(out, ops[1], string_ids);
+                break;
+            case Opcode::StrPtr: {
+                size_t len = func.strings[ops[0].id].length() + 1;
+                out << "getelementptr [" << len << " x i8], [" << len << " x i8]* ";
+                print_value(out, ops[0], string_ids);
+                out << ", i32 0, i32 0";
+                break;
+            }
+            case Opcode::Call:
+                out << "call " << type_name(inst.type) << " @" << inst.callee << "(";
+                for (size_t i = 0; i < ops.size(); i++) {
+                    if (i > 0) out << ", ";
+                    print_typed(out, ops[i], string_ids);
+                }
+                out << ")";
+                break;
+            case Opcode::Phi:
+                out << "phi " << type_name(inst.type) << " ";
+                for (size_t i = 0; i < ops.size(); i++) {
+                    if (i > 0) out << ", ";
+                    out << "[ ";
+                    print_value(out, ops[i], string_ids);
+                    out << ", ";
+                    print_label(out, inst.targets[i]);
+                    out << " ]";
+                }
+                break;
+            case Opcode::Br:
+                out << "br label ";
+                print_label(out, inst.targets[0]);
+                break;
+            case Opcode::CondBr:
+                out << "br ";
+                print_typed(out, ops[0], string_ids);
+                out << ", label ";
+                print_label(out, inst.targets[0]);
+                out << ", label ";
+                print_label(out, inst.targets[1]);
+                if (inst.unlikely)
+                    out << ", !prof " << UNLIKELY_WEIGHTS;
+                break;
+            case Opcode::Ret:
+                out << "ret ";
+                if (ops.empty())
+                    out << "void";
+                else
+                    print_typed(out, ops[0], string_ids);
+                break;
+            case Opcode::Unreachable:
+                out << "unreachable";
+                break;
+        }
+    }
+
+    static void print_code(output::OutputBuffer &out, const Function &func, const std::vector<int32_t> &string_ids) {
+        out << "define " << type_name(func.return_type) << " @" << func.name << "(";
+        for (size_t i = 0; i < func.params.size(); i++) {
+            if (i > 0) out << ", ";
+            out << type_name(func.params[i]);
+        }
+        out << ") {\n";
+
+        for (BlockId block : func.layout) {
+            if (block == 0)
+                out << "entry:\n";
+            else
+                out << "label_" << block << ":\n";
+            for (InstId id : func.blocks[block].insts) {
+                out << "\t";
+                print_instruction(out, func, func.insts[id], string_ids);
+                out << "\n";
+            }
+        }
+        out << "}\n\n";
+    }
+
+    // Writes the text of a function, renumbering its strings
+    static void relink(output::OutputBuffer &out, const std::string &text, const std::vector<int32_t> &string_ids) {
+        static const char REFERENCE[] = "@.str";
+        const size_t length = sizeof(REFERENCE) - 1;
+        size_t done = 0;
+        for (size_t at = text.find(REFERENCE); at != std::string::npos; at = text.find(REFERENCE, done)) {
+            size_t digits = at + length;
+            size_t id = 0;
+            for (; digits < text.size() && text[digits] >= '0' && text[digits] <= '9'; digits++)
+                id = id * 10 + (text[digits] - '0');
+            out.append(text.data() + done, at + length - done);
+            out << string_ids[id];
+            done = digits;
+        }
+        out.append(text.data() + done, text.size() - done);
+    }
+
+    void print_function(output::OutputBuffer &out, Module &module, const Function &func) {
+        std::vector<int32_t> string_ids = module.link(func);
+        if (!func.text.empty())
+            relink(out, func.text, string_ids);
+        else
+            print_code(out, func, string_ids);
+    }
+
+    void print_fragment(output::OutputBuffer &out, const Function &func) {
+        std::vector<int32_t> string_ids(func.strings.size());
+        for (size_t i = 0; i < string_ids.size(); i++)
+            string_ids[i] = static_cast<int32_t>(i);
+        print_code(out, func, string_ids);
+    }
+
+    void print_trailer(output::OutputBuffer &out, const Module &module) {
+        for (size_t i = 0; i < module.strings.size(); i++) {
+            const std::string &str = module.strings[i];
+            out << "@.str" << i << " = constant [" << str.length() + 1 << " x i8] c\"" << str << "\\00\"\n";
+        }
+        out << UNLIKELY_WEIGHTS << " = !{!\"branch_weights\", i32 1, i32 1048575}\n";
+    }
+
+    void print(output::OutputBuffer &out, Module &module) {
+        out << module.prelude;
+        for (const auto &func : module.functions)
+            print_function(out, module, func);
+        print_trailer(out, module);
+    }
+}
@@ -0,0 +1,260 @@
+#ifndef IR_HPP
+#define IR_HPP
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "out_buffer.hpp"
+
+namespace ir {
+
+    /* Types of IR values */
+    enum class Type : uint8_t {
+        Void,
+        I1,
+        I8,
+        I32,
+        // Pointers: stack slots and strings
+        I1Ptr,
+        I8Ptr,
+        I32Ptr
+    };
+
+    Type pointer_to(Type type);
+
+    Type pointee(Type type);
+
+    /* Handle of a value: a constant, the result of an instruction, an argument of the function
+     * or a global string. Handles are small and compared by value.
+     */
+    struct Value {
+        enum class Kind : uint8_t {
+            None,
+            Const,
+            Reg,
+            Arg,
+            Global
+        };
+
+        Kind kind = Kind::None;
+        Type type = Type::Void;
+        // Value of a constant, number of a register, index of an argument, or index of a global string
+        // in the strings of its function
+        int32_t id = 0;
+
+        static Value constant(Type type, int32_t value) {
+            return {Kind::Const, type, value};
+        }
+
+        bool is_const() const {
+            return kind == Kind::Const;
+        }
+
+        bool operator==(const Value &other) const {
+            return kind == other.kind && type == other.type && id == other.id;
+        }
+
+        bool operator!=(const Value &other) const {
+            return !(*this == other);
+        }
+    };
+
+    using BlockId = uint32_t;
+    using InstId = uint32_t;
+
+    // Insertion point of code that can never run: instructions emitted there are dropped
+    constexpr BlockId NoBlock = UINT32_MAX;
+    constexpr InstId NoInst = UINT32_MAX;
+
+    enum class Opcode : uint8_t {
+        Add,
+        Sub,
+        Mul,
+        SDiv,
+        UDiv,
+        Xor,
+        ICmp,
+        ZExt,
+        Trunc,
+        Alloca,
+        Load,
+        Store,
+        // Pointer to the first character of a global string
+        StrPtr,
+        Call,
+        Phi,
+        Br,
+        CondBr,
+        Ret,
+        Unreachable
+    };
+
+    enum class Predicate : uint8_t {
+        Eq,
+        Ne,
+        Slt,
+        Sgt,
+        Sle,
+        Sge,
+        Ult,
+        Ugt,
+        Ule,
+        Uge
+    };
+
+    struct Instruction {
+        Opcode op;
+        // Type of the result, Void for instructions without one
+        Type type = Type::Void;
+        Predicate pred = Predicate::Eq;
+        // CondBr whose true edge is (almost) never taken
+        bool unlikely = false;
+        Value result;
+        // Phi: the incoming values, in the order of targets
+        std::vector<Value> operands;
+        // Br/CondBr: the successors. Phi: the incoming blocks.
+        std::vector<BlockId> targets;
+        // Call: name of the called function
+        std::string callee;
+
+        bool is_terminator() const {
+            return op == Opcode::Br || op == Opcode::CondBr || op == Opcode::Ret || op == Opcode::Unreachable;
+        }
+    };
+
+    struct Block {
+        std::vector<InstId> insts;
+        // Whether the block is part of the layout of the function
+        bool placed = false;
+    };
+
+    /* Function class
+     * Holds the instructions of a function in blocks, and builds them: every instruction is appended
+     * at the insertion point, which is the block placed last. Block 0 is the entry block.
+     * Registers, blocks and strings are numbered in the function alone, so its code does not depend
+     * on the other functions of the module: the strings get their global numbers when it is printed.
+     */
+    class Function {
+    public:
+        std::string name;
+        Type return_type;
+        std::vector<Type> params;
+
+        std::vector<Instruction> insts;
+        std::vector<Block> blocks;
+        // Order of the placed blocks in the output, entry first
+        std::vector<BlockId> layout;
+        // Defining instruction of each register (NoInst if it was dropped)
+        std::vector<InstId> defs;
+        // Global strings used by the function, each distinct one once
+        std::vector<std::string> strings;
+        // Code of the function already printed by print_fragment(), e.g. taken from a cache. A function
+        // with text has no instructions.
+        std::string text;
+
+        Function(std::string name, Type return_type, std::vector<Type> params);
+
+        // Returns a new block, which is not part of the function until it is placed
+        BlockId new_block();
+
+        // Appends the block to the layout and moves the insertion point to it
+        void place(BlockId block);
+
+        // Moves the insertion point, NoBlock drops the instructions emitted from now on
+        void set_insert_point(BlockId block);
+
+        BlockId insert_block() const {
+            return current;
+        }
+
+        Value arg(size_t index) const;
+
+        Value binop(Opcode op, Value left, Value right);
+
+        Value icmp(Predicate pred, Value left, Value right);
+
+        Value zext(Value value, Type type);
+
+        Value trunc(Value value, Type type);
+
+        // Allocates a stack slot in the entry block, wherever the insertion point is
+        Value alloca(Type type);
+
+        Value load(Value address);
+
+        void store(Value value, Value address);
+
+        // Adds a global constant string, returns a Global value of it
+        Value add_string(const std::string &str);
+
+        Value str_ptr(Value str);
+
+        // Returns the result of the call, a None value for a void function
+        Value call(Type return_type, const std::string &callee, const std::vector<Value> &args);
+
+        // Returns a phi without incoming values, they are added with add_incoming()
+        Value phi(Type type);
+
+        void add_incoming(Value phi, Value value, BlockId block);
+
+        void br(BlockId target);
+
+        void cond_br(Value cond, BlockId if_true, BlockId if_false, bool unlikely = false);
+
+        void ret(Value value);
+
+        void ret_void();
+
+        void unreachable();
+
+    private:
+        BlockId current;
+        int32_t reg_count;
+        // Number of allocas at the start of the entry block
+        size_t alloca_count;
+        // Index of each string in strings
+        std::unordered_map<std::string, int32_t> string_ids;
+
+        Value append(Instruction inst);
+    };
+
+    /* A whole program: global strings, the runtime written directly in LLVM, and the functions */
+    class Module {
+    public:
+        // Declarations and definitions that are printed as is before the functions
+        std::string prelude;
+        // Strings of the functions printed so far, each distinct one once, numbered in the order they
+        // were first printed. A deque never moves them, string_ids refers to them.
+        std::deque<std::string> strings;
+        std::vector<Function> functions;
+
+        // Adds the strings of a function to the strings of the module, returns the global number of each
+        std::vector<int32_t> link(const Function &func);
+
+    private:
+        std::unordered_map<std::string_view, int32_t> string_ids;
+    };
+
+    // Removes the blocks whose only instruction is a jump to another block, jumping there directly
+    // instead. A block that is an incoming block of a phi, or jumps to a block with phis, is kept.
+    void thread_jumps(Function &func);
+
+    // Writes the module as LLVM assembly: the prelude, the functions, then the global strings
+    // (LLVM allows globals to be used before they are defined)
+    void print(output::OutputBuffer &out, Module &module);
+
+    // Parts of print(), to write a module one function at a time. print_function() links the strings
+    // of the function into the module.
+    void print_function(output::OutputBuffer &out, Module &module, const Function &func);
+
+    void print_trailer(output::OutputBuffer &out, const Module &module);
+
+    // Writes the function with its strings numbered as in the function, which print_function() renumbers
+    // when the function is given the text
+    void print_fragment(output::OutputBuffer &out, const Function &func);
+}
+
+#endif //IR_HPP
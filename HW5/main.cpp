@@ -1,19 +1,52 @@
-#include "output.hpp"
-#include "nodes.hpp"
+#include "fanc.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <memory>
 
-// Extern from the bison-generated parser
-extern int yyparse();
+/* Usage: hw5 [--check] [--ssa] [--stats] [--stream] [--threads N] [--cache DIR] [--cache-size MIB] [--cache-stats] < program
+ * The cache directory may also be given in $FANC_CACHE_DIR. With --check the program is only checked,
+ * and only an error is printed.
+ */
+int main(int argc, char* argv[]) {
+    fanc::Options options;
+    const char *cache_dir = std::getenv("FANC_CACHE_DIR");
+    uint64_t cache_size = fanc::CompileCache::DEFAULT_MAX_BYTES;
+    bool cache_stats = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--check") == 0)
+            options.check = true;
+        else if (std::strcmp(argv[i], "--ssa") == 0)
+            options.ssa = true;
+        else if (std::strcmp(argv[i], "--stats") == 0)
+            options.stats = true;
+        else if (std::strcmp(argv[i], "--stream") == 0)
+            options.stream = true;
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            options.threads = std::max(1, std::atoi(argv[++i]));
+        else if (std::strcmp(argv[i], "--cache") == 0 && i + 1 < argc)
+            cache_dir = argv[++i];
+        else if (std::strcmp(argv[i], "--cache-size") == 0 && i + 1 < argc)
+            cache_size = std::strtoull(argv[++i], nullptr, 10) << 20;
+        else if (std::strcmp(argv[i], "--cache-stats") == 0)
+            cache_stats = true;
+    }
+    std::unique_ptr<fanc::CompileCache> cache;
+    if (cache_dir != nullptr && *cache_dir != '\0')
+        cache.reset(new fanc::CompileCache(cache_dir, cache_size));
 
-extern std::shared_ptr<ast::Node> program;
+    std::string source;
+    char chunk[64 * 1024];
+    size_t len;
+    while ((len = std::fread(chunk, 1, sizeof(chunk), stdin)) > 0)
+        source.append(chunk, len);
 
-int main() {
-    // Parse the input. The result is stored in the global variable `program`
-    yyparse();
-
-    // Print the AST using the PrintVisitor
-    output::MyVisitor visitor;
-    program->accept(visitor);
-
-    visitor.print_buf();
+    // The code goes straight to stdout, an error in the program is printed instead
+    fanc::Result result = cache ? fanc::compile(source, options, STDOUT_FILENO, *cache)
+                                : fanc::compile(source, options, STDOUT_FILENO);
+    std::cout << result.diagnostics;
+    if (cache && cache_stats)
+        std::cerr << cache->report();
 }
@@ -1,111 +1,121 @@
 #include "nodes.hpp"
 #include <string>
-#include <utility>
-
-extern int yylineno;
 
 namespace ast {
 
-    Node::Node() : line(yylineno) {}
+    Node::Node(Kind kind) : line(0), tree_id(UINT32_MAX), kind(kind) {}
+
+    Num::Num(const char *str) : Node(KIND), Exp(), value(std::stoi(str)) {}
 
-    Num::Num(const char *str) : Exp(), value(std::stoi(str)) {}
+    Num::Num(int value) : Node(KIND), Exp(), value(value) {}
 
-    NumB::NumB(const char *str) : Exp(), value(std::stoi(str)) {}
+    NumB::NumB(const char *str) : Node(KIND), Exp(), value(std::stoi(str)) {}
 
-    String::String(const char *str) : Exp(), value(str) {
+    NumB::NumB(int value) : Node(KIND), Exp(), value(value) {}
+
+    String::String(const char *str) : Node(KIND), Exp(), value(str) {
         // Remove the quotes
         value = value.substr(1, value.size() - 2);
     }
 
-    Bool::Bool(bool value) : Exp(), value(value) {}
+    Bool::Bool(bool value) : Node(KIND), Exp(), value(value) {}
+
+    ID::ID(SymbolId symbol) : Node(KIND), Exp(), symbol(symbol) {}
 
-    ID::ID(const char *str) : Exp(), value(str) {}
+    BinOp::BinOp(Exp *left, Exp *right, BinOpType op)
+            : Node(KIND), Exp(), left(left), right(right), op(op) {}
 
-    BinOp::BinOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, BinOpType op)
-            : Exp(), left(std::move(left)), right(std::move(right)), op(op) {}
+    RelOp::RelOp(Exp *left, Exp *right, RelOpType op)
+            : Node(KIND), Exp(), left(left), right(right), op(op) {}
 
-    RelOp::RelOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, RelOpType op)
-            : Exp(), left(std::move(left)), right(std::move(right)), op(op) {}
+    Type::Type(BuiltInType type) : Node(KIND), type(type) {}
 
-    Type::Type(BuiltInType type) : Node(), type(type) {}
+    Cast::Cast(Exp *exp, Type *target_type)
+            : Node(KIND), Exp(), exp(exp), target_type(target_type) {}
 
-    Cast::Cast(std::shared_ptr<Exp> exp, std::shared_ptr<Type> target_type)
-            : Exp(), exp(std::move(exp)), target_type(std::move(target_type)) {}
+    Not::Not(Exp *exp) : Node(KIND), Exp(), exp(exp) {}
 
-    Not::Not(std::shared_ptr<Exp> exp) : Exp(), exp(std::move(exp)) {}
+    And::And(Exp *left, Exp *right)
+            : Node(KIND), Exp(), left(left), right(right) {}
 
-    And::And(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right)
-            : Exp(), left(std::move(left)), right(std::move(right)) {}
+    Or::Or(Exp *left, Exp *right)
+            : Node(KIND), Exp(), left(left), right(right) {}
 
-    Or::Or(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right)
-            : Exp(), left(std::move(left)), right(std::move(right)) {}
+    ExpList::ExpList() : Node(KIND) {}
 
-    ExpList::ExpList(std::shared_ptr<Exp> exp) : Node(), exps({std::move(exp)}) {}
+    ExpList::ExpList(Exp *exp) : Node(KIND), exps({exp}) {}
 
-    void ExpList::push_front(const std::shared_ptr<Exp> &exp) {
+    void ExpList::push_front(Exp *exp) {
         exps.insert(exps.begin(), exp);
     }
 
-    void ExpList::push_back(const std::shared_ptr<Exp> &exp) {
+    void ExpList::push_back(Exp *exp) {
         exps.push_back(exp);
     }
 
-    Call::Call(std::shared_ptr<ID> func_id, std::shared_ptr<ExpList> args)
-            : Exp(), func_id(std::move(func_id)), args(std::move(args)) {}
+    Call::Call(ID *func_id, ExpList *args)
+            : Node(KIND), Exp(), func_id(func_id), args(args) {}
 
-    Call::Call(std::shared_ptr<ID> func_id)
-            : Exp(), func_id(std::move(func_id)), args(std::make_shared<ExpList>()) {}
+    Statements::Statements() : Node(KIND), Statement() {}
 
-    Statements::Statements(std::shared_ptr<Statement> statement) : Statement(), statements({std::move(statement)}) {}
+    Statements::Statements(Statement *statement) : Node(KIND), Statement(), statements({statement}) {}
 
-    void Statements::push_front(const std::shared_ptr<Statement> &statement) {
+    void Statements::push_front(Statement *statement) {
         statements.insert(statements.begin(), statement);
     }
 
-    void Statements::push_back(const std::shared_ptr<Statement> &statement) {
+    void Statements::push_back(Statement *statement) {
         statements.push_back(statement);
     }
 
-    Return::Return(std::shared_ptr<Exp> exp) : Statement(), exp(std::move(exp)) {}
+    Break::Break() : Node(KIND), Statement() {}
 
-    If::If(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> then, std::shared_ptr<Statement> otherwise)
-            : Statement(), condition(std::move(condition)), then(std::move(then)), otherwise(std::move(otherwise)) {}
+    Continue::Continue() : Node(KIND), Statement() {}
 
-    While::While(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> body)
-            : Statement(), condition(std::move(condition)),
-              body(std::move(body)) {}
+    Return::Return(Exp *exp) : Node(KIND), Statement(), exp(exp) {}
 
-    VarDecl::VarDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> type, std::shared_ptr<Exp> init_exp)
-            : Statement(), id(std::move(std::move(id))), type(std::move(type)), init_exp(std::move(init_exp)) {}
+    If::If(Exp *condition, Statement *then, Statement *otherwise)
+            : Node(KIND), Statement(), condition(condition), then(then), otherwise(otherwise) {}
 
-    Assign::Assign(std::shared_ptr<ID> id, std::shared_ptr<Exp> exp)
-            : Statement(), id(std::move(id)), exp(std::move(exp)) {}
+    While::While(Exp *condition, Statement *body)
+            : Node(KIND), Statement(), condition(condition),
+              body(body) {}
 
-    Formal::Formal(std::shared_ptr<ID> id, std::shared_ptr<Type> type)
-            : Node(), id(std::move(id)), type(std::move(type)) {}
+    VarDecl::VarDecl(ID *id, Type *type, Exp *init_exp)
+            : Node(KIND), Statement(), id(id), type(type), init_exp(init_exp) {}
 
-    Formals::Formals(std::shared_ptr<Formal> formal) : Node(), formals({std::move(formal)}) {}
+    Assign::Assign(ID *id, Exp *exp)
+            : Node(KIND), Statement(), id(id), exp(exp) {}
 
-    void Formals::push_front(const std::shared_ptr<Formal> &formal) {
+    Formal::Formal(ID *id, Type *type)
+            : Node(KIND), id(id), type(type) {}
+
+    Formals::Formals() : Node(KIND) {}
+
+    Formals::Formals(Formal *formal) : Node(KIND), formals({formal}) {}
+
+    void Formals::push_front(Formal *formal) {
         formals.insert(formals.begin(), formal);
     }
 
-    void Formals::push_back(const std::shared_ptr<Formal> &formal) {
+    void Formals::push_back(Formal *formal) {
         formals.push_back(formal);
     }
 
-    FuncDecl::FuncDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> return_type, std::shared_ptr<Formals> formals,
-                       std::shared_ptr<Statements> body)
-            : Node(), id(std::move(id)), return_type(std::move(return_type)), formals(std::move(formals)),
-              body(std::move(body)) {}
+    FuncDecl::FuncDecl(ID *id, Type *return_type, Formals *formals,
+                       Statements *body)
+            : Node(KIND), id(id), return_type(return_type), formals(formals),
+              body(body) {}
+
+    Funcs::Funcs() : Node(KIND) {}
 
-    Funcs::Funcs(std::shared_ptr<FuncDecl> func) : Node(), funcs({std::move(func)}) {}
+    Funcs::Funcs(FuncDecl *func) : Node(KIND), funcs({func}) {}
 
-    void Funcs::push_front(const std::shared_ptr<FuncDecl> &func) {
+    void Funcs::push_front(FuncDecl *func) {
         funcs.insert(funcs.begin(), func);
     }
 
-    void Funcs::push_back(const std::shared_ptr<FuncDecl> &func) {
+    void Funcs::push_back(FuncDecl *func) {
         funcs.push_back(func);
     }
 
@@ -2,9 +2,14 @@
 #define NODES_HPP
 
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 #include "visitor.hpp"
+#include "ir.hpp"
+#include "arena.hpp"
+#include "interner.hpp"
+#include "stack_guard.hpp"
 
 namespace ast {
 
@@ -35,16 +40,59 @@ namespace ast {
         STRING
     };
 
+    /* Kinds of nodes, one for each class below. A node knows its kind, so it can be told apart from the
+     * others (and visited) with a switch, without RTTI or a virtual call.
+     */
+    enum class Kind : uint8_t {
+        Num,
+        NumB,
+        String,
+        Bool,
+        ID,
+        BinOp,
+        RelOp,
+        Not,
+        And,
+        Or,
+        Type,
+        Cast,
+        ExpList,
+        Call,
+        Statements,
+        Break,
+        Continue,
+        Return,
+        If,
+        While,
+        VarDecl,
+        Assign,
+        Formal,
+        Formals,
+        FuncDecl,
+        Funcs
+    };
+
     /* Base class for all AST nodes */
     class Node {
     public:
         // Line number in the source code
         int line;
 
-        std::string var_name;
+        // Index of the node in the FlatTree it was built from, where its annotations are (see sema.hpp)
+        uint32_t tree_id;
+
+        // Value computed by the code generated for the node
+        ir::Value ir_value;
+
+        // Value of the expression if it is known at compile time. Only set for expressions
+        // without side effects, so the code computing them may be dropped.
+        std::optional<int> const_value;
 
-        // Use this constructor only while parsing in bison or flex
-        Node();
+        // Kind of the node, the class it is an object of
+        const Kind kind;
+
+        // The line and the tree id are set by whoever builds the node
+        explicit Node(Kind kind);
 
         // Accept method for visitor pattern
         virtual void accept(Visitor &visitor) = 0;
@@ -52,23 +100,31 @@ namespace ast {
 
     /* Base class for all expressions */
     class Exp : virtual public Node {
-    public:
-        Exp() = default;
+    protected:
+        // Node is a virtual base, so the class of the node initializes it
+        Exp() {}
     };
 
     /* Base class for all statements */
     class Statement : virtual public Node {
+    protected:
+        Statement() {}
     };
 
     /* Number literal */
     class Num : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Num;
+
         // Value of the number
         int value;
 
         // Constructor that receives a C-style string that represents the number
         explicit Num(const char *str);
 
+        // Constructor that receives the value of the number
+        explicit Num(int value);
+
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
@@ -77,12 +133,17 @@ namespace ast {
     /* Byte literal */
     class NumB : public Exp {
     public:
+        static constexpr Kind KIND = Kind::NumB;
+
         // Value of the number
         int value;
 
         // Constructor that receives a C-style (including b character) string that represents the number
         explicit NumB(const char *str);
 
+        // Constructor that receives the value of the number
+        explicit NumB(int value);
+
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
@@ -91,6 +152,8 @@ namespace ast {
     /* String literal */
     class String : public Exp {
     public:
+        static constexpr Kind KIND = Kind::String;
+
         // Value of the string
         std::string value;
 
@@ -105,6 +168,8 @@ namespace ast {
     /* Boolean literal */
     class Bool : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Bool;
+
         // Value of the boolean
         bool value;
 
@@ -119,11 +184,13 @@ namespace ast {
     /* Identifier */
     class ID : public Exp {
     public:
-        // Name of the identifier
-        std::string value;
+        static constexpr Kind KIND = Kind::ID;
+
+        // The identifier, interned in the symbols of the compilation
+        SymbolId symbol;
 
-        // Constructor that receives a C-style string that represents the identifier
-        explicit ID(const char *str);
+        // Constructor that receives the interned identifier
+        explicit ID(SymbolId symbol);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -133,15 +200,17 @@ namespace ast {
     /* Binary arithmetic operation */
     class BinOp : public Exp {
     public:
+        static constexpr Kind KIND = Kind::BinOp;
+
         // Left operand
-        std::shared_ptr<Exp> left;
+        Exp *left;
         // Right operand
-        std::shared_ptr<Exp> right;
+        Exp *right;
         // Operation
         BinOpType op;
 
         // Constructor that receives the left and right operands and the operation
-        BinOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, BinOpType op);
+        BinOp(Exp *left, Exp *right, BinOpType op);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -151,15 +220,17 @@ namespace ast {
     /* Binary relational operation */
     class RelOp : public Exp {
     public:
+        static constexpr Kind KIND = Kind::RelOp;
+
         // Left operand
-        std::shared_ptr<Exp> left;
+        Exp *left;
         // Right operand
-        std::shared_ptr<Exp> right;
+        Exp *right;
         // Operation
         RelOpType op;
 
         // Constructor that receives the left and right operands and the operation
-        RelOp(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right, RelOpType op);
+        RelOp(Exp *left, Exp *right, RelOpType op);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -169,11 +240,13 @@ namespace ast {
     /* Unary logical NOT operation */
     class Not : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Not;
+
         // Operand
-        std::shared_ptr<Exp> exp;
+        Exp *exp;
 
         // Constructor that receives the operand
-        explicit Not(std::shared_ptr<Exp> exp);
+        explicit Not(Exp *exp);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -183,13 +256,15 @@ namespace ast {
     /* Binary logical AND operation */
     class And : public Exp {
     public:
+        static constexpr Kind KIND = Kind::And;
+
         // Left operand
-        std::shared_ptr<Exp> left;
+        Exp *left;
         // Right operand
-        std::shared_ptr<Exp> right;
+        Exp *right;
 
         // Constructor that receives the left and right operands
-        And(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right);
+        And(Exp *left, Exp *right);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -199,13 +274,15 @@ namespace ast {
     /* Binary logical OR operation */
     class Or : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Or;
+
         // Left operand
-        std::shared_ptr<Exp> left;
+        Exp *left;
         // Right operand
-        std::shared_ptr<Exp> right;
+        Exp *right;
 
         // Constructor that receives the left and right operands
-        Or(std::shared_ptr<Exp> left, std::shared_ptr<Exp> right);
+        Or(Exp *left, Exp *right);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -215,6 +292,8 @@ namespace ast {
     /* Type symbol */
     class Type : public Node {
     public:
+        static constexpr Kind KIND = Kind::Type;
+
         // Type
         BuiltInType type;
 
@@ -229,13 +308,15 @@ namespace ast {
     /* Type cast */
     class Cast : public Exp {
     public:
+        static constexpr Kind KIND = Kind::Cast;
+
         // Expression to be cast
-        std::shared_ptr<Exp> exp;
+        Exp *exp;
         // Target type
-        std::shared_ptr<Type> target_type;
+        Type *target_type;
 
         // Constructor that receives the expression and the target type
-        Cast(std::shared_ptr<Exp> exp, std::shared_ptr<Type> type);
+        Cast(Exp *exp, Type *type);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -245,20 +326,22 @@ namespace ast {
     /* List of expressions */
     class ExpList : public Node {
     public:
+        static constexpr Kind KIND = Kind::ExpList;
+
         // List of expressions
-        std::vector<std::shared_ptr<Exp>> exps;
+        std::vector<Exp *> exps;
 
         // Constructor that receives no expressions
-        ExpList() = default;
+        ExpList();
 
         // Constructor that receives the first expression
-        explicit ExpList(std::shared_ptr<Exp> exp);
+        explicit ExpList(Exp *exp);
 
         // Method to add an expression at the beginning of the list
-        void push_front(const std::shared_ptr<Exp> &exp);
+        void push_front(Exp *exp);
 
         // Method to add an expression at the end of the list
-        void push_back(const std::shared_ptr<Exp> &exp);
+        void push_back(Exp *exp);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -268,16 +351,15 @@ namespace ast {
     /* Function call */
     class Call : public Exp, public Statement {
     public:
+        static constexpr Kind KIND = Kind::Call;
+
         // Function identifier
-        std::shared_ptr<ID> func_id;
+        ID *func_id;
         // List of arguments as expressions
-        std::shared_ptr<ExpList> args;
+        ExpList *args;
 
         // Constructor that receives the function identifier and the list of arguments
-        Call(std::shared_ptr<ID> func_id, std::shared_ptr<ExpList> args);
-
-        // Constructor that receives only the function identifier (for parameterless functions)
-        explicit Call(std::shared_ptr<ID> func_id);
+        Call(ID *func_id, ExpList *args);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -287,20 +369,22 @@ namespace ast {
     /* List of statements */
     class Statements : public Statement {
     public:
+        static constexpr Kind KIND = Kind::Statements;
+
         // List of statements
-        std::vector<std::shared_ptr<Statement>> statements;
+        std::vector<Statement *> statements;
 
         // Constructor that receives no statements
-        Statements() = default;
+        Statements();
 
         // Constructor that receives the first statement
-        explicit Statements(std::shared_ptr<Statement> statement);
+        explicit Statements(Statement *statement);
 
         // Method to add a statement at the beginning of the list
-        void push_front(const std::shared_ptr<Statement> &statement);
+        void push_front(Statement *statement);
 
         // Method to add a statement at the end of the list
-        void push_back(const std::shared_ptr<Statement> &statement);
+        void push_back(Statement *statement);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -309,6 +393,11 @@ namespace ast {
 
     /* Break statement */
     class Break : public Statement {
+    public:
+        static constexpr Kind KIND = Kind::Break;
+
+        Break();
+
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
@@ -316,6 +405,11 @@ namespace ast {
 
     /* Continue statement */
     class Continue : public Statement {
+    public:
+        static constexpr Kind KIND = Kind::Continue;
+
+        Continue();
+
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
@@ -324,11 +418,13 @@ namespace ast {
     /* Return statement */
     class Return : public Statement {
     public:
+        static constexpr Kind KIND = Kind::Return;
+
         // Expression to be returned. If the return is expressionless, this field is nullptr
-        std::shared_ptr<Exp> exp;
+        Exp *exp;
 
         // Constructor that receives the expression to be returned
-        explicit Return(std::shared_ptr<Exp> exp = nullptr);
+        explicit Return(Exp *exp = nullptr);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -338,16 +434,18 @@ namespace ast {
     /* If statement */
     class If : public Statement {
     public:
+        static constexpr Kind KIND = Kind::If;
+
         // Condition expression
-        std::shared_ptr<Exp> condition;
+        Exp *condition;
         // Statement to be executed if the condition is true
-        std::shared_ptr<Statement> then;
+        Statement *then;
         // Statement to be executed if the condition is false. For an if statement without else, this field is nullptr
-        std::shared_ptr<Statement> otherwise;
+        Statement *otherwise;
 
         // Constructor that receives the condition, the statement to be executed if the condition is true, and the statement to be executed if the condition is false
-        If(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> then,
-           std::shared_ptr<Statement> otherwise = nullptr);
+        If(Exp *condition, Statement *then,
+           Statement *otherwise = nullptr);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -357,13 +455,15 @@ namespace ast {
     /* While statement */
     class While : public Statement {
     public:
+        static constexpr Kind KIND = Kind::While;
+
         // Condition expression
-        std::shared_ptr<Exp> condition;
+        Exp *condition;
         // Statement to be executed while the condition is true
-        std::shared_ptr<Statement> body;
+        Statement *body;
 
         // Constructor that receives the condition and the statement to be executed while the condition is true
-        While(std::shared_ptr<Exp> condition, std::shared_ptr<Statement> body);
+        While(Exp *condition, Statement *body);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -373,15 +473,17 @@ namespace ast {
     /* Variable declaration */
     class VarDecl : public Statement {
     public:
+        static constexpr Kind KIND = Kind::VarDecl;
+
         // Identifier of the variable
-        std::shared_ptr<ID> id;
+        ID *id;
         // Type of the variable
-        std::shared_ptr<Type> type;
+        Type *type;
         // Initial value of the variable. If the variable is not initialized, this field is nullptr
-        std::shared_ptr<Exp> init_exp;
+        Exp *init_exp;
 
         // Constructor that receives the identifier, the type, and the initial value expression
-        VarDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> type, std::shared_ptr<Exp> init_exp = nullptr);
+        VarDecl(ID *id, Type *type, Exp *init_exp = nullptr);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -391,13 +493,15 @@ namespace ast {
     /* Assignment statement */
     class Assign : public Statement {
     public:
+        static constexpr Kind KIND = Kind::Assign;
+
         // Identifier of the variable
-        std::shared_ptr<ID> id;
+        ID *id;
         // Expression to be assigned
-        std::shared_ptr<Exp> exp;
+        Exp *exp;
 
         // Constructor that receives the identifier and the expression to be assigned
-        Assign(std::shared_ptr<ID> id, std::shared_ptr<Exp> exp);
+        Assign(ID *id, Exp *exp);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -407,13 +511,15 @@ namespace ast {
     /* Formal parameter */
     class Formal : public Node {
     public:
+        static constexpr Kind KIND = Kind::Formal;
+
         // Identifier of the parameter
-        std::shared_ptr<ID> id;
+        ID *id;
         // Type of the parameter
-        std::shared_ptr<Type> type;
+        Type *type;
 
         // Constructor that receives the identifier and the type
-        Formal(std::shared_ptr<ID> id, std::shared_ptr<Type> type);
+        Formal(ID *id, Type *type);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -423,20 +529,22 @@ namespace ast {
     /* List of formal parameters */
     class Formals : public Node {
     public:
+        static constexpr Kind KIND = Kind::Formals;
+
         // List of formal parameters
-        std::vector<std::shared_ptr<Formal>> formals;
+        std::vector<Formal *> formals;
 
         // Constructor that receives no parameters
-        Formals() = default;
+        Formals();
 
         // Constructor that receives the first formal parameter
-        explicit Formals(std::shared_ptr<Formal> formal);
+        explicit Formals(Formal *formal);
 
         // Method to add a formal parameter at the beginning of the list
-        void push_front(const std::shared_ptr<Formal> &formal);
+        void push_front(Formal *formal);
 
         // Method to add a formal parameter at the end of the list
-        void push_back(const std::shared_ptr<Formal> &formal);
+        void push_back(Formal *formal);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
@@ -446,48 +554,150 @@ namespace ast {
     /* Function declaration */
     class FuncDecl : public Node {
     public:
+        static constexpr Kind KIND = Kind::FuncDecl;
+
         // Identifier of the function
-        std::shared_ptr<ID> id;
+        ID *id;
         // Return type of the function
-        std::shared_ptr<Type> return_type;
+        Type *return_type;
         // List of formal parameters
-        std::shared_ptr<Formals> formals;
+        Formals *formals;
         // Body of the function
-        std::shared_ptr<Statements> body;
+        Statements *body;
 
         // Constructor that receives the identifier, the return type, the list of formal parameters, and the body
-        FuncDecl(std::shared_ptr<ID> id, std::shared_ptr<Type> return_type, std::shared_ptr<Formals> formals,
-                 std::shared_ptr<Statements> body);
+        FuncDecl(ID *id, Type *return_type, Formals *formals,
+                 Statements *body);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
+
+        // Accept method for a visitor with an arena of its own: a body that is built for the visit
+        // (see FlatTree::expand_program) is built there, so functions may be visited on several threads
+        virtual void accept(Visitor &visitor, Arena &arena) {
+            visitor.visit(*this);
+        }
     };
 
     /* List of function declarations */
     class Funcs : public Node {
     public:
+        static constexpr Kind KIND = Kind::Funcs;
+
         // List of function declarations
-        std::vector<std::shared_ptr<FuncDecl>> funcs;
+        std::vector<FuncDecl *> funcs;
 
         // Constructor that receives no function declarations
-        Funcs() = default;
+        Funcs();
 
         // Constructor that receives the first function declaration
-        explicit Funcs(std::shared_ptr<FuncDecl> func);
+        explicit Funcs(FuncDecl *func);
 
         // Method to add a function declaration at the beginning of the list
-        void push_front(const std::shared_ptr<FuncDecl> &func);
+        void push_front(FuncDecl *func);
 
         // Method to add a function declaration at the end of the list
-        void push_back(const std::shared_ptr<FuncDecl> &func);
+        void push_back(FuncDecl *func);
 
         void accept(Visitor &visitor) override {
             visitor.visit(*this);
         }
     };
-}
 
-#define YYSTYPE std::shared_ptr<ast::Node>
+    // The node as a T, nullptr if it is another kind of node (or nullptr). Base is Exp or Statement, or
+    // another class T derives from without a virtual base.
+    template<typename T, typename Base>
+    T *node_cast(Base *node) {
+        return (node != nullptr && node->kind == T::KIND) ? static_cast<T *>(node) : nullptr;
+    }
+
+    /* StaticVisitor class
+     * Visits the nodes without virtual calls: an expression or a statement is dispatched with a switch
+     * on its kind (one indexed jump), and any other node by its class. Derived has a visit() for each
+     * class of nodes it meets, and is final, so that those calls are direct too.
+     * Exp and Statement are virtual bases, which a Node can not be cast down from without RTTI, so a
+     * node is dispatched from the most derived of them that is known.
+     * Expressions and statements are what nests, so dispatching one checks the stack with ensure_stack():
+     * a visitor may recurse as deep as the tree goes.
+     */
+    template<typename Derived>
+    class StaticVisitor {
+    public:
+        template<typename T>
+        void dispatch(T &node) {
+            derived().visit(node);
+        }
+
+        void dispatch(Exp &exp) {
+            ensure_stack([&] { visit_exp(exp); });
+        }
+
+        void dispatch(Statement &statement) {
+            ensure_stack([&] { visit_statement(statement); });
+        }
+
+    private:
+        Derived &derived() {
+            return static_cast<Derived &>(*this);
+        }
+
+        void visit_exp(Exp &exp) {
+            switch (exp.kind) {
+                case Kind::Num:
+                    return derived().visit(static_cast<Num &>(exp));
+                case Kind::NumB:
+                    return derived().visit(static_cast<NumB &>(exp));
+                case Kind::String:
+                    return derived().visit(static_cast<String &>(exp));
+                case Kind::Bool:
+                    return derived().visit(static_cast<Bool &>(exp));
+                case Kind::ID:
+                    return derived().visit(static_cast<ID &>(exp));
+                case Kind::BinOp:
+                    return derived().visit(static_cast<BinOp &>(exp));
+                case Kind::RelOp:
+                    return derived().visit(static_cast<RelOp &>(exp));
+                case Kind::Not:
+                    return derived().visit(static_cast<Not &>(exp));
+                case Kind::And:
+                    return derived().visit(static_cast<And &>(exp));
+                case Kind::Or:
+                    return derived().visit(static_cast<Or &>(exp));
+                case Kind::Cast:
+                    return derived().visit(static_cast<Cast &>(exp));
+                case Kind::Call:
+                    return derived().visit(static_cast<Call &>(exp));
+                default:
+                    return;
+            }
+        }
+
+        void visit_statement(Statement &statement) {
+            switch (statement.kind) {
+                case Kind::Call:
+                    return derived().visit(static_cast<Call &>(statement));
+                case Kind::Statements:
+                    return derived().visit(static_cast<Statements &>(statement));
+                case Kind::Break:
+                    return derived().visit(static_cast<Break &>(statement));
+                case Kind::Continue:
+                    return derived().visit(static_cast<Continue &>(statement));
+                case Kind::Return:
+                    return derived().visit(static_cast<Return &>(statement));
+                case Kind::If:
+                    return derived().visit(static_cast<If &>(statement));
+                case Kind::While:
+                    return derived().visit(static_cast<While &>(statement));
+                case Kind::VarDecl:
+                    return derived().visit(static_cast<VarDecl &>(statement));
+                case Kind::Assign:
+                    return derived().visit(static_cast<Assign &>(statement));
+                default:
+                    return;
+            }
+        }
+    };
+}
 
 #endif //NODES_HPP
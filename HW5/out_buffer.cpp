@@ -0,0 +1,155 @@
+#include "out_buffer.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstring>
+#include <fcntl.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+namespace output {
+
+    void OutputBuffer::append(const char *data, size_t len) {
+        while (len > 0) {
+            if (used == PAGE_SIZE) {
+                if (fd >= 0 && pages.size() >= max_pages)
+                    flush();
+                if (used == PAGE_SIZE) {
+                    pages.emplace_back(new char[PAGE_SIZE]);
+                    used = 0;
+                }
+            }
+            size_t chunk = std::min(len, PAGE_SIZE - used);
+            std::memcpy(pages.back().get() + used, data, chunk);
+            used += chunk;
+            data += chunk;
+            len -= chunk;
+        }
+    }
+
+    OutputBuffer &OutputBuffer::operator<<(const char *str) {
+        append(str, std::strlen(str));
+        return *this;
+    }
+
+    size_t OutputBuffer::size() const {
+        if (pages.empty())
+            return 0;
+        return (pages.size() - 1) * PAGE_SIZE + used;
+    }
+
+    bool OutputBuffer::write_to(int fd) const {
+        std::vector<struct iovec> iov;
+        for (size_t i = 0; i < pages.size(); i++) {
+            size_t len = (i + 1 == pages.size()) ? used : PAGE_SIZE;
+            if (len > 0)
+                iov.push_back({pages[i].get(), len});
+        }
+
+        // A single call unless there are more pages than writev() takes, or the write is partial
+        size_t first = 0;
+        while (first < iov.size()) {
+            int count = static_cast<int>(std::min<size_t>(iov.size() - first, IOV_MAX));
+            ssize_t written = writev(fd, &iov[first], count);
+            if (written < 0) {
+                if (errno == EINTR)
+                    continue;
+                return false;
+            }
+            while (first < iov.size() && static_cast<size_t>(written) >= iov[first].iov_len) {
+                written -= iov[first].iov_len;
+                first++;
+            }
+            if (written > 0) {
+                iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + written;
+                iov[first].iov_len -= written;
+            }
+        }
+        return true;
+    }
+
+    std::string OutputBuffer::str() const {
+        std::string result;
+        result.reserve(size());
+        for (size_t i = 0; i < pages.size(); i++)
+            result.append(pages[i].get(), (i + 1 == pages.size()) ? used : PAGE_SIZE);
+        return result;
+    }
+
+    void OutputBuffer::flush() {
+        if (fd < 0)
+            return;
+        write_to(fd);
+        clear();
+    }
+
+    void OutputBuffer::clear() {
+        if (pages.size() > 1)
+            pages.resize(1);
+        used = pages.empty() ? PAGE_SIZE : 0;
+    }
+
+    /* StreamedOutput class */
+
+    StreamedOutput::StreamedOutput(int target) : target(target), fd(target), spooled(false), committed(false),
+                                                 start(-1) {
+        struct stat st;
+        if (fstat(target, &st) == 0 && S_ISREG(st.st_mode)) {
+            // Appending writes go to the end of the file wherever the offset is
+            int flags = fcntl(target, F_GETFL);
+            start = (flags >= 0 && (flags & O_APPEND)) ? st.st_size : lseek(target, 0, SEEK_CUR);
+        }
+
+        if (start < 0) {
+            const char *dir = std::getenv("TMPDIR");
+            std::string path = std::string(dir ? dir : P_tmpdir) + "/fancXXXXXX";
+            int spool = mkstemp(&path[0]);
+            // Without a temporary file the output is streamed anyway, and cannot be taken back
+            if (spool >= 0) {
+                unlink(path.c_str());
+                fd = spool;
+                spooled = true;
+            }
+        }
+        out = OutputBuffer(fd);
+    }
+
+    StreamedOutput::~StreamedOutput() {
+        if (!committed)
+            discard();
+        if (spooled)
+            close(fd);
+    }
+
+    void StreamedOutput::commit() {
+        committed = true;
+        out.flush();
+        if (!spooled)
+            return;
+
+        lseek(fd, 0, SEEK_SET);
+        std::unique_ptr<char[]> chunk(new char[OutputBuffer::PAGE_SIZE]);
+        ssize_t len;
+        while ((len = read(fd, chunk.get(), OutputBuffer::PAGE_SIZE)) > 0 || (len < 0 && errno == EINTR)) {
+            for (ssize_t done = 0; done < len;) {
+                ssize_t written = write(target, chunk.get() + done, len - done);
+                if (written < 0 && errno != EINTR)
+                    return;
+                if (written > 0)
+                    done += written;
+            }
+        }
+    }
+
+    void StreamedOutput::discard() {
+        out.clear();
+        if (!spooled && start >= 0) {
+            if (ftruncate(target, start) == 0)
+                lseek(target, start, SEEK_SET);
+        }
+    }
+}
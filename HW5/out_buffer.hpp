@@ -0,0 +1,104 @@
+#ifndef OUT_BUFFER_HPP
+#define OUT_BUFFER_HPP
+
+#include <charconv>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace output {
+
+    /* OutputBuffer class
+     * Append-only byte buffer made of fixed size pages, so growing it never copies what was
+     * already written. The pages are written out together with writev().
+     * A buffer with a file descriptor writes itself out whenever it has max_pages full pages,
+     * which bounds its memory - output smaller than that is written with a single writev().
+     */
+    class OutputBuffer {
+    public:
+        static constexpr size_t PAGE_SIZE = 64 * 1024;
+
+        explicit OutputBuffer(int fd = -1, size_t max_pages = 64) : fd(fd), max_pages(max_pages) {}
+
+        // Writes the content to the file descriptor of the buffer, if it has one, and drops it
+        void flush();
+
+        void append(const char *data, size_t len);
+
+        OutputBuffer &operator<<(const std::string &str) {
+            append(str.data(), str.size());
+            return *this;
+        }
+
+        OutputBuffer &operator<<(const char *str);
+
+        OutputBuffer &operator<<(char c) {
+            append(&c, 1);
+            return *this;
+        }
+
+        template<typename T, typename = std::enable_if_t<std::is_integral<T>::value>>
+        OutputBuffer &operator<<(T value) {
+            char digits[24];
+            auto result = std::to_chars(digits, digits + sizeof(digits), value);
+            append(digits, result.ptr - digits);
+            return *this;
+        }
+
+        size_t size() const;
+
+        // Writes the whole buffer to a file descriptor. Returns false on a write error.
+        bool write_to(int fd) const;
+
+        // The whole buffer as one string
+        std::string str() const;
+
+        // Drops the content, keeping the first page for reuse
+        void clear();
+
+    private:
+        int fd;
+        size_t max_pages;
+        std::vector<std::unique_ptr<char[]>> pages;
+        // Bytes used in the last page
+        size_t used = PAGE_SIZE;
+    };
+
+    /* StreamedOutput class
+     * Output that is written to a file descriptor while the rest of the program is still being compiled.
+     * If compilation fails, discard() takes back what was written: the target is truncated when it is
+     * a regular file, otherwise the output waits in a temporary file until commit().
+     * Output that is never committed is discarded when the StreamedOutput is destroyed.
+     */
+    class StreamedOutput {
+    public:
+        explicit StreamedOutput(int target);
+
+        ~StreamedOutput();
+
+        OutputBuffer &buffer() {
+            return out;
+        }
+
+        // The output is complete: writes out everything
+        void commit();
+
+        // Drops everything written so far
+        void discard();
+
+    private:
+        // Where the output goes in the end
+        int target;
+        // Where the output is written meanwhile: the target, or the temporary file
+        int fd;
+        bool spooled;
+        bool committed;
+        // Offset of the target when streaming started
+        long long start;
+        OutputBuffer out;
+    };
+}
+
+#endif //OUT_BUFFER_HPP
@@ -1,11 +1,19 @@
 #include "output.hpp"
+#include "compile_cache.hpp"
+#include "fingerprint.hpp"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
 #include <iostream>
-
-#define I32 std::string(" i32")
-#define I32ptr std::string(" i32*")
-#define I8 std::string(" i8")
-#define I8ptr std::string(" i8*")
-
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
 
 namespace output {
     /* Helper functions */
@@ -30,930 +38,1351 @@ namespace output {
     /* Error handling functions */
 
     void errorLex(int lineno) {
-        std::cout << "line " << lineno << ": lexical error\n";
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ": lexical error\n";
+        throw CompileError(message.str());
     }
 
     void errorSyn(int lineno) {
-        std::cout << "line " << lineno << ": syntax error\n";
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ": syntax error\n";
+        throw CompileError(message.str());
     }
 
     void errorUndef(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " variable " << id << " is not defined" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " variable " << id << " is not defined" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorDefAsFunc(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " symbol " << id << " is a function" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " symbol " << id << " is a function" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorDefAsVar(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " symbol " << id << " is a variable" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " symbol " << id << " is a variable" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorDef(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " symbol " << id << " is already defined" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " symbol " << id << " is already defined" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorUndefFunc(int lineno, const std::string &id) {
-        std::cout << "line " << lineno << ":" << " function " << id << " is not defined" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " function " << id << " is not defined" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorMismatch(int lineno) {
-        std::cout << "line " << lineno << ":" << " type mismatch" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " type mismatch" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorPrototypeMismatch(int lineno, const std::string &id, std::vector<std::string> &paramTypes) {
-        std::cout << "line " << lineno << ": prototype mismatch, function " << id << " expects parameters (";
+        std::ostringstream message;
+        message << "line " << lineno << ": prototype mismatch, function " << id << " expects parameters (";
 
         for (int i = 0; i < paramTypes.size(); ++i) {
-            std::cout << paramTypes[i];
+            message << paramTypes[i];
             if (i != paramTypes.size() - 1)
-                std::cout << ",";
+                message << ",";
         }
 
-        std::cout << ")" << std::endl;
-        exit(0);
+        message << ")" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorUnexpectedBreak(int lineno) {
-        std::cout << "line " << lineno << ":" << " unexpected break statement" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " unexpected break statement" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorUnexpectedContinue(int lineno) {
-        std::cout << "line " << lineno << ":" << " unexpected continue statement" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "line " << lineno << ":" << " unexpected continue statement" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorMainMissing() {
-        std::cout << "Program has no 'void main()' function" << std::endl;
-        exit(0);
+        std::ostringstream message;
+        message << "Program has no 'void main()' function" << std::endl;
+        throw CompileError(message.str());
     }
 
     void errorByteTooLarge(int lineno, const int value) {
-        std::cout << "line " << lineno << ": byte value " << value << " out of range" << std::endl;
-        exit(0);
+        errorByteTooLarge(lineno, std::to_string(value));
     }
 
-    /* CodeBuffer class */
+    void errorByteTooLarge(int lineno, const std::string &value) {
+        std::ostringstream message;
+        message << "line " << lineno << ": byte value " << value << " out of range" << std::endl;
+        throw CompileError(message.str());
+    }
 
-    CodeBuffer::CodeBuffer() : labelCount(0), varCount(0), stringCount(0), indent("") {}
+    void errorIntTooLarge(int lineno, const std::string &value) {
+        std::ostringstream message;
+        message << "line " << lineno << ": int value " << value << " out of range" << std::endl;
+        throw CompileError(message.str());
+    }
 
-    std::string CodeBuffer::freshLabel() {
-        return "%label_" + std::to_string(labelCount++);
+    /* Helper functions */
+
+    static bool is_numeric_type(ast::BuiltInType type){
+        return type == ast::BuiltInType::INT || type == ast::BuiltInType::BYTE;
     }
 
-    std::string CodeBuffer::freshVar() {
-        return "%t" + std::to_string(varCount++);
+    // LLVM type of the values of a FanC type: every type gets its natural width
+    static ir::Type llvm_type(ast::BuiltInType type){
+        switch (type) {
+            case ast::BuiltInType::VOID:
+                return ir::Type::Void;
+            case ast::BuiltInType::BOOL:
+                return ir::Type::I1;
+            case ast::BuiltInType::BYTE:
+                return ir::Type::I8;
+            case ast::BuiltInType::STRING:
+                return ir::Type::I8Ptr;
+            default:
+                return ir::Type::I32;
+        }
     }
 
-    std::string CodeBuffer::emitString(const std::string &str) {
-        std::string var = "@.str" + std::to_string(stringCount++);
-        globalsBuffer << var << " = constant [" << str.length() + 1 << " x i8] c\"" << str << "\\00\"\n";
-        return var;
+    // Declarations and definitions of the built-in functions
+    static const char* const RUNTIME =
+        "; =================================== Declarations of built-in functions ===================================\n"
+        "declare i32 @scanf(i8*, ...)\n"
+        "declare i32 @printf(i8*, ...)\n"
+        "declare void @exit(i32) noreturn cold\n"
+        "@.int_specifier_scan = constant [3 x i8] c\"%d\\00\"\n"
+        "@.int_specifier = constant [4 x i8] c\"%d\\0A\\00\"\n"
+        "@.str_specifier = constant [4 x i8] c\"%s\\0A\\00\"\n"
+        "\n"
+        "; =================================== Definitions of built-in functions ===================================\n"
+        "define i32 @readi(i32) {\n"
+        "\t%ret_val = alloca i32\n"
+        "\t%spec_ptr = getelementptr [3 x i8], [3 x i8]* @.int_specifier_scan, i32 0, i32 0\n"
+        "\tcall i32 (i8*, ...) @scanf(i8* %spec_ptr, i32* %ret_val)\n"
+        "\t%val = load i32, i32* %ret_val\n"
+        "\tret i32 %val\n"
+        "}\n"
+        "\n"
+        "define void @printi(i32) {\n"
+        "\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.int_specifier, i32 0, i32 0\n"
+        "\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i32 %0)\n"
+        "\tret void\n"
+        "}\n"
+        "\n"
+        "define void @print(i8*) {\n"
+        "\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.str_specifier, i32 0, i32 0\n"
+        "\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i8* %0)\n"
+        "\tret void\n"
+        "}\n"
+        "\n"
+        "; =================================== End of built-in functions ===================================\n"
+        "\n";
+
+    static ir::Value constant(ast::BuiltInType type, int value){
+        return ir::Value::constant(llvm_type(type), value);
     }
 
-    void CodeBuffer::emit(const std::string &str) {
-        buffer << indent << str << std::endl;
+    // Evaluates an arithmetic operation on constants with FanC semantics: int wraps around at 32 bits
+    // and byte at 8 bits. Returns false if the operation has to be left for runtime.
+    static bool fold_binop(ast::BinOpType op, int left, int right, bool is_int, int& result){
+        uint32_t l = static_cast<uint32_t>(left), r = static_cast<uint32_t>(right);
+        switch (op) {
+            case ast::BinOpType::ADD:
+                result = static_cast<int32_t>(l + r);
+                break;
+            case ast::BinOpType::SUB:
+                result = static_cast<int32_t>(l - r);
+                break;
+            case ast::BinOpType::MUL:
+                result = static_cast<int32_t>(l * r);
+                break;
+            case ast::BinOpType::DIV:
+                // Division by zero is a runtime error, so is the overflowing INT_MIN / -1
+                if (right == 0 || (left == INT_MIN && right == -1))
+                    return false;
+                result = left / right;
+                break;
+        }
+        if (!is_int)
+            result &= 255;
+        return true;
     }
 
-    void CodeBuffer::emitLabel(const std::string &label) {
-        buffer << label.substr(1) << ":" << std::endl;
+    static bool fold_relop(ast::RelOpType op, int left, int right){
+        switch (op) {
+            case ast::RelOpType::EQ:
+                return left == right;
+            case ast::RelOpType::NE:
+                return left != right;
+            case ast::RelOpType::LT:
+                return left < right;
+            case ast::RelOpType::GT:
+                return left > right;
+            case ast::RelOpType::LE:
+                return left <= right;
+            case ast::RelOpType::GE:
+                return left >= right;
+        }
+        return false;
     }
 
-    CodeBuffer &CodeBuffer::operator<<(std::ostream &(*manip)(std::ostream &)) {
-        buffer << manip;
-        return *this;
+    static ValueRange type_range(ast::BuiltInType type){
+        switch (type) {
+            case ast::BuiltInType::BOOL:
+                return { 0, 1 };
+            case ast::BuiltInType::BYTE:
+                return { 0, 255 };
+            default:
+                return { INT_MIN, INT_MAX };
+        }
     }
 
-    std::ostream &operator<<(std::ostream &os, const CodeBuffer &buffer) {
-        os << buffer.globalsBuffer.str() << std::endl << buffer.buffer.str();
-        return os;
+    // Range of an arithmetic operation. A result that may wrap around can be anything of its type.
+    static ValueRange binop_range(ast::BinOpType op, ValueRange left, ValueRange right, ast::BuiltInType type){
+        ValueRange result = type_range(type);
+        switch (op) {
+            case ast::BinOpType::ADD:
+                result = { left.lo + right.lo, left.hi + right.hi };
+                break;
+            case ast::BinOpType::SUB:
+                result = { left.lo - right.hi, left.hi - right.lo };
+                break;
+            case ast::BinOpType::MUL: {
+                long long corners[] = { left.lo * right.lo, left.lo * right.hi, left.hi * right.lo, left.hi * right.hi };
+                result = { *std::min_element(corners, corners + 4), *std::max_element(corners, corners + 4) };
+                break;
+            }
+            case ast::BinOpType::DIV:
+                // Only the common case of a non negative value divided by a positive one is tracked
+                if (left.lo >= 0 && right.lo > 0 && right.hi > 0)
+                    result = { left.lo / right.hi, left.hi / right.lo };
+                break;
+        }
+        ValueRange bounds = type_range(type);
+        if (result.lo < bounds.lo || result.hi > bounds.hi)
+            return bounds;
+        return result;
     }
 
-    // ====================================================================================
-    // ALL CODE FROM LAST HW (3)
-    // ====================================================================================
+    static ast::RelOpType negate(ast::RelOpType op){
+        switch (op) {
+            case ast::RelOpType::EQ:
+                return ast::RelOpType::NE;
+            case ast::RelOpType::NE:
+                return ast::RelOpType::EQ;
+            case ast::RelOpType::LT:
+                return ast::RelOpType::GE;
+            case ast::RelOpType::GT:
+                return ast::RelOpType::LE;
+            case ast::RelOpType::LE:
+                return ast::RelOpType::GT;
+            default:
+                return ast::RelOpType::LT;
+        }
+    }
 
-    /* Helper functions */
+    // The same relation with the operands swapped
+    static ast::RelOpType mirror(ast::RelOpType op){
+        switch (op) {
+            case ast::RelOpType::LT:
+                return ast::RelOpType::GT;
+            case ast::RelOpType::GT:
+                return ast::RelOpType::LT;
+            case ast::RelOpType::LE:
+                return ast::RelOpType::GE;
+            case ast::RelOpType::GE:
+                return ast::RelOpType::LE;
+            default:
+                return op;
+        }
+    }
 
-    static bool is_numeric_type(ast::BuiltInType type){
-        return type == ast::BuiltInType::INT || type == ast::BuiltInType::BYTE;
+    static std::optional<int> literal_value(ast::Exp* exp){
+        if (auto num = ast::node_cast<ast::Num>(exp))
+            return num->value;
+        if (auto num_b = ast::node_cast<ast::NumB>(exp))
+            return num_b->value;
+        return std::nullopt;
+    }
+
+    static bool is_id(ast::Exp* exp, ast::SymbolId symbol){
+        auto id = ast::node_cast<ast::ID>(exp);
+        return id != nullptr && id->symbol == symbol;
     }
 
-    static std::string toupper(std::string str){
-        for (char& c : str){
-            c = std::toupper(static_cast<unsigned char>(c));
+    // The c of an increment `name = name + c` by a positive literal, nullopt for any other assignment
+    static std::optional<int> increment_step(ast::Assign& assign){
+        ast::SymbolId name = assign.id->symbol;
+        auto add = ast::node_cast<ast::BinOp>(assign.exp);
+        if (add == nullptr || add->op != ast::BinOpType::ADD)
+            return std::nullopt;
+        std::optional<int> step = is_id(add->left, name) ? literal_value(add->right) :
+            (is_id(add->right, name) ? literal_value(add->left) : std::nullopt);
+        if (!step || *step <= 0)
+            return std::nullopt;
+        return step;
+    }
+
+    // Largest value a variable may have when a loop condition holds, if the condition bounds it
+    // from above with a literal (e.g. `i < 10` or `10 >= i`, possibly one of several conjuncts)
+    static std::optional<long long> loop_bound(ast::Exp* cond, ast::SymbolId name){
+        if (ast::stack_low())
+            return ast::ensure_stack([&]{ return loop_bound(cond, name); });
+        if (auto and_exp = ast::node_cast<ast::And>(cond)){
+            std::optional<long long> bound = loop_bound(and_exp->left, name);
+            return bound ? bound : loop_bound(and_exp->right, name);
+        }
+        auto rel = ast::node_cast<ast::RelOp>(cond);
+        if (rel == nullptr)
+            return std::nullopt;
+
+        ast::RelOpType op = rel->op;
+        std::optional<int> limit;
+        if (is_id(rel->left, name)){
+            limit = literal_value(rel->right);
+        }
+        else if (is_id(rel->right, name)){
+            limit = literal_value(rel->left);
+            op = mirror(op);
         }
-        return str;
+        if (!limit)
+            return std::nullopt;
+        if (op == ast::RelOpType::LT)
+            return static_cast<long long>(*limit) - 1;
+        if (op == ast::RelOpType::LE)
+            return *limit;
+        return std::nullopt;
+    }
+
+    MyVisitor::MyVisitor(ast::Interner& symbols, const sema::Annotations& annotations, const Options& options, int fd,
+        fanc::CompileCache* cache) :
+        fd(fd), options(options), symbols(symbols), annotations(annotations), cache(cache){}
+
+    void MyVisitor::print_buf(){
+        // Already written function by function
+        if (options.stream)
+            return;
+        if (fd < 0){
+            ir::print(code, module);
+            return;
+        }
+        std::cout.flush();
+        OutputBuffer out(fd);
+        ir::print(out, module);
+        out.flush();
+    }
+
+    /* Control flow helpers */
+
+    void MyVisitor::add_edge(ir::BlockId label){
+        if (unreachable())
+            return;
+        reachable_labels.insert(label);
+        if (options.ssa)
+            ssa_incoming[label].emplace_back(func->insert_block(), ssa_env);
     }
 
-    /* SCOPE PRINTER */
-    ScopePrinter::ScopePrinter() : indentLevel(0){}
+    void MyVisitor::emit_br(ir::BlockId label){
+        add_edge(label);
+        func->br(label);
+        terminate_block();
+    }
+
+    void MyVisitor::emit_cond_br(ir::Value cond, ir::BlockId true_label, ir::BlockId false_label){
+        add_edge(true_label);
+        add_edge(false_label);
+        func->cond_br(cond, true_label, false_label);
+        terminate_block();
+    }
 
-    std::string ScopePrinter::indent() const{
-        std::string result;
-        for (int i = 0; i < indentLevel; ++i){
-            result += "  ";
+    void MyVisitor::terminate_block(){
+        func->set_insert_point(ir::NoBlock);
+    }
+
+    void MyVisitor::emit_label(ir::BlockId label){
+        if (reachable_labels.erase(label) == 0){
+            func->set_insert_point(ir::NoBlock);
+            return;
         }
-        return result;
+        func->place(label);
+        if (!options.ssa)
+            return;
+
+        auto incoming = ssa_incoming.find(label);
+        std::vector<std::pair<ir::BlockId, SsaEnv>> preds = std::move(incoming->second);
+        ssa_incoming.erase(incoming);
+
+        if (preds.size() == 1){
+            ssa_env = std::move(preds[0].second);
+            return;
+        }
+
+        // Only variables that are in scope on every edge are still in scope here
+        SsaEnv merged;
+        for (const auto& var : preds[0].second){
+            bool in_scope = true, same_value = true;
+            for (const auto& pred : preds){
+                auto value = pred.second.find(var.first);
+                if (value == pred.second.end()){
+                    in_scope = false;
+                    break;
+                }
+                if (value->second != var.second)
+                    same_value = false;
+            }
+            if (!in_scope)
+                continue;
+            if (same_value){
+                merged[var.first] = var.second;
+                continue;
+            }
+
+            ir::Value phi = func->phi(ssa_var_types.at(var.first));
+            for (const auto& pred : preds)
+                func->add_incoming(phi, pred.second.at(var.first), pred.first);
+            merged[var.first] = phi;
+        }
+        ssa_env = std::move(merged);
     }
 
-    void ScopePrinter::beginScope(){
-        indentLevel++;
-        buffer << indent() << "---begin scope---" << std::endl;
+    std::vector<MyVisitor::LoopPhi> MyVisitor::emit_loop_header(ir::BlockId label){
+        // Only the edge from before the loop is known yet, the back edges come from the loop body
+        std::vector<LoopPhi> phis;
+        if (reachable_labels.erase(label) == 0){
+            func->set_insert_point(ir::NoBlock);
+            return phis;
+        }
+        func->place(label);
+        if (!options.ssa)
+            return phis;
+
+        for (auto& var : ssa_env){
+            LoopPhi phi = { var.first, func->phi(ssa_var_types.at(var.first)) };
+            var.second = phi.phi;
+            phis.push_back(phi);
+        }
+        return phis;
     }
 
-    void ScopePrinter::endScope(){
-        buffer << indent() << "---end scope---" << std::endl;
-        indentLevel--;
+    void MyVisitor::close_loop_header(ir::BlockId label, const std::vector<LoopPhi>& phis){
+        reachable_labels.erase(label);
+        if (!options.ssa)
+            return;
+
+        std::vector<std::pair<ir::BlockId, SsaEnv>> preds = std::move(ssa_incoming[label]);
+        ssa_incoming.erase(label);
+
+        for (const auto& phi : phis){
+            for (const auto& pred : preds)
+                func->add_incoming(phi.phi, pred.second.at(phi.var), pred.first);
+        }
     }
 
-    void ScopePrinter::emitVar(const std::string& id, const ast::BuiltInType& type, int offset){
-        buffer << indent() << id << " " << toString(type) << " " << offset << std::endl;
+    std::optional<bool> MyVisitor::emit_condition(ast::Exp& exp, ir::BlockId true_label, ir::BlockId false_label){
+        if (ast::stack_low())
+            return ast::ensure_stack([&]{ return emit_condition(exp, true_label, false_label); });
+        if (auto and_exp = ast::node_cast<ast::And>(&exp)){
+            ir::BlockId right_label = func->new_block();
+            std::optional<bool> left = emit_condition(*and_exp->left, right_label, false_label);
+            // Short circuit false: the right side is never evaluated
+            if (left && !*left)
+                return false;
+            if (!left)
+                emit_label(right_label);
+            std::optional<bool> right = emit_condition(*and_exp->right, true_label, false_label);
+            if (left)
+                return right;
+            if (right)
+                emit_br(*right ? true_label : false_label);
+            return std::nullopt;
+        }
+
+        if (auto or_exp = ast::node_cast<ast::Or>(&exp)){
+            ir::BlockId right_label = func->new_block();
+            std::optional<bool> left = emit_condition(*or_exp->left, true_label, right_label);
+            // Short circuit true: the right side is never evaluated
+            if (left && *left)
+                return true;
+            if (!left)
+                emit_label(right_label);
+            std::optional<bool> right = emit_condition(*or_exp->right, true_label, false_label);
+            if (left)
+                return right;
+            if (right)
+                emit_br(*right ? true_label : false_label);
+            return std::nullopt;
+        }
+
+        if (auto not_exp = ast::node_cast<ast::Not>(&exp)){
+            std::optional<bool> inner = emit_condition(*not_exp->exp, false_label, true_label);
+            if (inner)
+                return !*inner;
+            return std::nullopt;
+        }
+
+        if (auto rel_exp = ast::node_cast<ast::RelOp>(&exp)){
+            ir::Value cond_i1 = emit_relop(*rel_exp);
+            if (rel_exp->const_value)
+                return *rel_exp->const_value != 0;
+            emit_cond_br(cond_i1, true_label, false_label);
+            return std::nullopt;
+        }
+
+        // Any other bool value (variable, call, literal) already is an i1
+        dispatch(exp);
+        if (exp.const_value)
+            return *exp.const_value != 0;
+
+        emit_cond_br(exp.ir_value, true_label, false_label);
+        return std::nullopt;
     }
 
-    void ScopePrinter::emitFunc(const std::string& id, const ast::BuiltInType& returnType,
-        const std::vector<ast::BuiltInType>& paramTypes){
-        globalsBuffer << id << " " << "(";
+    void MyVisitor::materialize_condition(ast::Exp& exp){
+        ir::BlockId true_label = func->new_block();
+        ir::BlockId false_label = func->new_block();
+        ir::BlockId label_end = func->new_block();
 
-        for (int i = 0; i < paramTypes.size(); ++i){
-            globalsBuffer << toString(paramTypes[i]);
-            if (i != paramTypes.size() - 1)
-                globalsBuffer << ",";
+        std::optional<bool> known = emit_condition(exp, true_label, false_label);
+        if (known){
+            exp.const_value = *known;
+            exp.ir_value = constant(ast::BuiltInType::BOOL, *known);
+            return;
+        }
+
+        emit_label(true_label);
+        bool true_reached = !unreachable();
+        emit_br(label_end);
+        emit_label(false_label);
+        bool false_reached = !unreachable();
+        emit_br(label_end);
+
+        // Merge (Phi)
+        emit_label(label_end);
+        // The value is only known after evaluating side effects that decide it, e.g. f() or true
+        if (true_reached != false_reached){
+            exp.ir_value = constant(ast::BuiltInType::BOOL, true_reached);
+            return;
+        }
+        exp.ir_value = func->phi(ir::Type::I1);
+        func->add_incoming(exp.ir_value, constant(ast::BuiltInType::BOOL, true), true_label);
+        func->add_incoming(exp.ir_value, constant(ast::BuiltInType::BOOL, false), false_label);
+    }
+
+    ir::Value MyVisitor::widen(ast::Exp& exp, ast::BuiltInType from, ast::BuiltInType to){
+        if (from != ast::BuiltInType::BYTE || to != ast::BuiltInType::INT)
+            return exp.ir_value;
+        if (exp.const_value)
+            return constant(to, *exp.const_value);
+        return func->zext(exp.ir_value, ir::Type::I32);
+    }
+
+    // Variables of the same type and offset share a stack slot
+    static std::string slot_name(int offset, ast::BuiltInType type){
+        return "%slot_" + std::to_string(offset) + "_" + toString(type);
+    }
+
+    ir::Value MyVisitor::frame_slot(int offset, ast::BuiltInType type){
+        std::string slot = slot_name(offset, type);
+        auto known = frame_slots.find(slot);
+        if (known != frame_slots.end())
+            return known->second;
+        ir::Value address = func->alloca(llvm_type(type));
+        frame_slots[slot] = address;
+        return address;
+    }
+
+    void MyVisitor::refine_ranges(ast::Exp& cond, bool truth){
+        if (ast::stack_low())
+            return ast::ensure_stack([&]{ refine_ranges(cond, truth); });
+        if (auto and_exp = ast::node_cast<ast::And>(&cond)){
+            if (truth){
+                refine_ranges(*and_exp->left, true);
+                refine_ranges(*and_exp->right, true);
+            }
+            return;
+        }
+        if (auto or_exp = ast::node_cast<ast::Or>(&cond)){
+            if (!truth){
+                refine_ranges(*or_exp->left, false);
+                refine_ranges(*or_exp->right, false);
+            }
+            return;
+        }
+        if (auto not_exp = ast::node_cast<ast::Not>(&cond)){
+            refine_ranges(*not_exp->exp, !truth);
+            return;
+        }
+        auto rel = ast::node_cast<ast::RelOp>(&cond);
+        if (rel == nullptr)
+            return;
+
+        // Only a variable compared against a known value is refined
+        ast::RelOpType op = truth ? rel->op : negate(rel->op);
+        auto id = ast::node_cast<ast::ID>(rel->left);
+        std::optional<int> limit = rel->right->const_value;
+        if (id == nullptr || id->const_value || !limit){
+            id = ast::node_cast<ast::ID>(rel->right);
+            limit = rel->left->const_value;
+            op = mirror(op);
+        }
+        if (id == nullptr || id->const_value || !limit)
+            return;
+
+        Variable& var = variable(*id);
+        auto known = var_ranges.find(var.llvm_var);
+        ValueRange range = (known != var_ranges.end()) ? known->second : type_range(var.type);
+        long long value = *limit;
+        switch (op) {
+            case ast::RelOpType::EQ:
+                range = { std::max(range.lo, value), std::min(range.hi, value) };
+                break;
+            case ast::RelOpType::NE:
+                if (range.lo == value) range.lo++;
+                if (range.hi == value) range.hi--;
+                break;
+            case ast::RelOpType::LT:
+                range.hi = std::min(range.hi, value - 1);
+                break;
+            case ast::RelOpType::GT:
+                range.lo = std::max(range.lo, value + 1);
+                break;
+            case ast::RelOpType::LE:
+                range.hi = std::min(range.hi, value);
+                break;
+            case ast::RelOpType::GE:
+                range.lo = std::max(range.lo, value);
+                break;
         }
+        // No value passes the condition, so the branch never runs: nothing is known there
+        if (range.lo > range.hi)
+            range = type_range(var.type);
+        var_ranges[var.llvm_var] = range;
+    }
 
-        globalsBuffer << ")" << " -> " << toString(returnType) << std::endl;
+    void MyVisitor::collect_assigns(ast::Statement* stmt, LoopAssigns* loop){
+        if (stmt == nullptr)
+            return;
+        if (ast::stack_low())
+            return ast::ensure_stack([&]{ collect_assigns(stmt, loop); });
+        if (auto assign = ast::node_cast<ast::Assign>(stmt)){
+            assigned_names.insert(assign->id->symbol);
+            if (loop == nullptr)
+                return;
+            loop->declarations.insert(annotations.declaration(assign->id->tree_id));
+            std::optional<long long>& total = loop->increments.try_emplace(assign->id->symbol, 0).first->second;
+            std::optional<int> step = increment_step(*assign);
+            if (total && step)
+                *total += *step;
+            else
+                total = std::nullopt;
+        }
+        else if (auto statements = ast::node_cast<ast::Statements>(stmt)){
+            for (const auto& inner : statements->statements)
+                collect_assigns(inner, loop);
+        }
+        else if (auto if_stmt = ast::node_cast<ast::If>(stmt)){
+            collect_assigns(if_stmt->then, loop);
+            collect_assigns(if_stmt->otherwise, loop);
+        }
+        else if (auto while_stmt = ast::node_cast<ast::While>(stmt)){
+            // The loop's own assignments are found once, and passed on to the loop around it
+            LoopAssigns& inner = loop_assigns[while_stmt->tree_id];
+            collect_assigns(while_stmt->body, &inner);
+            if (loop == nullptr)
+                return;
+            loop->declarations.insert(inner.declarations.begin(), inner.declarations.end());
+            // An assignment in a nested loop may run many times
+            for (const auto& name : inner.increments)
+                loop->increments[name.first] = std::nullopt;
+        }
     }
 
-    std::ostream& operator<<(std::ostream& os, const ScopePrinter& printer){
-        os << "---begin global scope---" << std::endl;
-        os << printer.globalsBuffer.str();
-        os << printer.buffer.str();
-        os << "---end global scope---" << std::endl;
-        return os;
+    void MyVisitor::enter_loop_ranges(ast::While& node){
+        const LoopAssigns& assigns = loop_assigns[node.tree_id];
+        for (ast::NodeId declaration : assigns.declarations){
+            auto data = variables.find(declaration);
+            // Not declared yet - a variable of the loop body
+            if (data == variables.end())
+                continue;
+            const Variable& var = data->second;
+            ast::SymbolId name = var.symbol;
+            auto known = var_ranges.find(var.llvm_var);
+            if (known == var_ranges.end())
+                continue;
+
+            // Induction variable: it only grows, and stops growing once it passes the bound.
+            // The bound plus one round of increments must not wrap around.
+            std::optional<long long> bound = loop_bound(node.condition, name);
+            std::optional<long long> step = assigns.increments.at(name);
+            if (bound && step && *bound + *step <= type_range(var.type).hi){
+                known->second.hi = std::max(known->second.hi, *bound + *step);
+                continue;
+            }
+            var_ranges.erase(known);
+        }
     }
 
-    MyVisitor::MyVisitor() :
-        printer(ScopePrinter()), last_type(ast::BuiltInType::VOID), last_func_id(""), table_stack(), offset_stack(), zero_div_error_var_name(){}
+    // Ranges that hold after either of two paths
+    static std::map<std::string, ValueRange> join_ranges(const std::map<std::string, ValueRange>& first,
+        const std::map<std::string, ValueRange>& second){
+        std::map<std::string, ValueRange> joined;
+        for (const auto& range : first){
+            auto other = second.find(range.first);
+            if (other != second.end())
+                joined[range.first] = { std::min(range.second.lo, other->second.lo), std::max(range.second.hi, other->second.hi) };
+        }
+        return joined;
+    }
 
     void MyVisitor::visit(ast::ID& node){
-        std::shared_ptr<SymbolData> data = check_exists_by_name(node.value);
+        const Variable& var = variable(node);
 
-        // Check if we tried to use identifier without him being declared.
-        if (data == nullptr)
-            errorUndef(node.line, node.value);
+        if (var.const_value){
+            node.const_value = var.const_value;
+            node.ir_value = constant(var.type, *var.const_value);
+            last_range = { *var.const_value, *var.const_value };
+            return;
+        }
 
-        // Check if we tried to use a function identifier as var
-        if (data->is_func)
-            errorDefAsFunc(node.line, node.value);
+        auto known = var_ranges.find(var.llvm_var);
+        last_range = (known != var_ranges.end()) ? known->second : type_range(var.type);
 
-        this->last_type = data->type;
+        if (options.ssa){
+            node.ir_value = ssa_env.at(var.llvm_var);
+            return;
+        }
 
         // Load data from memory (from stack)
-        std::string loaded_var = code_buffer.freshVar();
-        code_buffer.emit(loaded_var + " = load" + I32 + "," + I32ptr + " " + data->llvm_var);
-
-        node.var_name = loaded_var;
+        node.ir_value = func->load(var.address);
     }
 
     void MyVisitor::visit(ast::If& node){
-        begin_scope(table_stack.top(), false);
+        begin_scope();
 
-        code_buffer.emit("; >>> evaluating if condition");
-        node.condition->accept(*this);
-        // Check if condition isn't bool
-        if (this->last_type != ast::BuiltInType::BOOL)
-            errorMismatch(node.condition->line);
+        ir::BlockId if_label = func->new_block();
+        ir::BlockId label_end = func->new_block();
 
-        // translate condition to i1 for branching
-        std::string cond_i1 = code_buffer.freshVar();
-        code_buffer.emit(cond_i1 + " = icmp ne i32 " + node.condition->var_name + ", 0");
-        
-        std::string if_label = code_buffer.freshLabel();
-        std::string label_end = code_buffer.freshLabel();
+        ir::BlockId else_label = (node.otherwise) ? func->new_block() : label_end;
 
-        std::string else_label = (node.otherwise) ? code_buffer.freshLabel() : label_end;
-        
-        code_buffer.emit("br i1 " + cond_i1 + ", label " + if_label + ", label " + else_label);
-        code_buffer.emit("; >>> then block");
-        code_buffer.emitLabel(if_label);
-        node.then->accept(*this);
+        // The condition jumps straight to the then/else blocks
+        std::map<std::string, ValueRange> ranges_before = var_ranges;
+        std::optional<bool> known = emit_condition(*node.condition, if_label, else_label);
+        if (known)
+            emit_br(*known ? if_label : else_label);
+        emit_label(if_label);
+        refine_ranges(*node.condition, true);
+        dispatch(*node.then);
         // Removing from scope stack
         end_scope();
 
-        code_buffer.emit("br label " + label_end);
+        emit_br(label_end);
+        std::map<std::string, ValueRange> ranges_then = std::move(var_ranges);
+        var_ranges = std::move(ranges_before);
+        refine_ranges(*node.condition, false);
 
         // Starting scope for else
         // If there is an else and it is not null
         if (node.otherwise){
-            code_buffer.emit("; >>> else block");
-            code_buffer.emitLabel(else_label);
-            begin_scope(table_stack.top(), false);
+            emit_label(else_label);
+            begin_scope();
             is_func_body = true;
-            node.otherwise->accept(*this);
+            dispatch(*node.otherwise);
             is_func_body = false;
             end_scope();
 
-            code_buffer.emit("br label " + label_end);
+            emit_br(label_end);
         }
-        code_buffer.emit("; >>> end if");
-        code_buffer.emitLabel(label_end);
+        emit_label(label_end);
+        var_ranges = join_ranges(ranges_then, var_ranges);
     }
 
     void MyVisitor::visit(ast::Or& node){
-        // Evaluate Left
-        node.left->accept(*this);
-        if (this->last_type != ast::BuiltInType::BOOL){
-            errorMismatch(node.line);
-        }
-        std::string left_val = node.left->var_name;
-
-        // translate to i1
-        std::string left_i1 = code_buffer.freshVar();
-        code_buffer.emit(left_i1 + " = icmp ne i32 " + left_val + ", 0");
-
-        std::string label_eval_right = code_buffer.freshLabel();
-        std::string label_end = code_buffer.freshLabel();
-
-        // known label for left side
-        std::string label_left_anchor = code_buffer.freshLabel();
-        code_buffer.emit("br label " + label_left_anchor);
-        code_buffer.emitLabel(label_left_anchor);
-
-        // Branch: if true -> jump to end (Short Circuit), else -> evaluate right
-        code_buffer.emit("br i1 " + left_i1 + ", label " + label_end + ", label " + label_eval_right);
-
-        // Evaluate Right
-        code_buffer.emitLabel(label_eval_right);
-        node.right->accept(*this);
-        if (this->last_type != ast::BuiltInType::BOOL){
-            errorMismatch(node.line);
-        }
-        std::string right_val = node.right->var_name;
-        
-        std::string right_i1 = code_buffer.freshVar();
-        code_buffer.emit(right_i1 + " = icmp ne i32 " + right_val + ", 0");
-
-        // known label for right side
-        std::string label_right_anchor = code_buffer.freshLabel();
-        code_buffer.emit("br label " + label_right_anchor);
-        code_buffer.emitLabel(label_right_anchor);
-        
-        code_buffer.emit("br label " + label_end);
-
-        // Merge (Phi)
-        code_buffer.emitLabel(label_end);
-        std::string phi_res = code_buffer.freshVar();
-        
-        code_buffer.emit(phi_res + " = phi i1 [ true, " + label_left_anchor + " ], [ " + right_i1 + ", " + label_right_anchor + " ]");
-        
-        node.var_name = code_buffer.freshVar();
-        code_buffer.emit(node.var_name + " = zext i1 " + phi_res + " to i32");
+        materialize_condition(node);
     }
 
     void MyVisitor::visit(ast::And& node) {
-        // Evaluate Left
-        node.left->accept(*this);
-        if (this->last_type != ast::BuiltInType::BOOL){
-            errorMismatch(node.line);
-        }
-        std::string left_val = node.left->var_name;
-        
-        std::string left_i1 = code_buffer.freshVar();
-        code_buffer.emit(left_i1 + " = icmp ne i32 " + left_val + ", 0");
-        
-        std::string label_eval_right = code_buffer.freshLabel();
-        std::string label_end = code_buffer.freshLabel();
-
-        // known label for left side
-        std::string label_left_anchor = code_buffer.freshLabel();
-        code_buffer.emit("br label " + label_left_anchor);
-        code_buffer.emitLabel(label_left_anchor);
-        
-        // Branch: if true -> evaluate right, else -> jump to end (Short Circuit False)
-        code_buffer.emit("br i1 " + left_i1 + ", label " + label_eval_right + ", label " + label_end);
-        
-        // Evaluate Right
-        code_buffer.emitLabel(label_eval_right);
-        node.right->accept(*this);
-        if (this->last_type != ast::BuiltInType::BOOL){
-            errorMismatch(node.line);
-        }
-        std::string right_val = node.right->var_name;
-
-        std::string right_i1 = code_buffer.freshVar();
-        code_buffer.emit(right_i1 + " = icmp ne i32 " + right_val + ", 0");
-        
-        // known label for right side
-        std::string label_right_anchor = code_buffer.freshLabel();
-        code_buffer.emit("br label " + label_right_anchor);
-        code_buffer.emitLabel(label_right_anchor);
-
-        code_buffer.emit("br label " + label_end);
-        
-        // Merge (Phi)
-        code_buffer.emitLabel(label_end);
-        std::string phi_res = code_buffer.freshVar();
-        
-        // Phi: [ 0, left_anchor ], [ right_val, right_anchor ]
-        code_buffer.emit(phi_res + " = phi i1 [ 0, " + label_left_anchor + " ], [ " + right_i1 + ", " + label_right_anchor + " ]");
-        
-        node.var_name = code_buffer.freshVar();
-        code_buffer.emit(node.var_name + " = zext i1 " + phi_res + " to i32");
+        materialize_condition(node);
     }
 
     void MyVisitor::visit(ast::Not& node){
-        node.exp->accept(*this);
+        dispatch(*node.exp);
 
-        // TODO: Type of not is always boolean?
-        if (this->last_type != ast::BuiltInType::BOOL){
-            errorMismatch(node.line);
+        if (node.exp->const_value){
+            node.const_value = !*node.exp->const_value;
+            node.ir_value = constant(ast::BuiltInType::BOOL, *node.const_value);
+            return;
         }
 
-        node.var_name = this->code_buffer.freshVar();
-        code_buffer.emit(node.var_name + " = xor" + I32 + " " + node.exp->var_name + ", 1");
+        node.ir_value = func->binop(ir::Opcode::Xor, node.exp->ir_value, constant(ast::BuiltInType::BOOL, true));
     }
 
     void MyVisitor::visit(ast::Num& node){
-        this->last_type = ast::BuiltInType::INT;
+        last_range = { node.value, node.value };
 
-        node.var_name = std::to_string(node.value);
+        node.const_value = node.value;
+        node.ir_value = constant(ast::BuiltInType::INT, node.value);
     }
 
     void MyVisitor::visit(ast::Bool& node){
-        this->last_type = ast::BuiltInType::BOOL;
-
-        node.var_name = std::to_string(node.value);
+        node.const_value = node.value;
+        node.ir_value = constant(ast::BuiltInType::BOOL, node.value);
     }
 
     void MyVisitor::visit(ast::Call& node){
-        std::shared_ptr<SymbolData> func_data = check_exists_by_name(node.func_id->value);
-        if (func_data == nullptr)
-            errorUndefFunc(node.line, node.func_id->value);
-        if (!func_data->is_func)
-            errorDefAsVar(node.line, node.func_id->value);
-
-        // Check argument count
-        std::vector<std::shared_ptr<ast::Exp>>& args = node.args->exps;
-        std::vector<ast::BuiltInType>& expected_types = func_data->func_types;
-
-        if (args.size() != expected_types.size()){
-            std::vector<std::string> expected_str;
-            for (auto t : expected_types)
-                expected_str.push_back(toupper(toString(t)));
-            errorPrototypeMismatch(node.line, node.func_id->value, expected_str);
-        }
+        const sema::Signature& signature = annotations.signature(annotations.declaration(node.func_id->tree_id));
+        std::vector<ast::Exp*>& args = node.args->exps;
 
         // To later call func with args
-        std::string args_str = "";
-
-        // Check argument types
+        std::vector<ir::Value> arg_values;
         for (size_t i = 0; i < args.size(); i++){
-            args[i]->accept(*this);
-            ast::BuiltInType arg_type = last_type;
-            ast::BuiltInType expected = expected_types[i];
-
-            // Check types
-            bool typesMatch = (arg_type == expected);
-            // Special case: Allow Byte -> Int
-            if (expected == ast::BuiltInType::INT && arg_type == ast::BuiltInType::BYTE)
-                typesMatch = true;
-            if (!typesMatch){
-                std::vector<std::string> expected_str;
-                for (auto t : expected_types)
-                    expected_str.push_back(toupper(toString(t)));
-                errorPrototypeMismatch(node.line, node.func_id->value, expected_str);
-            }
-
-            // Code buffer emit for args
-            if (i > 0) args_str += ", ";    // add comma between args
-
-            // Check if i8
-            std::string llvm_type_str = "i32";
-            if (arg_type == ast::BuiltInType::STRING) {
-                llvm_type_str = "i8*";
-            }
-
-            args_str += llvm_type_str + " " + args[i]->var_name;
+            dispatch(*args[i]);
+            arg_values.push_back(widen(*args[i], type_of(*args[i]), signature.params[i]));
         }
 
-        // Set return type for the Call expression
-        this->last_type = func_data->type;
-
-        if (func_data->type != ast::BuiltInType::VOID){
-            node.var_name = this->code_buffer.freshVar();
-            code_buffer.emit(node.var_name + " = call" + I32 + " @" + node.func_id->value + "(" + args_str + ")");
-        }
-        else{ //calling function that returns void
-            code_buffer.emit("call void @" + node.func_id->value + "(" + args_str + ")");
-        } // ToDO: check if parameter is String, if so, change I32 to I8ptr?
+        last_range = type_range(signature.return_type);
+        node.ir_value = func->call(llvm_type(signature.return_type), symbols.name(node.func_id->symbol), arg_values);
     }
 
     void MyVisitor::visit(ast::Cast& node){
-        node.exp->accept(*this);
-        ast::BuiltInType exp_type = last_type;
-
-        node.target_type->accept(*this);
-        ast::BuiltInType target_type = last_type;
-
-        if (!is_numeric_type(exp_type) || !is_numeric_type(target_type))
-            errorMismatch(node.line);
-
-        last_type = target_type;
+        dispatch(*node.exp);
+        ast::BuiltInType exp_type = type_of(*node.exp);
+        ast::BuiltInType target_type = node.target_type->type;
+
+        ValueRange bounds = type_range(target_type);
+        if (!bounds.contains(last_range.lo) || !bounds.contains(last_range.hi))
+            last_range = bounds;
+
+        if (node.exp->const_value){
+            int value = *node.exp->const_value;
+            node.const_value = (target_type == ast::BuiltInType::BYTE) ? (value & 255) : value;
+            node.ir_value = constant(target_type, *node.const_value);
+            return;
+        }
 
-        // code buffer emit
-        node.var_name = this->code_buffer.freshVar();
         if (exp_type == ast::BuiltInType::INT && target_type == ast::BuiltInType::BYTE) {
             // int to byte - truncation
-            code_buffer.emit(node.var_name + " = and" + I32 + " " + node.exp->var_name + ", 255");
-        } 
-        else { // Creating new var with same value for casting
-            code_buffer.emit(node.var_name + " = add" + I32 + " " + node.exp->var_name + ", 0");
+            node.ir_value = func->trunc(node.exp->ir_value, ir::Type::I8);
+        }
+        else { // Same type or byte to int
+            node.ir_value = widen(*node.exp, exp_type, target_type);
         }
     }
 
     void MyVisitor::visit(ast::NumB& node){
-        last_type = ast::BuiltInType::BYTE;
-        if (node.value > 255)
-            errorByteTooLarge(node.line, node.value);
+        last_range = { node.value, node.value };
 
-        node.var_name = std::to_string(node.value);
+        node.const_value = node.value;
+        node.ir_value = constant(ast::BuiltInType::BYTE, node.value);
     }
 
-    void MyVisitor::visit(ast::Type& node){
-        this->last_type = node.type;
-    }
+    // The types come from the annotations
+    void MyVisitor::visit(ast::Type& node){}
 
     void MyVisitor::visit(ast::BinOp& node){
-        ast::BuiltInType left, right;
-
-        node.left->accept(*this);
-        left = this->last_type;
+        dispatch(*node.left);
+        ast::BuiltInType left = type_of(*node.left);
+        ValueRange left_range = last_range;
 
-        node.right->accept(*this);
-        right = this->last_type;
+        dispatch(*node.right);
+        ast::BuiltInType right = type_of(*node.right);
+        ValueRange right_range = last_range;
 
-        bool isLeftNum = (left == ast::BuiltInType::INT || left == ast::BuiltInType::BYTE);
-        bool isRightNum = (right == ast::BuiltInType::INT || right == ast::BuiltInType::BYTE);
+        // The type with the bigger representation
+        ast::BuiltInType type = type_of(node);
+        last_range = binop_range(node.op, left_range, right_range, type);
 
-        if (!isLeftNum || !isRightNum){
-            errorMismatch(node.line);
+        // code buffer emit
+        bool isIntOperation = (type == ast::BuiltInType::INT);
+
+        int folded;
+        if (node.left->const_value && node.right->const_value &&
+            fold_binop(node.op, *node.left->const_value, *node.right->const_value, isIntOperation, folded)) {
+            node.const_value = folded;
+            node.ir_value = constant(type, folded);
+            return;
         }
 
-        // return type with bigger representation size
-        if (left == ast::BuiltInType::INT || right == ast::BuiltInType::INT)
-            this->last_type = ast::BuiltInType::INT;
-        else
-            this->last_type = ast::BuiltInType::BYTE;
+        // Byte operations are done in i8, which wraps around by itself. Mixed operations widen the byte.
+        ir::Value left_val = widen(*node.left, left, type);
+        ir::Value right_val = widen(*node.right, right, type);
 
-        
-
-        // code buffer emit
-        bool isIntOperation = (this->last_type == ast::BuiltInType::INT);
+        // A divisor that is known to be nonzero needs no check
+        bool needs_zero_check = right_range.contains(0);
+        if (node.op == ast::BinOpType::DIV)
+            (needs_zero_check ? zero_checks_emitted : zero_checks_elided)++;
 
-        node.var_name = this->code_buffer.freshVar();
+        if (node.op == ast::BinOpType::DIV && needs_zero_check) {
+            ir::BlockId label_false = func->new_block();
+            if (zero_div_trap_label == ir::NoBlock && !unreachable())
+                zero_div_trap_label = func->new_block();
 
-        if (node.op == ast::BinOpType::DIV) {
-            code_buffer.emit("\n; >>> check division by zero");
-            std::string label_true = this->code_buffer.freshLabel();
-            std::string label_false = this->code_buffer.freshLabel();
+            ir::Value is_zero = func->icmp(ir::Predicate::Eq, right_val, constant(type, 0));
+            // The trap block needs no variable values, so only the edge to label_false is tracked
+            add_edge(label_false);
+            func->cond_br(is_zero, zero_div_trap_label, label_false, true);
 
-            std::string is_zero = code_buffer.freshVar();
-            code_buffer.emit(is_zero + " = icmp eq" + I32 + " " + node.right->var_name + ", 0");
-            code_buffer.emit("br i1 " + is_zero + ", label " + label_true + ", label " + label_false);
-
-            code_buffer.emitLabel(label_true);
-            
-            std::string err_msg = "Error division by zero";
-            std::string len = std::to_string(err_msg.size() + 1);
-            if (zero_div_error_var_name.empty()) {
-                zero_div_error_var_name = code_buffer.emitString(err_msg);
-            }
-            
-            code_buffer.emit("call void @print(i8* getelementptr ([" + len + " x i8], [" + len + " x i8]* " + zero_div_error_var_name + ", i32 0, i32 0))");
-            code_buffer.emit("call void @exit(i32 0)");
-            code_buffer.emit("unreachable");
-            
-            code_buffer.emitLabel(label_false);
-            code_buffer.emit("; >>> end check division by zero\n");
+            emit_label(label_false);
         }
 
         switch (node.op) {
             case (ast::BinOpType::ADD):
-                code_buffer.emit(node.var_name + " = add" + I32 + " " + node.left->var_name + ", " + node.right->var_name);
+                node.ir_value = func->binop(ir::Opcode::Add, left_val, right_val);
                 break;
             case (ast::BinOpType::SUB):
-                code_buffer.emit(node.var_name + " = sub" + I32 + " " + node.left->var_name + ", " + node.right->var_name);
+                node.ir_value = func->binop(ir::Opcode::Sub, left_val, right_val);
                 break;
             case (ast::BinOpType::MUL):
-                code_buffer.emit(node.var_name + " = mul" + I32 + " " + node.left->var_name + ", " + node.right->var_name);
+                node.ir_value = func->binop(ir::Opcode::Mul, left_val, right_val);
                 break;
-            case (ast::BinOpType::DIV): //TODO: check
-                if (isIntOperation) {
-                    code_buffer.emit(node.var_name + " = sdiv i32 " + node.left->var_name + ", " + node.right->var_name);
-                } else {
-                    code_buffer.emit(node.var_name + " = udiv i32 " + node.left->var_name + ", " + node.right->var_name);
-                }
+            case (ast::BinOpType::DIV):
+                node.ir_value = func->binop(isIntOperation ? ir::Opcode::SDiv : ir::Opcode::UDiv, left_val, right_val);
                 break;
         }
-
-        // truncation for byte operations
-        if (this->last_type == ast::BuiltInType::BYTE) {
-            std::string truncated_val = code_buffer.freshVar();
-            // I want to remain in currect range of byte after operation
-            code_buffer.emit(truncated_val + " = and i32 " + node.var_name + ", 255");
-            node.var_name = truncated_val; 
-        }
     }
 
     void MyVisitor::visit(ast::Break& node){
-        // Check if we are in a loop scope and throw error if not
-        std::shared_ptr<SymbolTable> current_table = table_stack.top();
-        while (current_table != nullptr && !current_table->is_loop_scope) {
-            current_table = current_table->parent;
-        }
-        if (current_table == nullptr)
-            errorUnexpectedBreak(node.line);
-
-        code_buffer.emit("br label " + current_table->end_label);
-
-        // dummy label to avoid LLVM error about empty block
-        std::string dead_label = code_buffer.freshLabel();
-        code_buffer.emitLabel(dead_label);
-        return;
+        emit_br(loops.at(annotations.loop(node.tree_id)).end_label);
     }
 
     void MyVisitor::visit(ast::Funcs& node){
-        // begin_scope(nullptr, false);
-        table_stack.push(std::make_shared<SymbolTable>(nullptr, false));
-        insert(std::make_shared<SymbolData>("print", ast::BuiltInType::VOID), true, { ast::BuiltInType::STRING });
-        insert(std::make_shared<SymbolData>("printi", ast::BuiltInType::VOID), true, { ast::BuiltInType::INT });
-        code_buffer.emit("; =================================== Declarations of built-in functions ===================================");
-        code_buffer.emit("declare i32 @scanf(i8*, ...)");
-        code_buffer.emit("declare i32 @printf(i8*, ...)");
-        code_buffer.emit("declare void @exit(i32)");
-        code_buffer.emit("@.int_specifier_scan = constant [3 x i8] c\"%d\\00\"");
-        code_buffer.emit("@.int_specifier = constant [4 x i8] c\"%d\\0A\\00\"");
-        code_buffer.emit("@.str_specifier = constant [4 x i8] c\"%s\\0A\\00\"\n");
+        module.prelude = RUNTIME;
+
+        // Streaming: every function is written out as soon as it is generated, and then released.
+        // The global strings it uses are only written at the end. Without a file descriptor the
+        // functions are written to the code kept in the visitor. An error unwinding through here
+        // destroys the stream, which takes back what was written.
+        OutputBuffer* streamed = nullptr;
+        if (options.stream){
+            if (fd >= 0){
+                std::cout.flush();
+                stream = std::make_unique<StreamedOutput>(fd);
+                streamed = &stream->buffer();
+            }
+            else
+                streamed = &code;
+            *streamed << module.prelude;
+        }
 
-        code_buffer.emit("; =================================== Definitions of built-in functions ===================================");
-        code_buffer.emit("define i32 @readi(i32) {");
-        code_buffer.emit("\t%ret_val = alloca i32");
-        code_buffer.emit("\t%spec_ptr = getelementptr [3 x i8], [3 x i8]* @.int_specifier_scan, i32 0, i32 0");
-        code_buffer.emit("\tcall i32 (i8*, ...) @scanf(i8* %spec_ptr, i32* %ret_val)");
-        code_buffer.emit("\t%val = load i32, i32* %ret_val");
-        code_buffer.emit("\tret i32 %val");
-        code_buffer.emit("}\n");
+        if (options.threads > 1 && node.funcs.size() > 1)
+            generate_parallel(node, streamed);
+        else{
+            for (const auto& func : node.funcs){
+                func->accept(*this);
+                finish_function(streamed);
+            }
+        }
 
-        code_buffer.emit("define void @printi(i32) {");
-        code_buffer.emit("\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.int_specifier, i32 0, i32 0");
-        code_buffer.emit("\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i32 %0)");
-        code_buffer.emit("\tret void");
-        code_buffer.emit("}\n");
+        if (streamed){
+            ir::print_trailer(*streamed, module);
+            if (stream){
+                stream->commit();
+                stream.reset();
+            }
+        }
 
-        code_buffer.emit("define void @print(i8*) {");
-        code_buffer.emit("\t%spec_ptr = getelementptr [4 x i8], [4 x i8]* @.str_specifier, i32 0, i32 0");
-        code_buffer.emit("\tcall i32 (i8*, ...) @printf(i8* %spec_ptr, i8* %0)");
-        code_buffer.emit("\tret void");
-        code_buffer.emit("}\n");
+        if (cache != nullptr)
+            cache->count_functions(function_hits, function_misses);
+    }
 
-        code_buffer.emit("; =================================== End of built-in functions ===================================\n");
+    // Replaces the instructions of the function by its code printed with ir::print_fragment()
+    static void print_to_text(ir::Function& func){
+        OutputBuffer text;
+        ir::print_fragment(text, func);
+        ir::Function printed(func.name, func.return_type, func.params);
+        printed.strings = std::move(func.strings);
+        printed.text = text.str();
+        func = std::move(printed);
+    }
 
-        bool found_main = false;
-        for (const auto& func : node.funcs){
-            last_func_id = func->id->value;
+    // Entry of a printed function in the cache: the number of its strings, the strings one per line
+    // (a string constant has no newline in it), then its text
+    static std::string fragment_entry(const ir::Function& func){
+        OutputBuffer entry;
+        entry << func.strings.size() << '\n';
+        for (const std::string& str : func.strings)
+            entry << str << '\n';
+        entry << func.text;
+        return entry.str();
+    }
 
-            std::vector<ast::BuiltInType> param_types;
-            for (const auto& formal : func->formals->formals)
-                param_types.push_back(formal->type->type);
+    // Gives the function the strings and the text of the entry
+    static bool read_fragment_entry(const std::string& entry, ir::Function& func){
+        size_t line_end = entry.find('\n');
+        if (line_end == std::string::npos)
+            return false;
+        size_t count = std::strtoul(entry.c_str(), nullptr, 10);
+        size_t start = line_end + 1;
+        for (size_t i = 0; i < count; i++){
+            line_end = entry.find('\n', start);
+            if (line_end == std::string::npos)
+                return false;
+            func.strings.push_back(entry.substr(start, line_end - start));
+            start = line_end + 1;
+        }
+        func.text = entry.substr(start);
+        return !func.text.empty();
+    }
 
-            if (check_exists_by_name(func->id->value) != nullptr)
-                errorDef(func->id->line, func->id->value);
+    // CPU time of the calling thread
+    static double thread_cpu_seconds(){
+        struct timespec now;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &now);
+        return now.tv_sec + now.tv_nsec / 1e9;
+    }
 
-            insert(std::make_shared<SymbolData>(
-                last_func_id, func->return_type->type), true, param_types
-            );
+    void MyVisitor::finish_function(OutputBuffer* streamed){
+        if (streamed){
+            ir::print_function(*streamed, module, module.functions.back());
+            module.functions.clear();
         }
+    }
 
-        auto main_func = check_exists_by_name("main");
-        if (main_func == nullptr)
-            errorMainMissing();
-        if (main_func->type != ast::BuiltInType::VOID || main_func->func_types.size() != 0)
-            errorMainMissing();
+    MyVisitor::MyVisitor(const MyVisitor& parent, Worker) :
+        fd(-1), options(parent.options), symbols(parent.symbols), annotations(parent.annotations), cache(parent.cache){}
+
+    void MyVisitor::generate_parallel(ast::Funcs& node, OutputBuffer* streamed){
+        /* Result of one function: its code, or what it threw */
+        struct Slot{
+            std::optional<ir::Function> code;
+            std::exception_ptr error;
+            bool done = false;
+        };
+
+        const size_t count = node.funcs.size();
+        std::vector<Slot> slots(count);
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::atomic<size_t> next(0);
+        // The functions after the first one with an error are not needed: the error stops the compilation
+        std::atomic<size_t> first_error(count);
+        std::atomic<bool> stop(false);
+
+        auto work = [&](){
+            MyVisitor worker(*this, Worker());
+            ast::Arena arena;
+            for (size_t i = next++; i < count && i < first_error && !stop; i = next++){
+                Slot result;
+                try{
+                    ast::FuncDecl* func = node.funcs[i];
+                    func->accept(worker, arena);
+                    result.code = std::move(worker.module.functions.back());
+                    worker.module.functions.clear();
+                    // Printing is most of the work left, it is done here too. Only the numbers of the
+                    // strings are left for when the function is added to the module.
+                    if (result.code->text.empty())
+                        print_to_text(*result.code);
+                }
+                catch (...){
+                    result.error = std::current_exception();
+                    size_t first = first_error;
+                    while (i < first && !first_error.compare_exchange_weak(first, i)){}
+                }
+                result.done = true;
+                std::lock_guard<std::mutex> lock(mutex);
+                slots[i] = std::move(result);
+                finished.notify_all();
+            }
 
+            double seconds = thread_cpu_seconds();
+            std::lock_guard<std::mutex> lock(mutex);
+            worker_seconds += seconds;
+            zero_checks_emitted += worker.zero_checks_emitted;
+            zero_checks_elided += worker.zero_checks_elided;
+            function_hits += worker.function_hits;
+            function_misses += worker.function_misses;
+        };
+
+        /* The worker threads, stopped and joined however this returns */
+        struct Workers{
+            std::vector<std::thread> threads;
+            std::atomic<bool>& stop;
+
+            ~Workers(){
+                join();
+            }
 
-        for (const auto& func : node.funcs){
-            last_func_id = func->id->value;
-            func->accept(*this);
+            void join(){
+                stop = true;
+                for (auto& thread : threads)
+                    thread.join();
+                threads.clear();
+            }
+        } workers{ {}, stop };
+        for (unsigned i = 0; i < options.threads; i++)
+            workers.threads.emplace_back(work);
+        double merge_start = thread_cpu_seconds();
+
+        // Every function before the first error is done by some worker, and that function itself is too
+        for (size_t i = 0; i < count; i++){
+            Slot slot;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                finished.wait(lock, [&](){ return slots[i].done; });
+                slot = std::move(slots[i]);
+            }
+            if (slot.error){
+                workers.join();
+                std::rethrow_exception(slot.error);
+            }
+            module.functions.push_back(std::move(*slot.code));
+            finish_function(streamed);
         }
-
-        table_stack.pop();
-        //std::cout << printer;
+        merge_seconds = thread_cpu_seconds() - merge_start;
     }
 
-    void MyVisitor::visit(ast::RelOp& node){
-        ast::BuiltInType left, right;
-
-        node.left->accept(*this);
-        left = last_type;
+    ir::Value MyVisitor::emit_relop(ast::RelOp& node){
+        dispatch(*node.left);
+        ast::BuiltInType left = type_of(*node.left);
 
-        node.right->accept(*this);
-        right = last_type;
+        dispatch(*node.right);
+        ast::BuiltInType right = type_of(*node.right);
 
-        if (!is_numeric_type(left) || !is_numeric_type(right)){
-            errorMismatch(node.line);
+        if (node.left->const_value && node.right->const_value){
+            node.const_value = fold_relop(node.op, *node.left->const_value, *node.right->const_value);
+            node.ir_value = constant(ast::BuiltInType::BOOL, *node.const_value);
+            return node.ir_value;
         }
 
-        last_type = ast::BuiltInType::BOOL;
+        // Two bytes are compared as unsigned i8, otherwise the byte side is widened to i32
+        bool is_byte_cmp = (left == ast::BuiltInType::BYTE && right == ast::BuiltInType::BYTE);
+        ast::BuiltInType cmp_type = is_byte_cmp ? ast::BuiltInType::BYTE : ast::BuiltInType::INT;
+        ir::Value left_val = widen(*node.left, left, cmp_type);
+        ir::Value right_val = widen(*node.right, right, cmp_type);
 
-
-        // code buffer emit
-        node.var_name = this->code_buffer.freshVar();
-
-        std::string op;
+        ir::Predicate pred = ir::Predicate::Eq;
         switch (node.op) {
             case (ast::RelOpType::EQ):
-                op = "eq";
+                pred = ir::Predicate::Eq;
                 break;
             case (ast::RelOpType::NE):
-                op = "ne";
+                pred = ir::Predicate::Ne;
                 break;
             case (ast::RelOpType::LT):
-                op = "slt";
+                pred = is_byte_cmp ? ir::Predicate::Ult : ir::Predicate::Slt;
                 break;
             case (ast::RelOpType::GT):
-                op = "sgt";
+                pred = is_byte_cmp ? ir::Predicate::Ugt : ir::Predicate::Sgt;
                 break;
             case (ast::RelOpType::LE):
-                op = "sle";
+                pred = is_byte_cmp ? ir::Predicate::Ule : ir::Predicate::Sle;
                 break;
             case (ast::RelOpType::GE):
-                op = "sge";
+                pred = is_byte_cmp ? ir::Predicate::Uge : ir::Predicate::Sge;
                 break;
         }
 
-        std::string i1_val = code_buffer.freshVar();
-        code_buffer.emit(i1_val + " = icmp " + op + I32 + " " + node.left->var_name + ", " + node.right->var_name);
-        node.var_name = code_buffer.freshVar(); // התוצאה הסופית שתישמר בעץ
-        code_buffer.emit(node.var_name + " = zext i1 " + i1_val + " to i32");
+        return func->icmp(pred, left_val, right_val);
+    }
+
+    void MyVisitor::visit(ast::RelOp& node){
+        ir::Value i1_val = emit_relop(node);
+        if (!node.const_value)
+            node.ir_value = i1_val;
     }
 
     void MyVisitor::visit(ast::While& node){
-        begin_scope(table_stack.top(), false);
-        code_buffer.emit("; >>> Begin while condition evaluation");
-        std::string while_label = code_buffer.freshLabel();
-        std::string cond_label = code_buffer.freshLabel();
-        std::string final_label = code_buffer.freshLabel();
+        begin_scope();
+        ir::BlockId while_label = func->new_block();
+        ir::BlockId cond_label = func->new_block();
+        ir::BlockId final_label = func->new_block();
 
-        code_buffer.emit("br label " + cond_label);
+        emit_br(cond_label);
         // Doing condition check again
-        code_buffer.emitLabel(cond_label);
-        node.condition->accept(*this);
+        std::vector<LoopPhi> loop_phis = emit_loop_header(cond_label);
+        enter_loop_ranges(node);
+        std::map<std::string, ValueRange> ranges_header = var_ranges;
 
-        // Check if condition isn't bool
-        if (this->last_type != ast::BuiltInType::BOOL)
-            errorMismatch(node.condition->line);
+        // The condition jumps straight to the body or out of the loop
+        std::optional<bool> known = emit_condition(*node.condition, while_label, final_label);
+        if (known)
+            emit_br(*known ? while_label : final_label);
 
-        // translate condition to i1 for branching
-        std::string cond2_i1 = code_buffer.freshVar();
-        code_buffer.emit(cond2_i1 + " = icmp ne i32 " + node.condition->var_name + ", 0");
-
-        code_buffer.emit("br i1 " + cond2_i1 + ", label " + while_label + ", label " + final_label);
-
-        begin_scope(table_stack.top(), true);
+        begin_scope();
 
         // Saving for break and continue
-        table_stack.top()->end_label = final_label;
-        table_stack.top()->loop_label = cond_label;
+        loops[node.tree_id] = { final_label, cond_label };
+        refine_ranges(*node.condition, true);
 
-        code_buffer.emit("; >>> Begin while code");
-        code_buffer.emitLabel(while_label);
+        emit_label(while_label);
 
         is_func_body = true;
 
-        node.body->accept(*this);
-        code_buffer.emit("br label " + cond_label);
+        dispatch(*node.body);
+        emit_br(cond_label);
+        close_loop_header(cond_label, loop_phis);
         
         is_func_body = false;
 
+        loops.erase(node.tree_id);
         end_scope();
 
-        code_buffer.emit("; >>> end while block");
-        code_buffer.emitLabel(final_label);
+        emit_label(final_label);
+        var_ranges = std::move(ranges_header);
         end_scope();
     }
 
     void MyVisitor::visit(ast::Assign& node){
-        std::shared_ptr<SymbolData> data = check_exists_by_name(node.id->value);
-        if (data == nullptr)
-            errorUndef(node.line, node.id->value);
-        std::string target_address = data->llvm_var;
+        const Variable& var = variable(*node.id);
 
-        //node.id->accept(*this);
-        ast::BuiltInType id_type = data->type;
+        dispatch(*node.exp);
+        if (is_numeric_type(var.type))
+            var_ranges[var.llvm_var] = last_range;
 
-        node.exp->accept(*this);
-        ast::BuiltInType exp_type = this->last_type;
+        ir::Value value = widen(*node.exp, type_of(*node.exp), var.type);
 
-        if (id_type != exp_type){
-            // Allow Byte -> Int assignment
-            if (!(id_type == ast::BuiltInType::INT && exp_type == ast::BuiltInType::BYTE)){
-                errorMismatch(node.line);
-            }
+        if (options.ssa){
+            ssa_env[var.llvm_var] = value;
+            return;
         }
 
-        if (node.exp != nullptr){
-            if (std::dynamic_pointer_cast<ast::Bool>(node.exp) != nullptr ||
-                std::dynamic_pointer_cast<ast::NumB>(node.exp) != nullptr){
-
-                // temp var for zext
-                std::string zext_res = code_buffer.freshVar();
-                code_buffer.emit(zext_res + " = zext i8 " + node.exp->var_name + " to i32");
-                code_buffer.emit("store i32 " + zext_res + ", i32* " + target_address);
-            }
-            else {
-                code_buffer.emit("store" + I32 + " " + node.exp->var_name + "," + I32ptr + " " + target_address);
-            }
-        }
+        func->store(value, var.address);
     }
 
-    void MyVisitor::visit(ast::Formal& node){
-        std::shared_ptr<SymbolData> data = check_exists_by_name(node.id->value);
-
-        // Check if we already declared this id (name)
-        // We can't do shadowing! - that's why we don't check type
-        if (data != nullptr)
-            errorDef(node.line, node.id->value);
-
-        std::shared_ptr<SymbolData> new_data = std::make_shared<SymbolData>(node.id->value, node.type->type, arg_offset);
-        insert(new_data, false, {}, true);
-    }
+    // The arguments are declared by visit(FuncDecl)
+    void MyVisitor::visit(ast::Formal& node){}
 
     void MyVisitor::visit(ast::Return& node){
         // last type remains the same from exp
-        returns = true;
-
-        if (node.exp == nullptr)
-            last_type = ast::BuiltInType::VOID;
-        else
-            node.exp->accept(*this);
-
-        if (return_type != last_type && !(last_type == ast::BuiltInType::BYTE && return_type == ast::BuiltInType::INT))
-            errorMismatch(node.line);
+        ast::BuiltInType type = ast::BuiltInType::VOID;
+        if (node.exp != nullptr){
+            dispatch(*node.exp);
+            type = type_of(*node.exp);
+        }
 
-        if (last_type == ast::BuiltInType::VOID)
-            code_buffer.emit("ret void");
+        if (type == ast::BuiltInType::VOID)
+            func->ret_void();
         else
-            code_buffer.emit("ret" + I32 + " " + node.exp->var_name);
-        
-        // dummy label to avoid LLVM error about empty block
-        std::string dead_label = code_buffer.freshLabel();
-        code_buffer.emitLabel(dead_label);  
+            func->ret(widen(*node.exp, type, return_type));
+        terminate_block();
     }
 
     void MyVisitor::visit(ast::String& node){
-        last_type = ast::BuiltInType::STRING;
-
-        // code buffer addings - Assuming no \n \t \\ \" etc. !!!
-        std::string str = code_buffer.emitString(node.value);
-        int len = node.value.length() + 1;
-
-        node.var_name = code_buffer.freshVar();
-        //TODO: not sure about i8 - maybe need i32
-        code_buffer.emit(node.var_name + " = getelementptr [" + std::to_string(len) + " x i8], [" + std::to_string(len) + " x i8]* " + str + ", i32 0, i32 0");
+        // Assuming no \n \t \\ \" etc. !!!
+        ir::Value str = func->add_string(node.value);
+        node.ir_value = func->str_ptr(str);
     }
 
-    // we have ExpList only for function calls
-    void MyVisitor::visit(ast::ExpList& node){
-        auto& types = check_exists_by_name(last_func_id)->func_types;
+    // The arguments are visited by their Call
+    void MyVisitor::visit(ast::ExpList& node){}
 
-        std::vector<std::string> str_types;
-        for (const auto& t : types)
-            str_types.push_back(toupper(toString(t)));
+    void MyVisitor::visit(ast::Formals& node){}
 
-        size_t i = 0;
-        for (; i < node.exps.size(); i++){
-            node.exps[i]->accept(*this);
-            if (i >= types.size() || types[i] != last_type || (types[i] == ast::BuiltInType::STRING && last_func_id != "print"))
-                errorPrototypeMismatch(node.line, last_func_id, str_types);
+    void MyVisitor::visit(ast::VarDecl& node){
+        // Value the variable starts with, widened to its type
+        ir::Value init_value = constant(node.type->type, 0);
+        if (node.init_exp != nullptr){
+            dispatch(*node.init_exp);
+            init_value = widen(*node.init_exp, type_of(*node.init_exp), node.type->type);
         }
-        if (i < types.size())
-            errorPrototypeMismatch(node.line, last_func_id, str_types);
-    }
+        ValueRange init_range = (node.init_exp != nullptr) ? last_range : ValueRange{ 0, 0 };
 
-    void MyVisitor::visit(ast::Formals& node){
-        arg_offset = 0;
+        Variable& var = declare(node, *node.id, node.type->type);
+        int offset = annotations.offset(node.tree_id);
 
-        for (const auto& formal : node.formals){
-            arg_offset--;
-            formal->accept(*this);
+        // A constant that is never assigned needs no storage, its uses are replaced by the value
+        if (assigned_names.count(node.id->symbol) == 0){
+            if (node.init_exp == nullptr)
+                var.const_value = 0;
+            else if (node.init_exp->const_value)
+                var.const_value = node.init_exp->const_value;
         }
-
-        arg_offset = 0;
-    }
-
-    void MyVisitor::visit(ast::VarDecl& node){
-        std::shared_ptr<SymbolData> data = check_exists_by_name(node.id->value);
-
-        // Check if we already declared this id (name)
-        // We can't do shadowing! - that's why we don't check type
-        if (data != nullptr)
-            errorDef(node.line, node.id->value);
-
-        if (node.init_exp != nullptr){
-            node.init_exp->accept(*this);
-            ast::BuiltInType init_type = last_type;
-
-            if (init_type != node.type->type){
-                // Allow Byte -> Int assignment
-                if (!(node.type->type == ast::BuiltInType::INT && init_type == ast::BuiltInType::BYTE)){
-                    errorMismatch(node.line);
-                }
-            }
+        if (var.const_value){
+            node.id->ir_value = constant(node.type->type, *var.const_value);
+            return;
         }
 
-        node.id->var_name = this->code_buffer.freshVar();
-        code_buffer.emit(node.id->var_name + " = alloca" + I32);
+        if (options.ssa){
+            // The variable lives in registers only, llvm_var just identifies it
+            var.llvm_var = symbols.name(node.id->symbol) + "." + std::to_string(ssa_var_count++);
+            if (is_numeric_type(node.type->type))
+                var_ranges[var.llvm_var] = init_range;
+            ssa_var_types[var.llvm_var] = llvm_type(node.type->type);
+            ssa_env[var.llvm_var] = init_value;
+            node.id->ir_value = init_value;
+            return;
+        }
 
-        std::shared_ptr<SymbolData> new_data = std::make_shared<SymbolData>(node.id->value, node.type->type);
+        // The slot itself is allocated in the entry block, here we only (re)initialize it
+        var.address = frame_slot(offset, node.type->type);
+        node.id->ir_value = var.address;
         // Saving variable's llvm name
-        new_data->llvm_var = node.id->var_name;
-        insert(new_data);
-
+        var.llvm_var = slot_name(offset, node.type->type);
+        if (is_numeric_type(node.type->type))
+            var_ranges[var.llvm_var] = init_range;
 
-        if (node.init_exp != nullptr){
-            if (std::dynamic_pointer_cast<ast::Bool>(node.init_exp) != nullptr ||
-                std::dynamic_pointer_cast<ast::NumB>(node.init_exp) != nullptr){
-                // temp var fore zext
-                std::string zext_res = code_buffer.freshVar();
-                code_buffer.emit(zext_res + " = zext" + I8 + " " + node.init_exp->var_name + " to" + I32);
-
-                // saving to defined var
-                code_buffer.emit("store i32 " + zext_res + ", i32* " + node.id->var_name);
-            }
-            else {
-                code_buffer.emit("store" + I32 + " " + node.init_exp->var_name + "," + I32ptr + " " + node.id->var_name);
-
-            }
-        } else {
-            // deafult initialization to 0
-            code_buffer.emit("store i32 0, i32* " + node.id->var_name);
-        }
+        func->store(init_value, var.address);
     }
 
     void MyVisitor::visit(ast::Continue& node){
-        // Check if we are in a loop scope and throw error if not
-        std::shared_ptr<SymbolTable> current_table = table_stack.top();
-        while (current_table != nullptr && !current_table->is_loop_scope)
-            current_table = current_table->parent;
-        if (current_table == nullptr)
-            errorUnexpectedContinue(node.line);
-
-        code_buffer.emit("br label " + current_table->loop_label);
+        emit_br(loops.at(annotations.loop(node.tree_id)).loop_label);
+    }
 
-        // dummy label to avoid LLVM error about empty block
-        std::string dead_label = code_buffer.freshLabel();
-        code_buffer.emitLabel(dead_label);
-        return;
+    std::string MyVisitor::function_fingerprint(ast::FuncDecl& node){
+        Fingerprint fingerprint(symbols);
+        fingerprint.visit(node);
+        std::string& text = fingerprint.text;
+
+        // A global identifier is a function to call (or a name a variable may not take), with its types
+        text += '#';
+        for (ast::SymbolId id : fingerprint.identifiers){
+            const sema::Signature* global = annotations.function(id);
+            if (global == nullptr)
+                continue;
+            text += symbols.name(id);
+            text += '\0';
+            text += static_cast<char>('0' + global->return_type);
+            for (ast::BuiltInType type : global->params)
+                text += static_cast<char>('0' + type);
+            text += ';';
+        }
+        return std::move(text);
     }
 
     void MyVisitor::visit(ast::FuncDecl& node){
-
-        std::string func_name = node.id->value;
-        std::string ret_type;
-        if (node.return_type->type == ast::BuiltInType::VOID) 
-            ret_type = "void";
-        else if (node.return_type->type == ast::BuiltInType::STRING) 
-            ret_type = "i8*";
-        else 
-            ret_type = "i32";
-    
-        // Build Argument List for 'define'
-        std::string args_str = "";
+        // Argument list for 'define'
+        std::vector<ir::Type> params;
         auto& formals = node.formals->formals;
-        for (size_t i = 0; i < formals.size(); ++i) {
-            if (i > 0) args_str += ", ";
-            if (formals[i]->type->type == ast::BuiltInType::STRING)
-                args_str += "i8*";
-            else if (formals[i]->type->type == ast::BuiltInType::VOID)
-                args_str += "void";
-            else
-                args_str += "i32";
+        for (const auto& formal : formals)
+            params.push_back(llvm_type(formal->type->type));
+
+        module.functions.emplace_back(symbols.name(node.id->symbol), llvm_type(node.return_type->type), params);
+        func = &module.functions.back();
+
+        // A function whose code is in the cache is not generated again: with the same fingerprint it
+        // gets the same code
+        std::string cache_key;
+        if (cache != nullptr){
+            cache_key = fanc::CompileCache::function_key(function_fingerprint(node), options);
+            std::string entry;
+            if (cache->load_function(cache_key, entry) && read_fragment_entry(entry, *func)){
+                function_hits++;
+                return;
+            }
+            func->strings.clear();
+            function_misses++;
         }
-    
-        code_buffer.emit("define " + ret_type + " @" + func_name + "(" + args_str + ") {");
-        code_buffer.indent = "\t";
+        reachable_labels.clear();
+        variables.clear();
+        frame_slots.clear();
+        assigned_names.clear();
+        loop_assigns.clear();
+        var_ranges.clear();
+        collect_assigns(node.body, nullptr);
+        ssa_env.clear();
+        ssa_var_types.clear();
         // Prepare scope
-        begin_scope(table_stack.top(), false);
-        returns = false;
+        begin_scope();
         is_func_body = true;
         return_type = node.return_type->type;
     
@@ -962,53 +1391,66 @@ namespace output {
         // We need to store them in stack variables so we can modify them (since args are mutable in C/FanC)
         for (size_t i = 0; i < formals.size(); ++i) {
             auto formal = formals[i];
-            std::string arg_llvm_type;
-            if (formal->type->type == ast::BuiltInType::STRING)
-                arg_llvm_type = "i8*";
-            else if (formal->type->type == ast::BuiltInType::VOID)
-                arg_llvm_type = "void";
-            else
-                arg_llvm_type = "i32";
 
-            // Allocate stack slot
-            std::string stack_loc = code_buffer.freshVar(); // %tX
-            code_buffer.emit(stack_loc + " = alloca " + arg_llvm_type);
+            Variable& var = declare(*formal, *formal->id, formal->type->type);
+            int offset = annotations.offset(formal->tree_id);
+
+            if (options.ssa){
+                var.llvm_var = symbols.name(formal->id->symbol) + "." + std::to_string(ssa_var_count++);
+                ssa_var_types[var.llvm_var] = params[i];
+                ssa_env[var.llvm_var] = func->arg(i);
+                continue;
+            }
+
+            // Stack slot (allocated in the entry block)
+            var.address = frame_slot(offset, formal->type->type);
+            var.llvm_var = slot_name(offset, formal->type->type);
 
             // Store argument from register to stack
-            // Note: CodeBuffer::freshVar() creates %t0, %t1... 
-            // We need to refer to the function arguments which are implicit %0, %1...
-            std::string arg_reg = "%" + std::to_string(i);
-            code_buffer.emit("store " + arg_llvm_type + " " + arg_reg + ", " + arg_llvm_type + "* " + stack_loc);
-        
-            // Add to symbol table for variable lookup
-            std::shared_ptr<SymbolData> new_data = std::make_shared<SymbolData>(formal->id->value, formal->type->type);
-            new_data->llvm_var = stack_loc;
-            insert(new_data);
+            func->store(func->arg(i), var.address);
         }
     
-        node.body->accept(*this);
+        dispatch(*node.body);
     
         // Handle implicit return for void functions or if user forgot return
+        // (not needed if the body always ends with a return)
         if (node.return_type->type == ast::BuiltInType::VOID) {
-            code_buffer.emit("ret void");
+            func->ret_void();
         } else {
             // Adding a default return 0 if no return was encountered
-            code_buffer.emit("ret i32 0"); 
+            func->ret(constant(node.return_type->type, 0));
+        }
+
+        // Shared cold block for all the division by zero checks of the function
+        if (zero_div_trap_label != ir::NoBlock) {
+            func->place(zero_div_trap_label);
+            ir::Value error_str = func->add_string("Error division by zero");
+            func->call(ir::Type::Void, "print", { func->str_ptr(error_str) });
+            func->call(ir::Type::Void, "exit", { constant(ast::BuiltInType::INT, 0) });
+            func->unreachable();
+            zero_div_trap_label = ir::NoBlock;
         }
-        code_buffer.indent = "";
-        code_buffer.emit("}\n");
+
+        ir::thread_jumps(*func);
         end_scope();
+
+        // The function is kept as it is stored, so it is printed the same way as on a hit
+        if (cache != nullptr){
+            print_to_text(*func);
+            cache->store_function(cache_key, fragment_entry(*func));
+        }
     }
 
     void MyVisitor::visit(ast::Statements& node){
         bool clean = !is_func_body;
 
         if (clean)
-            begin_scope(table_stack.top(), false);
+            begin_scope();
 
         is_func_body = false;
+        // Statements after a return, break or continue are still checked, but emit no code (see unreachable)
         for (const auto& stmt : node.statements)
-            stmt->accept(*this);
+            dispatch(*stmt);
 
         if (clean)
             end_scope();
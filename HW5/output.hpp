@@ -2,246 +2,311 @@
 #define OUTPUT_HPP
 #include "visitor.hpp"
 #include "nodes.hpp"
+#include "ir.hpp"
+#include "sema.hpp"
 #include <utility>
 #include <vector>
 #include <string>
 #include <map>
-#include <sstream>
+#include <unordered_map>
+#include <algorithm>
+#include <set>
 #include <stack>
 #include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace fanc{
+    class CompileCache;
+}
 
 namespace output{
+    /* Error of the compiled program. The error functions throw it with the message to report,
+     * which aborts the compilation.
+     */
+    class CompileError : public std::runtime_error{
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
     /* Error handling functions */
 
-    void errorLex(int lineno);
+    [[noreturn]] void errorLex(int lineno);
 
-    void errorSyn(int lineno);
+    [[noreturn]] void errorSyn(int lineno);
 
-    void errorUndef(int lineno, const std::string& id);
+    [[noreturn]] void errorUndef(int lineno, const std::string& id);
 
-    void errorDefAsFunc(int lineno, const std::string& id);
+    [[noreturn]] void errorDefAsFunc(int lineno, const std::string& id);
 
-    void errorUndefFunc(int lineno, const std::string& id);
+    [[noreturn]] void errorUndefFunc(int lineno, const std::string& id);
 
-    void errorDefAsVar(int lineno, const std::string& id);
+    [[noreturn]] void errorDefAsVar(int lineno, const std::string& id);
 
-    void errorDef(int lineno, const std::string& id);
+    [[noreturn]] void errorDef(int lineno, const std::string& id);
 
-    void errorPrototypeMismatch(int lineno, const std::string& id, std::vector<std::string>& paramTypes);
+    [[noreturn]] void errorPrototypeMismatch(int lineno, const std::string& id, std::vector<std::string>& paramTypes);
 
-    void errorMismatch(int lineno);
+    [[noreturn]] void errorMismatch(int lineno);
 
-    void errorUnexpectedBreak(int lineno);
+    [[noreturn]] void errorUnexpectedBreak(int lineno);
 
-    void errorUnexpectedContinue(int lineno);
+    [[noreturn]] void errorUnexpectedContinue(int lineno);
 
-    void errorMainMissing();
+    [[noreturn]] void errorMainMissing();
 
-    void errorByteTooLarge(int lineno, int value);
+    [[noreturn]] void errorByteTooLarge(int lineno, int value);
 
-    /* CodeBuffer class
-     * This class is used to store the generated code.
-     * It provides a simple interface to emit code and manage labels and variables.
-     */
-    class CodeBuffer{
-    private:
-        std::stringstream globalsBuffer;
-        std::stringstream buffer;
-        int labelCount;
-        int varCount;
-        int stringCount;
+    // A byte or int literal too large to hold in an int, with its digits
+    [[noreturn]] void errorByteTooLarge(int lineno, const std::string &value);
 
-        friend std::ostream& operator<<(std::ostream& os, const CodeBuffer& buffer);
+    [[noreturn]] void errorIntTooLarge(int lineno, const std::string &value);
 
-    public:
-        std::string indent;
-        
-        CodeBuffer();
-
-        // Returns a string that represents a label not used before
-        // Usage examples:
-        //      emitLabel(freshLabel());
-        //      buffer << "br label " << freshLabel() << std::endl;
-        std::string freshLabel();
-
-        // Returns a string that represents a variable not used before
-        // Usage examples:
-        //      std::string var = freshVar();
-        //      buffer << var << " = icmp eq i32 0, 0" << std::endl;
-        std::string freshVar();
-
-        // Emits a label into the buffer
-        void emitLabel(const std::string& label);
-
-        // Emits a constant string into the globals section of the code.
-        // Returns the name of the constant. For the string of the length n (not including null character), the type is [n+1 x i8]
-        // Usage examples:
-        //      std::string str = emitString("Hello, World!");
-        //      buffer << "call i32 (i8*, ...) @printf(i8* getelementptr inbounds ([14 x i8], [14 x i8]* " << str << ", i32 0, i32 0))" << std::endl;
-        std::string emitString(const std::string& str);
-
-        // Emits a string into the buffer
-        void emit(const std::string& str);
-
-        // Template overload for general types
-        template<typename T>
-        CodeBuffer& operator<<(const T& value){
-            buffer << value;
-            return *this;
-        }
+    /* Code generation options */
+    struct Options{
+        // Keep variables in SSA registers, joined by phi nodes, instead of loading and storing stack slots
+        bool ssa = false;
+        // Report statistics about the generated code to stderr
+        bool stats = false;
+        // Write every function out as soon as it is generated, instead of keeping the whole program
+        bool stream = false;
+        // Threads generating the functions, each function on one of them. The code does not depend
+        // on the number of threads.
+        unsigned threads = 1;
+        // Only check the program for errors, generating no code
+        bool check = false;
+    };
+
+    /* Inclusive bounds of the values an int/byte expression may have */
+    struct ValueRange{
+        long long lo;
+        long long hi;
 
-        // Overload for manipulators (like std::endl)
-        CodeBuffer& operator<<(std::ostream& (*manip)(std::ostream&));
+        bool contains(long long value) const{
+            return lo <= value && value <= hi;
+        }
     };
 
-    std::ostream& operator<<(std::ostream& os, const CodeBuffer& buffer);
+    class MyVisitor final : public Visitor, public ast::StaticVisitor<MyVisitor>{
+    private:
+        /* A variable of the function code is generated for */
+        struct Variable{
+            ast::SymbolId symbol;
+            ast::BuiltInType type;
+            // Identifies the variable (SsaEnv, var_ranges). Not in SSA mode it is the name of its stack slot.
+            std::string llvm_var;
+            // Stack slot of the variable, not in SSA mode
+            ir::Value address;
+            // Set for variables that are initialized with a constant and never assigned
+            std::optional<int> const_value;
+        };
 
+        // SSA mode: current value of each variable in scope, keyed by its Variable::llvm_var
+        using SsaEnv = std::map<std::string, ir::Value>;
 
+        // SSA mode: phi node of a loop header whose incoming values are filled once the loop is closed
+        struct LoopPhi{
+            std::string var;
+            ir::Value phi;
+        };
 
-    // ======================================================================================
-    // ALL CODE FROM LAST HW (3)
-    // ======================================================================================
+        /* What the body of a loop assigns: the variables, and by name the sum of the increments
+         * `name = name + c` (c a positive literal) - nullopt if a name is assigned any other way, or inside
+         * a nested loop, where it may run many times */
+        struct LoopAssigns{
+            std::set<ast::NodeId> declarations;
+            std::map<ast::SymbolId, std::optional<long long>> increments;
+        };
 
-    class ScopePrinter{
-    private:
-        std::stringstream globalsBuffer;
-        std::stringstream buffer;
-        int indentLevel;
+        /* Targets of break and continue in a loop */
+        struct LoopLabels{
+            ir::BlockId end_label;
+            ir::BlockId loop_label;
+        };
 
-        std::string indent() const;
+        ir::Module module;
+        // Function code is currently generated for
+        ir::Function* func = nullptr;
+        // Where the code goes, -1 to keep it in code
+        int fd;
+        OutputBuffer code;
+        // Destination of the code in streaming mode, while the functions are generated
+        std::unique_ptr<StreamedOutput> stream;
+        Options options;
+        // Identifiers of the program, by their SymbolId
+        ast::Interner& symbols;
+        // Types and declarations of the nodes: the program was checked before any code is generated
+        const sema::Annotations& annotations;
+        // Where the code of each function is looked up before generating it, if anywhere
+        fanc::CompileCache* cache;
+        uint64_t function_hits = 0;
+        uint64_t function_misses = 0;
+        // CPU time the workers spent on the functions, and the main thread on adding them to the module
+        double worker_seconds = 0;
+        double merge_seconds = 0;
+
+        // Range of the last numeric expression visited
+        ValueRange last_range;
+
+        // Variables of the current function, by their declaration (a VarDecl or Formal)
+        std::unordered_map<ast::NodeId, Variable> variables;
+        // Declarations of the variables of the open scopes, innermost last, and where each scope starts
+        std::vector<ast::NodeId> scope_variables;
+        std::vector<size_t> scopes;
+        // Loops of the current function, by their While
+        std::unordered_map<ast::NodeId, LoopLabels> loops;
+        bool is_func_body = false;
+        ast::BuiltInType return_type;
+        // Block of the current function that reports division by zero, once it is needed
+        ir::BlockId zero_div_trap_label = ir::NoBlock;
+        // Stack frame of the current function: slot name -> the slot.
+        // Variables of the same type in disjoint scopes get the same offset (see insert()), so they share a slot.
+        std::map<std::string, ir::Value> frame_slots;
+        // Names assigned anywhere in the current function - those variables are never constants
+        std::set<ast::SymbolId> assigned_names;
+        // What the body of each loop of the current function assigns, by its While
+        std::unordered_map<ast::NodeId, LoopAssigns> loop_assigns;
+        // Ranges known for variables at the current point of the function, keyed by Variable::llvm_var.
+        // A variable without an entry may have any value of its type.
+        std::map<std::string, ValueRange> var_ranges;
+        int zero_checks_emitted = 0;
+        int zero_checks_elided = 0;
+
+        // Blocks that some reachable block branches to
+        std::set<ir::BlockId> reachable_labels;
+        SsaEnv ssa_env;
+        // SSA mode: llvm type of each variable, keyed like SsaEnv
+        std::map<std::string, ir::Type> ssa_var_types;
+        // SSA mode: every edge seen so far into a block, with the variable values flowing along it
+        std::map<ir::BlockId, std::vector<std::pair<ir::BlockId, SsaEnv>>> ssa_incoming;
+        int ssa_var_count = 0;
+
+        // Returns the stack slot for the given offset and type, allocating it on first use
+        ir::Value frame_slot(int offset, ast::BuiltInType type);
+
+        ast::BuiltInType type_of(const ast::Node& node) const{
+            return annotations.type(node.tree_id);
+        }
 
-    public:
-        ScopePrinter();
+        // The variable an identifier refers to
+        Variable& variable(const ast::ID& id){
+            return variables.find(annotations.declaration(id.tree_id))->second;
+        }
 
-        void beginScope();
+        void begin_scope(){
+            scopes.push_back(scope_variables.size());
+        }
 
-        void endScope();
+        // In SSA mode the variables of the scope stop having values
+        void end_scope(){
+            for (; scope_variables.size() > scopes.back(); scope_variables.pop_back()){
+                if (options.ssa)
+                    ssa_env.erase(variables.find(scope_variables.back())->second.llvm_var);
+            }
+            scopes.pop_back();
+        }
 
-        void emitVar(const std::string& id, const ast::BuiltInType& type, int offset);
+        // Adds a variable to the innermost scope
+        Variable& declare(const ast::Node& declaration, const ast::ID& id, ast::BuiltInType type){
+            scope_variables.push_back(declaration.tree_id);
+            Variable& var = variables[declaration.tree_id];
+            var = { id.symbol, type };
+            return var;
+        }
 
-        void emitFunc(const std::string& id, const ast::BuiltInType& returnType,
-            const std::vector<ast::BuiltInType>& paramTypes);
+        // Control flow helpers: every branch and label goes through these so that the reachable
+        // blocks (and in SSA mode the variable values along each edge) are tracked
+        void add_edge(ir::BlockId label);
 
-        friend std::ostream& operator<<(std::ostream& os, const ScopePrinter& printer);
-    };
+        void emit_br(ir::BlockId label);
 
-    class MyVisitor : public Visitor{
-    private:
-        struct SymbolData{
-            std::string name;
-            ast::BuiltInType type;
-            int offset;
-            bool is_func;
-            std::vector<ast::BuiltInType> func_types;
-            std::string llvm_var;
+        void emit_cond_br(ir::Value cond, ir::BlockId true_label, ir::BlockId false_label);
 
-            SymbolData(std::string name, ast::BuiltInType type, int offset = 0, bool is_func = false,
-                std::vector<ast::BuiltInType> func_types = {}, std::string llvm_var = "") :
-                name(std::move(name)), type(type), offset(offset),
-                is_func(is_func), 
-                func_types(std::move(func_types)), 
-                llvm_var(std::move(llvm_var)){}
-        };
+        // Ends the current block after a terminator (br, ret, unreachable) was emitted into it
+        void terminate_block();
 
-        struct SymbolTable{
-            std::shared_ptr<SymbolTable> parent;
-            bool is_loop_scope;
-            std::string end_label;
-            std::string loop_label;
+        // Whether the code emitted now can never run: the current block was terminated or nothing
+        // branches to it. Such code is still type checked, but it is not emitted.
+        bool unreachable() const{
+            return func->insert_block() == ir::NoBlock;
+        }
 
-            std::map<std::string, std::shared_ptr<SymbolData>> table;
-            int vars_count; // Add a counter for variables only - to handle offset for funcs and vars
+        // Starts a new block, which is unreachable if no reachable block branches to it.
+        // In SSA mode joins the values of all the edges into it with phi nodes.
+        void emit_label(ir::BlockId label);
 
-            SymbolTable(const std::shared_ptr<SymbolTable>& parent, bool is_loop_scope) :
-                parent(parent), is_loop_scope(is_loop_scope), vars_count(0){}
+        // Starts a loop header block. Its back edges are not known yet, so in SSA mode
+        // every variable gets a phi node which is completed by close_loop_header().
+        std::vector<LoopPhi> emit_loop_header(ir::BlockId label);
 
-            void insert(const std::shared_ptr<SymbolData>& sym_data){
-                table[sym_data->name] = sym_data;
-            }
+        void close_loop_header(ir::BlockId label, const std::vector<LoopPhi>& phis);
 
-            static std::shared_ptr<SymbolData> validate_existence(
-                const std::shared_ptr<SymbolTable>& sym_tab, const std::string& id){
-                auto lookup = sym_tab->table.find(id);
-                if (lookup != sym_tab->table.end())
-                    return lookup->second;
-                if (sym_tab->parent == nullptr)
-                    return nullptr;
-                return validate_existence(sym_tab->parent, id);
-            }
-        };
+        // Returns the value of an expression converted from type `from` to type `to`.
+        // Only a byte used as an int needs code (zext), anything else is used as is.
+        ir::Value widen(ast::Exp& exp, ast::BuiltInType from, ast::BuiltInType to);
 
-        ScopePrinter printer;
-        CodeBuffer code_buffer;
+        // Emits a bool expression as jumping code: control reaches true_label or false_label
+        // according to its value, without materializing it. If the value is known at compile time
+        // nothing is emitted and the value is returned instead.
+        std::optional<bool> emit_condition(ast::Exp& exp, ir::BlockId true_label, ir::BlockId false_label);
 
-        ast::BuiltInType last_type;
-        std::string last_func_id;
+        // Computes a bool expression (and/or) into an i1 value through emit_condition()
+        void materialize_condition(ast::Exp& exp);
 
-        std::stack<std::shared_ptr<SymbolTable>> table_stack;
-        std::stack<int> offset_stack;
-        int arg_offset = 0;
-        bool returns = false;
-        bool is_func_body = false;
-        ast::BuiltInType return_type;
-        std::string zero_div_error_var_name;
+        // Emits the i1 result of a relational operation (nothing if it is constant)
+        ir::Value emit_relop(ast::RelOp& node);
 
-        void begin_scope(const std::shared_ptr<SymbolTable>& parent, bool is_loop_scope){
-            printer.beginScope();
-            table_stack.push(std::make_shared<SymbolTable>(parent, is_loop_scope));
-        }
+        // Narrows var_ranges with what is known once a condition evaluated to `truth`
+        void refine_ranges(ast::Exp& cond, bool truth);
 
-        void end_scope(){
-            int vars_to_pop = table_stack.top()->vars_count;
+        // Fills assigned_names and loop_assigns in one walk over the function, instead of one over every
+        // loop: `loop` is the innermost loop around the statement, if any
+        void collect_assigns(ast::Statement* stmt, LoopAssigns* loop);
 
-            for (size_t i = 0; i < vars_to_pop; i++)
-                offset_stack.pop();
+        // Makes var_ranges valid on every iteration of a loop: variables the loop only increments,
+        // under a bound checked by its condition, keep a range; other variables it assigns lose theirs
+        void enter_loop_ranges(ast::While& node);
 
-            table_stack.pop();
-            printer.endScope();
-        }
+        /* Generating the functions on several threads */
 
-        void insert(const std::shared_ptr<SymbolData>& sym_data, bool is_func = false,
-            std::vector<ast::BuiltInType> func_types = {}, bool is_arg = false){
-            table_stack.top()->insert(sym_data);
+        struct Worker{};
 
-            if (is_func){   //TODO: not sure, a function doesn't have an offset
-                sym_data->is_func = true;
-                sym_data->func_types = std::move(func_types);
-                printer.emitFunc(sym_data->name, sym_data->type, sym_data->func_types);
-            }
-            else{
-                table_stack.top()->vars_count++;
-
-                int offset;
-                if (is_arg){
-                    offset = arg_offset;
-                }
-                else{
-                    if (offset_stack.empty())
-                        offset = 0;
-                    else{
-                        int top = offset_stack.top();
-                        offset = (top >= 0) ? top + 1 : 0;
-                    }
-
-                }
-                // int offset = (is_arg) ? arg_offset : (offset_stack.empty() ? 0 : offset_stack.top() + 1);
-                sym_data->offset = offset;
-                offset_stack.push(offset);
-                printer.emitVar(sym_data->name, sym_data->type, sym_data->offset);
-            }
-        }
+        // Visitor for a worker thread, which keeps the functions it generates in its own module
+        MyVisitor(const MyVisitor& parent, Worker);
 
-        std::shared_ptr<SymbolData> check_exists_by_name(const std::string& id){
-            if (table_stack.empty())
-                return nullptr;
-            return SymbolTable::validate_existence(table_stack.top(), id);
-        }
+        // Generates the functions on options.threads workers, and adds them to the module in order
+        void generate_parallel(ast::Funcs& node, OutputBuffer* streamed);
+
+        // The function added last to the module is complete: when streaming, it is written out and dropped
+        void finish_function(OutputBuffer* streamed);
+
+        // Everything the code of a function depends on: the function itself, and what the global
+        // identifiers it uses are
+        std::string function_fingerprint(ast::FuncDecl& node);
 
     public:
-        MyVisitor();
+        // The code is written to the file descriptor, or kept in the visitor when it is -1
+        // The program must have been checked by sema::analyze(), which made the annotations
+        MyVisitor(ast::Interner& symbols, const sema::Annotations& annotations, const Options& options = Options(),
+            int fd = STDOUT_FILENO, fanc::CompileCache* cache = nullptr);
+
+        // Writes out the generated code
+        void print_buf();
+
+        // The generated code, when it is kept in the visitor
+        std::string code_str() const{
+            return code.str();
+        }
 
-        void print_buf(){
-            std::cout << code_buffer;
+        void print_stats(std::ostream& os) const{
+            os << "division by zero checks: " << zero_checks_emitted << " emitted, "
+               << zero_checks_elided << " elided" << std::endl;
+            if (options.threads > 1)
+                os << "threads: " << options.threads << " workers, CPU " << worker_seconds * 1000
+                   << " ms generating, main thread " << merge_seconds * 1000 << " ms adding to the module" << std::endl;
+            if (cache != nullptr)
+                os << "functions: " << function_hits << " from the cache (not counted above), "
+                   << function_misses << " generated" << std::endl;
         }
         
         void visit(ast::Num& node) override;
@@ -55,7 +55,7 @@
 #define YYSKELETON_NAME "yacc.c"
 
 /* Pure parsers.  */
-#define YYPURE 0
+#define YYPURE 2
 
 /* Push parsers.  */
 #define YYPUSH 0
@@ -67,26 +67,18 @@
 
 
 /* First part of user prologue.  */
-#line 1 "parser.y"
+#line 11 "parser.y"
 
 
-#include "nodes.hpp"
+#include "flat_ast.hpp"
 #include "output.hpp"
 
-// bison declarations
-extern int yylineno;
-extern int yylex();
-
-void yyerror(const char*);
-
-// root of the AST, set by the parser and used by other parts of the compiler
-std::shared_ptr<ast::Node> program;
-
 using namespace std;
+using ast::Kind;
 
 // TODO: Place any additional declarations here
 
-#line 90 "parser.tab.c"
+#line 82 "parser.tab.c"
 
 # ifndef YY_CAST
 #  ifdef __cplusplus
@@ -174,6 +166,20 @@ typedef enum yysymbol_kind_t yysymbol_kind_t;
 
 
 
+/* Unqualified %code blocks.  */
+#line 22 "parser.y"
+
+// The stacks of the parser start small and double whenever the program nests deeper (YYSTYPE is trivial,
+// so bison may move them): how deep a program may nest is only limited by memory.
+#define YYMAXDEPTH (1 << 28)
+
+// bison declarations
+int yylex(YYSTYPE *yylval, yyscan_t scanner);
+int yyget_lineno(yyscan_t scanner);
+
+void yyerror(yyscan_t scanner, ast::FlatTree &tree, const char*);
+
+#line 183 "parser.tab.c"
 
 #ifdef short
 # undef short
@@ -494,9 +500,9 @@ union yyalloc
 #endif /* !YYCOPY_NEEDED */
 
 /* YYFINAL -- State number of the termination state.  */
-#define YYFINAL  10
+#define YYFINAL  3
 /* YYLAST -- Last index in YYTABLE.  */
-#define YYLAST   335
+#define YYLAST   334
 
 /* YYNTOKENS -- Number of terminals.  */
 #define YYNTOKENS  41
@@ -505,7 +511,7 @@ union yyalloc
 /* YYNRULES -- Number of rules.  */
 #define YYNRULES  55
 /* YYNSTATES -- Number of states.  */
-#define YYNSTATES  108
+#define YYNSTATES  107
 
 /* YYMAXUTOK -- Last valid token kind.  */
 #define YYMAXUTOK   295
@@ -558,12 +564,12 @@ static const yytype_int8 yytranslate[] =
 /* YYRLINE[YYN] -- Source line where rule number YYN was defined.  */
 static const yytype_uint8 yyrline[] =
 {
-       0,    67,    67,    71,    72,    75,    79,    80,    83,    84,
-      87,    88,    91,    94,    95,    98,    99,   100,   101,   102,
-     103,   104,   105,   106,   107,   108,   109,   112,   113,   116,
-     117,   120,   121,   122,   125,   126,   127,   128,   129,   130,
-     131,   132,   133,   134,   135,   136,   137,   138,   139,   140,
-     141,   142,   143,   144,   145,   146
+       0,    86,    86,    90,    91,    94,    97,    98,   101,   102,
+     105,   106,   109,   112,   113,   116,   117,   118,   119,   120,
+     121,   122,   123,   124,   125,   126,   127,   130,   131,   134,
+     135,   138,   139,   140,   143,   144,   145,   146,   147,   148,
+     149,   150,   151,   152,   153,   154,   155,   156,   157,   158,
+     159,   160,   161,   162,   163,   164
 };
 #endif
 
@@ -596,7 +602,7 @@ yysymbol_name (yysymbol_kind_t yysymbol)
 }
 #endif
 
-#define YYPACT_NINF (-30)
+#define YYPACT_NINF (-29)
 
 #define yypact_value_is_default(Yyn) \
   ((Yyn) == YYPACT_NINF)
@@ -610,17 +616,17 @@ yysymbol_name (yysymbol_kind_t yysymbol)
    STATE-NUM.  */
 static const yytype_int16 yypact[] =
 {
-      11,   -30,   -30,   -30,   -30,     3,   -30,    11,   -23,   -30,
-     -30,   -30,   -16,     6,   -15,   -30,     7,    -1,     0,     6,
-     -30,    97,   -30,    26,     4,    19,    21,    23,   -17,    97,
-      67,   -30,    47,    35,   -30,   -30,   -30,    33,   -30,   -30,
-     -30,   197,   114,   -30,   216,   197,   197,   -30,   -30,   197,
-     183,    84,   -30,   -30,   -30,   -13,   -30,    34,   130,   197,
-     197,   -30,   197,   197,   197,   197,   197,   197,   197,   197,
-     197,   197,   153,   176,   239,   -30,    40,   262,   -30,   -30,
-     197,   197,   -30,   306,   296,    65,    65,    65,    65,   142,
-     142,     5,     5,   -30,   -30,    97,    97,   -30,   -30,   197,
-     285,   -30,    56,   -30,   -30,   -30,    97,   -30
+     -29,    10,     0,   -29,   -29,   -29,   -29,   -29,   -29,   -13,
+     -29,    -9,     8,    -8,    14,   -29,     5,    16,     8,   -29,
+     105,   -29,   217,    33,    34,    53,    54,   -17,   105,    75,
+     -29,    56,    46,   -29,   -29,   -29,    43,   -29,   -29,   -29,
+     205,   118,   -29,   236,   205,   205,   -29,   -29,   205,   189,
+      88,   -29,   -29,   -29,    12,   -29,    47,   136,   205,   205,
+     -29,   205,   205,   205,   205,   205,   205,   205,   205,   205,
+     205,   159,   182,   259,   -29,   -11,   293,   -29,   -29,   205,
+     205,   -29,    36,   305,    20,    20,    20,    20,   110,   110,
+      23,    23,   -29,   -29,   105,   105,   -29,   205,   -29,   282,
+     -29,    69,   -29,   293,   -29,   105,   -29
 };
 
 /* YYDEFACT[STATE-NUM] -- Default reduction number in state STATE-NUM.
@@ -628,31 +634,31 @@ static const yytype_int16 yypact[] =
    means the default is an error.  */
 static const yytype_int8 yydefact[] =
 {
-       3,     6,    31,    32,    33,     0,     2,     3,     0,     7,
-       1,     4,     0,     8,     0,     9,    10,     0,     0,     0,
-      12,     0,    11,     0,     0,     0,     0,     0,     0,     0,
-       0,    13,     0,     0,    44,    45,    20,    39,    41,    42,
-      43,     0,     0,    40,     0,     0,     0,    25,    26,     0,
-       0,     0,     5,    14,    19,     0,    46,     0,     0,     0,
-       0,    21,     0,     0,     0,     0,     0,     0,     0,     0,
-       0,     0,     0,     0,     0,    28,     0,    29,    15,    16,
-       0,     0,    34,    47,    48,    51,    52,    53,    54,    49,
-      50,    35,    36,    37,    38,     0,     0,    18,    27,     0,
-       0,    55,    22,    24,    30,    17,     0,    23
+       3,     0,     2,     1,     6,    31,    32,    33,     4,     0,
+       7,     0,     8,     0,     9,    10,     0,     0,     0,    12,
+       0,    11,     0,     0,     0,     0,     0,     0,     0,     0,
+      13,     0,     0,    44,    45,    20,    39,    41,    42,    43,
+       0,     0,    40,     0,     0,     0,    25,    26,     0,     0,
+       0,     5,    14,    19,     0,    46,     0,     0,     0,     0,
+      21,     0,     0,     0,     0,     0,     0,     0,     0,     0,
+       0,     0,     0,     0,    28,     0,    29,    15,    16,     0,
+       0,    34,    47,    48,    51,    52,    53,    54,    49,    50,
+      35,    36,    37,    38,     0,     0,    18,     0,    27,     0,
+      55,    22,    24,    30,    17,     0,    23
 };
 
 /* YYPGOTO[NTERM-NUM].  */
 static const yytype_int8 yypgoto[] =
 {
-     -30,   -30,    73,   -30,   -30,   -30,    68,   -30,    55,   -29,
-     -21,     8,    13,   -18
+     -29,   -29,   -29,   -29,   -29,   -29,   -29,    66,    60,   -28,
+     -20,   -29,     9,   -25
 };
 
 /* YYDEFGOTO[NTERM-NUM].  */
 static const yytype_int8 yydefgoto[] =
 {
-       0,     5,     6,     7,     8,    14,    15,    16,    30,    31,
-      43,    76,    33,    77
+       0,     1,     2,     8,     9,    13,    14,    15,    29,    30,
+      42,    75,    32,    43
 };
 
 /* YYTABLE[YYPACT[STATE-NUM]] -- What to do in state STATE-NUM.  If
@@ -660,95 +666,95 @@ static const yytype_int8 yydefgoto[] =
    number is the opposite.  If YYTABLE_NINF, syntax error.  */
 static const yytype_int8 yytable[] =
 {
-      32,    53,    49,    10,    79,    44,    80,    12,    32,    32,
-       2,     3,     4,     9,     1,     2,     3,     4,    50,    13,
-       9,    18,    53,    56,    58,    19,    17,    72,    73,    20,
-      32,    74,    17,    70,    71,    34,    35,    21,    47,    45,
-      48,    83,    84,    36,    85,    86,    87,    88,    89,    90,
-      91,    92,    93,    94,    46,    57,    37,    38,    39,    40,
-      41,    42,   100,   101,    54,    55,   102,   103,    50,   106,
-      81,     2,     3,     4,    32,    32,    98,   107,    23,    24,
-      11,    25,    26,    27,    51,    32,     0,    22,     2,     3,
-       4,    68,    69,    70,    71,    23,    24,    28,    25,    26,
-      27,     2,     3,     4,    29,    52,     0,   104,    23,    24,
-       0,    25,    26,    27,    28,     0,     0,     0,     2,     3,
-       4,    29,    78,    34,    35,     0,     0,    28,     0,     0,
-       0,     0,     0,     0,    29,     0,     0,    59,    60,     0,
-       0,     0,     0,     0,    37,    38,    39,    40,    41,    42,
-      62,    63,    64,    65,    66,    67,    68,    69,    70,    71,
-      59,    60,    62,    63,    64,    65,    82,     0,    68,    69,
-      70,    71,     0,    62,    63,    64,    65,    66,    67,    68,
-      69,    70,    71,    59,    60,     0,     0,     0,     0,    95,
-       0,     0,    34,    35,     0,     0,    62,    63,    64,    65,
-      66,    67,    68,    69,    70,    71,    34,    35,     0,     0,
-       0,     0,    96,    37,    38,    39,    40,    41,    42,    75,
-       0,     0,     0,    59,    60,     0,     0,    37,    38,    39,
-      40,    41,    42,    61,     0,     0,    62,    63,    64,    65,
-      66,    67,    68,    69,    70,    71,    59,    60,     0,     0,
-       0,     0,     0,     0,     0,     0,    97,     0,     0,    62,
-      63,    64,    65,    66,    67,    68,    69,    70,    71,    59,
-      60,     0,     0,     0,     0,     0,     0,     0,     0,     0,
-      99,     0,    62,    63,    64,    65,    66,    67,    68,    69,
-      70,    71,    59,    60,     0,     0,     0,     0,     0,     0,
-       0,     0,   105,    59,     0,    62,    63,    64,    65,    66,
-      67,    68,    69,    70,    71,     0,    62,    63,    64,    65,
-      66,    67,    68,    69,    70,    71,    62,    63,    64,    65,
-      66,    67,    68,    69,    70,    71
+      31,    52,    48,     4,     5,     6,     7,    97,    31,    31,
+       3,    10,     5,     6,     7,    55,    57,    11,    49,    71,
+      72,    16,    52,    73,    76,    98,    12,    16,    17,    78,
+      31,    79,    18,    82,    83,    19,    84,    85,    86,    87,
+      88,    89,    90,    91,    92,    93,    67,    68,    69,    70,
+      56,    69,    70,    20,    99,   100,    61,    62,    63,    64,
+      65,    66,    67,    68,    69,    70,   101,   102,    44,    45,
+      46,    47,   103,    53,    31,    31,    54,   106,    49,     5,
+       6,     7,   105,    80,    21,    31,    22,    23,    50,    24,
+      25,    26,     5,     6,     7,     0,     0,     0,     0,    22,
+      23,     0,    24,    25,    26,    27,     0,     0,     0,     5,
+       6,     7,    28,    51,     0,     0,    22,    23,    27,    24,
+      25,    26,     5,     6,     7,    28,    77,    33,    34,     0,
+      61,    62,    63,    64,     0,    27,    67,    68,    69,    70,
+       0,     0,    28,    58,    59,     0,     0,     0,    36,    37,
+      38,    39,    40,    41,     0,     0,    61,    62,    63,    64,
+      65,    66,    67,    68,    69,    70,    58,    59,     0,     0,
+       0,     0,    81,     0,     0,     0,     0,     0,     0,    61,
+      62,    63,    64,    65,    66,    67,    68,    69,    70,    58,
+      59,     0,     0,     0,     0,    94,     0,     0,    33,    34,
+       0,     0,    61,    62,    63,    64,    65,    66,    67,    68,
+      69,    70,     0,     0,    33,    34,     0,     0,    95,    36,
+      37,    38,    39,    40,    41,    74,    33,    34,     0,     0,
+       0,     0,     0,     0,    35,    36,    37,    38,    39,    40,
+      41,     0,     0,    58,    59,     0,     0,    36,    37,    38,
+      39,    40,    41,    60,     0,     0,    61,    62,    63,    64,
+      65,    66,    67,    68,    69,    70,    58,    59,     0,     0,
+       0,     0,     0,     0,     0,     0,    96,     0,     0,    61,
+      62,    63,    64,    65,    66,    67,    68,    69,    70,    58,
+      59,     0,     0,     0,     0,     0,     0,     0,     0,   104,
+      58,    59,    61,    62,    63,    64,    65,    66,    67,    68,
+      69,    70,    58,    61,    62,    63,    64,    65,    66,    67,
+      68,    69,    70,     0,     0,    61,    62,    63,    64,    65,
+      66,    67,    68,    69,    70
 };
 
 static const yytype_int8 yycheck[] =
 {
-      21,    30,    19,     0,    17,    23,    19,    30,    29,    30,
-       4,     5,     6,     0,     3,     4,     5,     6,    35,    35,
-       7,    36,    51,    41,    42,    18,    13,    45,    46,    30,
-      51,    49,    19,    28,    29,     9,    10,    37,    17,    35,
-      17,    59,    60,    17,    62,    63,    64,    65,    66,    67,
-      68,    69,    70,    71,    35,    42,    30,    31,    32,    33,
-      34,    35,    80,    81,    17,    30,    95,    96,    35,    13,
-      36,     4,     5,     6,    95,    96,    36,   106,    11,    12,
-       7,    14,    15,    16,    29,   106,    -1,    19,     4,     5,
-       6,    26,    27,    28,    29,    11,    12,    30,    14,    15,
-      16,     4,     5,     6,    37,    38,    -1,    99,    11,    12,
-      -1,    14,    15,    16,    30,    -1,    -1,    -1,     4,     5,
-       6,    37,    38,     9,    10,    -1,    -1,    30,    -1,    -1,
-      -1,    -1,    -1,    -1,    37,    -1,    -1,     7,     8,    -1,
-      -1,    -1,    -1,    -1,    30,    31,    32,    33,    34,    35,
-      20,    21,    22,    23,    24,    25,    26,    27,    28,    29,
-       7,     8,    20,    21,    22,    23,    36,    -1,    26,    27,
-      28,    29,    -1,    20,    21,    22,    23,    24,    25,    26,
-      27,    28,    29,     7,     8,    -1,    -1,    -1,    -1,    36,
-      -1,    -1,     9,    10,    -1,    -1,    20,    21,    22,    23,
-      24,    25,    26,    27,    28,    29,     9,    10,    -1,    -1,
-      -1,    -1,    36,    30,    31,    32,    33,    34,    35,    36,
-      -1,    -1,    -1,     7,     8,    -1,    -1,    30,    31,    32,
+      20,    29,    19,     3,     4,     5,     6,    18,    28,    29,
+       0,     2,     4,     5,     6,    40,    41,    30,    35,    44,
+      45,    12,    50,    48,    49,    36,    35,    18,    36,    17,
+      50,    19,    18,    58,    59,    30,    61,    62,    63,    64,
+      65,    66,    67,    68,    69,    70,    26,    27,    28,    29,
+      41,    28,    29,    37,    79,    80,    20,    21,    22,    23,
+      24,    25,    26,    27,    28,    29,    94,    95,    35,    35,
+      17,    17,    97,    17,    94,    95,    30,   105,    35,     4,
+       5,     6,    13,    36,    18,   105,    11,    12,    28,    14,
+      15,    16,     4,     5,     6,    -1,    -1,    -1,    -1,    11,
+      12,    -1,    14,    15,    16,    30,    -1,    -1,    -1,     4,
+       5,     6,    37,    38,    -1,    -1,    11,    12,    30,    14,
+      15,    16,     4,     5,     6,    37,    38,     9,    10,    -1,
+      20,    21,    22,    23,    -1,    30,    26,    27,    28,    29,
+      -1,    -1,    37,     7,     8,    -1,    -1,    -1,    30,    31,
+      32,    33,    34,    35,    -1,    -1,    20,    21,    22,    23,
+      24,    25,    26,    27,    28,    29,     7,     8,    -1,    -1,
+      -1,    -1,    36,    -1,    -1,    -1,    -1,    -1,    -1,    20,
+      21,    22,    23,    24,    25,    26,    27,    28,    29,     7,
+       8,    -1,    -1,    -1,    -1,    36,    -1,    -1,     9,    10,
+      -1,    -1,    20,    21,    22,    23,    24,    25,    26,    27,
+      28,    29,    -1,    -1,     9,    10,    -1,    -1,    36,    30,
+      31,    32,    33,    34,    35,    36,     9,    10,    -1,    -1,
+      -1,    -1,    -1,    -1,    17,    30,    31,    32,    33,    34,
+      35,    -1,    -1,     7,     8,    -1,    -1,    30,    31,    32,
       33,    34,    35,    17,    -1,    -1,    20,    21,    22,    23,
       24,    25,    26,    27,    28,    29,     7,     8,    -1,    -1,
       -1,    -1,    -1,    -1,    -1,    -1,    17,    -1,    -1,    20,
       21,    22,    23,    24,    25,    26,    27,    28,    29,     7,
-       8,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    -1,
-      18,    -1,    20,    21,    22,    23,    24,    25,    26,    27,
-      28,    29,     7,     8,    -1,    -1,    -1,    -1,    -1,    -1,
-      -1,    -1,    17,     7,    -1,    20,    21,    22,    23,    24,
-      25,    26,    27,    28,    29,    -1,    20,    21,    22,    23,
-      24,    25,    26,    27,    28,    29,    20,    21,    22,    23,
-      24,    25,    26,    27,    28,    29
+       8,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    -1,    17,
+       7,     8,    20,    21,    22,    23,    24,    25,    26,    27,
+      28,    29,     7,    20,    21,    22,    23,    24,    25,    26,
+      27,    28,    29,    -1,    -1,    20,    21,    22,    23,    24,
+      25,    26,    27,    28,    29
 };
 
 /* YYSTOS[STATE-NUM] -- The symbol kind of the accessing symbol of
    state STATE-NUM.  */
 static const yytype_int8 yystos[] =
 {
-       0,     3,     4,     5,     6,    42,    43,    44,    45,    53,
-       0,    43,    30,    35,    46,    47,    48,    53,    36,    18,
-      30,    37,    47,    11,    12,    14,    15,    16,    30,    37,
-      49,    50,    51,    53,     9,    10,    17,    30,    31,    32,
-      33,    34,    35,    51,    54,    35,    35,    17,    17,    19,
-      35,    49,    38,    50,    17,    30,    54,    53,    54,     7,
-       8,    17,    20,    21,    22,    23,    24,    25,    26,    27,
-      28,    29,    54,    54,    54,    36,    52,    54,    38,    17,
-      19,    36,    36,    54,    54,    54,    54,    54,    54,    54,
-      54,    54,    54,    54,    54,    36,    36,    17,    36,    18,
-      54,    54,    50,    50,    52,    17,    13,    50
+       0,    42,    43,     0,     3,     4,     5,     6,    44,    45,
+      53,    30,    35,    46,    47,    48,    53,    36,    18,    30,
+      37,    48,    11,    12,    14,    15,    16,    30,    37,    49,
+      50,    51,    53,     9,    10,    17,    30,    31,    32,    33,
+      34,    35,    51,    54,    35,    35,    17,    17,    19,    35,
+      49,    38,    50,    17,    30,    54,    53,    54,     7,     8,
+      17,    20,    21,    22,    23,    24,    25,    26,    27,    28,
+      29,    54,    54,    54,    36,    52,    54,    38,    17,    19,
+      36,    36,    54,    54,    54,    54,    54,    54,    54,    54,
+      54,    54,    54,    54,    36,    36,    17,    18,    36,    54,
+      54,    50,    50,    54,    17,    13,    50
 };
 
 /* YYR1[RULE-NUM] -- Symbol kind of the left-hand side of rule RULE-NUM.  */
@@ -799,7 +805,7 @@ enum { YYENOMEM = -2 };
       }                                                           \
     else                                                          \
       {                                                           \
-        yyerror (YY_("syntax error: cannot back up")); \
+        yyerror (scanner, tree, YY_("syntax error: cannot back up")); \
         YYERROR;                                                  \
       }                                                           \
   while (0)
@@ -832,7 +838,7 @@ do {                                                                      \
     {                                                                     \
       YYFPRINTF (stderr, "%s ", Title);                                   \
       yy_symbol_print (stderr,                                            \
-                  Kind, Value); \
+                  Kind, Value, scanner, tree); \
       YYFPRINTF (stderr, "\n");                                           \
     }                                                                     \
 } while (0)
@@ -844,10 +850,12 @@ do {                                                                      \
 
 static void
 yy_symbol_value_print (FILE *yyo,
-                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+                       yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, yyscan_t scanner, ast::FlatTree &tree)
 {
   FILE *yyoutput = yyo;
   YY_USE (yyoutput);
+  YY_USE (scanner);
+  YY_USE (tree);
   if (!yyvaluep)
     return;
   YY_IGNORE_MAYBE_UNINITIALIZED_BEGIN
@@ -862,12 +870,12 @@ yy_symbol_value_print (FILE *yyo,
 
 static void
 yy_symbol_print (FILE *yyo,
-                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep)
+                 yysymbol_kind_t yykind, YYSTYPE const * const yyvaluep, yyscan_t scanner, ast::FlatTree &tree)
 {
   YYFPRINTF (yyo, "%s %s (",
              yykind < YYNTOKENS ? "token" : "nterm", yysymbol_name (yykind));
 
-  yy_symbol_value_print (yyo, yykind, yyvaluep);
+  yy_symbol_value_print (yyo, yykind, yyvaluep, scanner, tree);
   YYFPRINTF (yyo, ")");
 }
 
@@ -901,7 +909,7 @@ do {                                                            \
 
 static void
 yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
-                 int yyrule)
+                 int yyrule, yyscan_t scanner, ast::FlatTree &tree)
 {
   int yylno = yyrline[yyrule];
   int yynrhs = yyr2[yyrule];
@@ -914,7 +922,7 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
       YYFPRINTF (stderr, "   $%d = ", yyi + 1);
       yy_symbol_print (stderr,
                        YY_ACCESSING_SYMBOL (+yyssp[yyi + 1 - yynrhs]),
-                       &yyvsp[(yyi + 1) - (yynrhs)]);
+                       &yyvsp[(yyi + 1) - (yynrhs)], scanner, tree);
       YYFPRINTF (stderr, "\n");
     }
 }
@@ -922,7 +930,7 @@ yy_reduce_print (yy_state_t *yyssp, YYSTYPE *yyvsp,
 # define YY_REDUCE_PRINT(Rule)          \
 do {                                    \
   if (yydebug)                          \
-    yy_reduce_print (yyssp, yyvsp, Rule); \
+    yy_reduce_print (yyssp, yyvsp, Rule, scanner, tree); \
 } while (0)
 
 /* Nonzero means print parse trace.  It is left uninitialized so that
@@ -963,9 +971,11 @@ int yydebug;
 
 static void
 yydestruct (const char *yymsg,
-            yysymbol_kind_t yykind, YYSTYPE *yyvaluep)
+            yysymbol_kind_t yykind, YYSTYPE *yyvaluep, yyscan_t scanner, ast::FlatTree &tree)
 {
   YY_USE (yyvaluep);
+  YY_USE (scanner);
+  YY_USE (tree);
   if (!yymsg)
     yymsg = "Deleting";
   YY_SYMBOL_PRINT (yymsg, yykind, yyvaluep, yylocationp);
@@ -976,13 +986,6 @@ yydestruct (const char *yymsg,
 }
 
 
-/* Lookahead token kind.  */
-int yychar;
-
-/* The semantic value of the lookahead symbol.  */
-YYSTYPE yylval;
-/* Number of syntax errors so far.  */
-int yynerrs;
 
 
 
@@ -992,8 +995,21 @@ int yynerrs;
 `----------*/
 
 int
-yyparse (void)
+yyparse (yyscan_t scanner, ast::FlatTree &tree)
 {
+/* Lookahead token kind.  */
+int yychar;
+
+
+/* The semantic value of the lookahead symbol.  */
+/* Default value used for initialization, for pacifying older GCCs
+   or non-GCC compilers.  */
+YY_INITIAL_VALUE (static YYSTYPE yyval_default;)
+YYSTYPE yylval YY_INITIAL_VALUE (= yyval_default);
+
+    /* Number of syntax errors so far.  */
+    int yynerrs = 0;
+
     yy_state_fast_t yystate = 0;
     /* Number of tokens to shift before error messages enabled.  */
     int yyerrstatus = 0;
@@ -1146,7 +1162,7 @@ yybackup:
   if (yychar == YYEMPTY)
     {
       YYDPRINTF ((stderr, "Reading a token\n"));
-      yychar = yylex ();
+      yychar = yylex (&yylval, scanner);
     }
 
   if (yychar <= YYEOF)
@@ -1234,331 +1250,331 @@ yyreduce:
   switch (yyn)
     {
   case 2: /* Program: Funcs  */
-#line 67 "parser.y"
-                { program = dynamic_pointer_cast<ast::Funcs>(yyvsp[0]); }
-#line 1240 "parser.tab.c"
+#line 86 "parser.y"
+                { tree.root = yyvsp[0]; }
+#line 1256 "parser.tab.c"
     break;
 
   case 3: /* Funcs: %empty  */
-#line 71 "parser.y"
-                   { yyval = make_shared<ast::Funcs>(); }
-#line 1246 "parser.tab.c"
+#line 90 "parser.y"
+                   { yyval = tree.list(Kind::Funcs); }
+#line 1262 "parser.tab.c"
     break;
 
-  case 4: /* Funcs: FuncDecl Funcs  */
-#line 72 "parser.y"
-                     { yyval = dynamic_pointer_cast<ast::Funcs>(yyvsp[0]); dynamic_pointer_cast<ast::Funcs>(yyval)->push_front(dynamic_pointer_cast<ast::FuncDecl>(yyvsp[-1])); }
-#line 1252 "parser.tab.c"
+  case 4: /* Funcs: Funcs FuncDecl  */
+#line 91 "parser.y"
+                     { yyval = yyvsp[-1]; tree.push_back(yyval, yyvsp[0]); }
+#line 1268 "parser.tab.c"
     break;
 
   case 5: /* FuncDecl: RetType ID LPAREN Formals RPAREN LBRACE Statements RBRACE  */
-#line 76 "parser.y"
-    { yyval = make_shared<ast::FuncDecl>(dynamic_pointer_cast<ast::ID>(yyvsp[-6]), dynamic_pointer_cast<ast::Type>(yyvsp[-7]), dynamic_pointer_cast<ast::Formals>(yyvsp[-4]), dynamic_pointer_cast<ast::Statements>(yyvsp[-1])); }
-#line 1258 "parser.tab.c"
+#line 94 "parser.y"
+                                                                    { yyval = tree.node(Kind::FuncDecl, yyvsp[-6], {yyvsp[-7], yyvsp[-4], yyvsp[-1]}); }
+#line 1274 "parser.tab.c"
     break;
 
   case 6: /* RetType: VOID  */
-#line 79 "parser.y"
-              { yyval = make_shared<ast::Type>(ast::BuiltInType::VOID); }
-#line 1264 "parser.tab.c"
+#line 97 "parser.y"
+              { yyval = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::VOID); }
+#line 1280 "parser.tab.c"
     break;
 
   case 7: /* RetType: Type  */
-#line 80 "parser.y"
-           { yyval = dynamic_pointer_cast<ast::Type>(yyvsp[0]); }
-#line 1270 "parser.tab.c"
+#line 98 "parser.y"
+           { yyval = yyvsp[0]; }
+#line 1286 "parser.tab.c"
     break;
 
   case 8: /* Formals: %empty  */
-#line 83 "parser.y"
-                     { yyval = make_shared<ast::Formals>(); }
-#line 1276 "parser.tab.c"
+#line 101 "parser.y"
+                     { yyval = tree.list(Kind::Formals); }
+#line 1292 "parser.tab.c"
     break;
 
   case 9: /* Formals: FormalsList  */
-#line 84 "parser.y"
-                  { yyval = dynamic_pointer_cast<ast::Formals>(yyvsp[0]); }
-#line 1282 "parser.tab.c"
+#line 102 "parser.y"
+                  { yyval = yyvsp[0]; }
+#line 1298 "parser.tab.c"
     break;
 
   case 10: /* FormalsList: FormalDecl  */
-#line 87 "parser.y"
-                        { yyval = make_shared<ast::Formals>(dynamic_pointer_cast<ast::Formal>(yyvsp[0])); }
-#line 1288 "parser.tab.c"
+#line 105 "parser.y"
+                        { yyval = tree.list(Kind::Formals); tree.push_back(yyval, yyvsp[0]); }
+#line 1304 "parser.tab.c"
     break;
 
-  case 11: /* FormalsList: FormalDecl COMMA FormalsList  */
-#line 88 "parser.y"
-                                   { yyval = dynamic_pointer_cast<ast::Formals>(yyvsp[0]); dynamic_pointer_cast<ast::Formals>(yyval)->push_front(dynamic_pointer_cast<ast::Formal>(yyvsp[-2])); }
-#line 1294 "parser.tab.c"
+  case 11: /* FormalsList: FormalsList COMMA FormalDecl  */
+#line 106 "parser.y"
+                                   { yyval = yyvsp[-2]; tree.push_back(yyval, yyvsp[0]); }
+#line 1310 "parser.tab.c"
     break;
 
   case 12: /* FormalDecl: Type ID  */
-#line 91 "parser.y"
-                    { yyval = make_shared<ast::Formal>(dynamic_pointer_cast<ast::ID>(yyvsp[0]), dynamic_pointer_cast<ast::Type>(yyvsp[-1])); }
-#line 1300 "parser.tab.c"
+#line 109 "parser.y"
+                    { yyval = tree.node(Kind::Formal, yyvsp[0], yyvsp[-1]); }
+#line 1316 "parser.tab.c"
     break;
 
   case 13: /* Statements: Statement  */
-#line 94 "parser.y"
-                      { yyval = make_shared<ast::Statements>(dynamic_pointer_cast<ast::Statement>(yyvsp[0])); }
-#line 1306 "parser.tab.c"
+#line 112 "parser.y"
+                      { yyval = tree.list(Kind::Statements); tree.push_back(yyval, yyvsp[0]); }
+#line 1322 "parser.tab.c"
     break;
 
   case 14: /* Statements: Statements Statement  */
-#line 95 "parser.y"
-                           { yyval = dynamic_pointer_cast<ast::Statements>(yyvsp[-1]); dynamic_pointer_cast<ast::Statements>(yyval)->push_back(dynamic_pointer_cast<ast::Statement>(yyvsp[0])); }
-#line 1312 "parser.tab.c"
+#line 113 "parser.y"
+                           { yyval = yyvsp[-1]; tree.push_back(yyval, yyvsp[0]); }
+#line 1328 "parser.tab.c"
     break;
 
   case 15: /* Statement: LBRACE Statements RBRACE  */
-#line 98 "parser.y"
+#line 116 "parser.y"
                                     { yyval = yyvsp[-1]; }
-#line 1318 "parser.tab.c"
+#line 1334 "parser.tab.c"
     break;
 
   case 16: /* Statement: Type ID SC  */
-#line 99 "parser.y"
-                 { yyval = make_shared<ast::VarDecl>(dynamic_pointer_cast<ast::ID>(yyvsp[-1]), dynamic_pointer_cast<ast::Type>(yyvsp[-2])); }
-#line 1324 "parser.tab.c"
+#line 117 "parser.y"
+                 { yyval = tree.node(Kind::VarDecl, yyvsp[-1], {yyvsp[-2], ast::NoNode}); }
+#line 1340 "parser.tab.c"
     break;
 
   case 17: /* Statement: Type ID ASSIGN Exp SC  */
-#line 100 "parser.y"
-                            { yyval = make_shared<ast::VarDecl>(dynamic_pointer_cast<ast::ID>(yyvsp[-3]), dynamic_pointer_cast<ast::Type>(yyvsp[-4]), dynamic_pointer_cast<ast::Exp>(yyvsp[-1])); }
-#line 1330 "parser.tab.c"
+#line 118 "parser.y"
+                            { yyval = tree.node(Kind::VarDecl, yyvsp[-3], {yyvsp[-4], yyvsp[-1]}); }
+#line 1346 "parser.tab.c"
     break;
 
   case 18: /* Statement: ID ASSIGN Exp SC  */
-#line 101 "parser.y"
-                       { yyval = make_shared<ast::Assign>(dynamic_pointer_cast<ast::ID>(yyvsp[-3]), dynamic_pointer_cast<ast::Exp>(yyvsp[-1])); }
-#line 1336 "parser.tab.c"
+#line 119 "parser.y"
+                       { yyval = tree.node(Kind::Assign, yyvsp[-3], yyvsp[-1]); }
+#line 1352 "parser.tab.c"
     break;
 
   case 19: /* Statement: Call SC  */
-#line 102 "parser.y"
-              { yyval = dynamic_pointer_cast<ast::Call>(yyvsp[-1]); }
-#line 1342 "parser.tab.c"
+#line 120 "parser.y"
+              { yyval = yyvsp[-1]; }
+#line 1358 "parser.tab.c"
     break;
 
   case 20: /* Statement: RETURN SC  */
-#line 103 "parser.y"
-                { yyval = make_shared<ast::Return>(); }
-#line 1348 "parser.tab.c"
+#line 121 "parser.y"
+                { yyval = tree.node(Kind::Return); }
+#line 1364 "parser.tab.c"
     break;
 
   case 21: /* Statement: RETURN Exp SC  */
-#line 104 "parser.y"
-                    { yyval = make_shared<ast::Return>(dynamic_pointer_cast<ast::Exp>(yyvsp[-1])); }
-#line 1354 "parser.tab.c"
+#line 122 "parser.y"
+                    { yyval = tree.node(Kind::Return, yyvsp[-1]); }
+#line 1370 "parser.tab.c"
     break;
 
   case 22: /* Statement: IF LPAREN Exp RPAREN Statement  */
-#line 105 "parser.y"
-                                                 { yyval = make_shared<ast::If>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Statement>(yyvsp[0])); }
-#line 1360 "parser.tab.c"
+#line 123 "parser.y"
+                                                 { yyval = tree.node(Kind::If, yyvsp[-2], {yyvsp[0], ast::NoNode}); }
+#line 1376 "parser.tab.c"
     break;
 
   case 23: /* Statement: IF LPAREN Exp RPAREN Statement ELSE Statement  */
-#line 106 "parser.y"
-                                                    { yyval = make_shared<ast::If>(dynamic_pointer_cast<ast::Exp>(yyvsp[-4]), dynamic_pointer_cast<ast::Statement>(yyvsp[-2]), dynamic_pointer_cast<ast::Statement>(yyvsp[0])); }
-#line 1366 "parser.tab.c"
+#line 124 "parser.y"
+                                                    { yyval = tree.node(Kind::If, yyvsp[-4], {yyvsp[-2], yyvsp[0]}); }
+#line 1382 "parser.tab.c"
     break;
 
   case 24: /* Statement: WHILE LPAREN Exp RPAREN Statement  */
-#line 107 "parser.y"
-                                        { yyval = make_shared<ast::While>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Statement>(yyvsp[0])); }
-#line 1372 "parser.tab.c"
+#line 125 "parser.y"
+                                        { yyval = tree.node(Kind::While, yyvsp[-2], yyvsp[0]); }
+#line 1388 "parser.tab.c"
     break;
 
   case 25: /* Statement: BREAK SC  */
-#line 108 "parser.y"
-               { yyval = make_shared<ast::Break>(); }
-#line 1378 "parser.tab.c"
+#line 126 "parser.y"
+               { yyval = tree.node(Kind::Break); }
+#line 1394 "parser.tab.c"
     break;
 
   case 26: /* Statement: CONTINUE SC  */
-#line 109 "parser.y"
-                  { yyval = make_shared<ast::Continue>(); }
-#line 1384 "parser.tab.c"
+#line 127 "parser.y"
+                  { yyval = tree.node(Kind::Continue); }
+#line 1400 "parser.tab.c"
     break;
 
   case 27: /* Call: ID LPAREN ExpList RPAREN  */
-#line 112 "parser.y"
-                               { yyval = make_shared<ast::Call>(dynamic_pointer_cast<ast::ID>(yyvsp[-3]), dynamic_pointer_cast<ast::ExpList>(yyvsp[-1])); }
-#line 1390 "parser.tab.c"
+#line 130 "parser.y"
+                               { yyval = tree.node(Kind::Call, yyvsp[-3], yyvsp[-1]); }
+#line 1406 "parser.tab.c"
     break;
 
   case 28: /* Call: ID LPAREN RPAREN  */
-#line 113 "parser.y"
-                       { yyval = make_shared<ast::Call>(dynamic_pointer_cast<ast::ID>(yyvsp[-2])); }
-#line 1396 "parser.tab.c"
+#line 131 "parser.y"
+                       { yyval = tree.node(Kind::Call, yyvsp[-2], tree.list(Kind::ExpList)); }
+#line 1412 "parser.tab.c"
     break;
 
   case 29: /* ExpList: Exp  */
-#line 116 "parser.y"
-             { yyval = make_shared<ast::ExpList>(dynamic_pointer_cast<ast::Exp>(yyvsp[0])); }
-#line 1402 "parser.tab.c"
+#line 134 "parser.y"
+             { yyval = tree.list(Kind::ExpList); tree.push_back(yyval, yyvsp[0]); }
+#line 1418 "parser.tab.c"
     break;
 
-  case 30: /* ExpList: Exp COMMA ExpList  */
-#line 117 "parser.y"
-                        { yyval = dynamic_pointer_cast<ast::ExpList>(yyvsp[0]); dynamic_pointer_cast<ast::ExpList>(yyval)->push_front(dynamic_pointer_cast<ast::Exp>(yyvsp[-2])); }
-#line 1408 "parser.tab.c"
+  case 30: /* ExpList: ExpList COMMA Exp  */
+#line 135 "parser.y"
+                        { yyval = yyvsp[-2]; tree.push_back(yyval, yyvsp[0]); }
+#line 1424 "parser.tab.c"
     break;
 
   case 31: /* Type: INT  */
-#line 120 "parser.y"
-          { yyval = make_shared<ast::Type>(ast::BuiltInType::INT);; }
-#line 1414 "parser.tab.c"
+#line 138 "parser.y"
+          { yyval = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::INT); }
+#line 1430 "parser.tab.c"
     break;
 
   case 32: /* Type: BYTE  */
-#line 121 "parser.y"
-           { yyval = make_shared<ast::Type>(ast::BuiltInType::BYTE);; }
-#line 1420 "parser.tab.c"
+#line 139 "parser.y"
+           { yyval = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::BYTE); }
+#line 1436 "parser.tab.c"
     break;
 
   case 33: /* Type: BOOL  */
-#line 122 "parser.y"
-           { yyval = make_shared<ast::Type>(ast::BuiltInType::BOOL); }
-#line 1426 "parser.tab.c"
+#line 140 "parser.y"
+           { yyval = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::BOOL); }
+#line 1442 "parser.tab.c"
     break;
 
   case 34: /* Exp: LPAREN Exp RPAREN  */
-#line 125 "parser.y"
-                       { yyval = dynamic_pointer_cast<ast::Exp>(yyvsp[-1]); }
-#line 1432 "parser.tab.c"
+#line 143 "parser.y"
+                       { yyval = yyvsp[-1]; }
+#line 1448 "parser.tab.c"
     break;
 
   case 35: /* Exp: Exp ADD Exp  */
-#line 126 "parser.y"
-                  { yyval = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::BinOpType::ADD);}
-#line 1438 "parser.tab.c"
+#line 144 "parser.y"
+                  { yyval = tree.node(Kind::BinOp, yyvsp[-2], yyvsp[0], ast::BinOpType::ADD); }
+#line 1454 "parser.tab.c"
     break;
 
   case 36: /* Exp: Exp SUB Exp  */
-#line 127 "parser.y"
-                  { yyval = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::BinOpType::SUB);}
-#line 1444 "parser.tab.c"
+#line 145 "parser.y"
+                  { yyval = tree.node(Kind::BinOp, yyvsp[-2], yyvsp[0], ast::BinOpType::SUB); }
+#line 1460 "parser.tab.c"
     break;
 
   case 37: /* Exp: Exp MUL Exp  */
-#line 128 "parser.y"
-                  { yyval = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::BinOpType::MUL);}
-#line 1450 "parser.tab.c"
+#line 146 "parser.y"
+                  { yyval = tree.node(Kind::BinOp, yyvsp[-2], yyvsp[0], ast::BinOpType::MUL); }
+#line 1466 "parser.tab.c"
     break;
 
   case 38: /* Exp: Exp DIV Exp  */
-#line 129 "parser.y"
-                  { yyval = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::BinOpType::DIV);}
-#line 1456 "parser.tab.c"
+#line 147 "parser.y"
+                  { yyval = tree.node(Kind::BinOp, yyvsp[-2], yyvsp[0], ast::BinOpType::DIV); }
+#line 1472 "parser.tab.c"
     break;
 
   case 39: /* Exp: ID  */
-#line 130 "parser.y"
-         { yyval = dynamic_pointer_cast<ast::ID>(yyvsp[0]); }
-#line 1462 "parser.tab.c"
+#line 148 "parser.y"
+         { yyval = yyvsp[0]; }
+#line 1478 "parser.tab.c"
     break;
 
   case 40: /* Exp: Call  */
-#line 131 "parser.y"
-           { yyval = dynamic_pointer_cast<ast::Call>(yyvsp[0]); }
-#line 1468 "parser.tab.c"
+#line 149 "parser.y"
+           { yyval = yyvsp[0]; }
+#line 1484 "parser.tab.c"
     break;
 
   case 41: /* Exp: NUM  */
-#line 132 "parser.y"
-          { yyval = dynamic_pointer_cast<ast::Num>(yyvsp[0]); }
-#line 1474 "parser.tab.c"
+#line 150 "parser.y"
+          { yyval = yyvsp[0]; }
+#line 1490 "parser.tab.c"
     break;
 
   case 42: /* Exp: NUM_B  */
-#line 133 "parser.y"
-            { yyval = dynamic_pointer_cast<ast::NumB>(yyvsp[0]); }
-#line 1480 "parser.tab.c"
+#line 151 "parser.y"
+            { yyval = yyvsp[0]; }
+#line 1496 "parser.tab.c"
     break;
 
   case 43: /* Exp: STRING  */
-#line 134 "parser.y"
-             { yyval = dynamic_pointer_cast<ast::String>(yyvsp[0]); }
-#line 1486 "parser.tab.c"
+#line 152 "parser.y"
+             { yyval = yyvsp[0]; }
+#line 1502 "parser.tab.c"
     break;
 
   case 44: /* Exp: TRUE  */
-#line 135 "parser.y"
-           { yyval = make_shared<ast::Bool>(true); }
-#line 1492 "parser.tab.c"
+#line 153 "parser.y"
+           { yyval = tree.literal(Kind::Bool, true); }
+#line 1508 "parser.tab.c"
     break;
 
   case 45: /* Exp: FALSE  */
-#line 136 "parser.y"
-            { yyval = make_shared<ast::Bool>(false); }
-#line 1498 "parser.tab.c"
+#line 154 "parser.y"
+            { yyval = tree.literal(Kind::Bool, false); }
+#line 1514 "parser.tab.c"
     break;
 
   case 46: /* Exp: NOT Exp  */
-#line 137 "parser.y"
-              { yyval = make_shared<ast::Not>(dynamic_pointer_cast<ast::Exp>(yyvsp[0])); }
-#line 1504 "parser.tab.c"
+#line 155 "parser.y"
+              { yyval = tree.node(Kind::Not, yyvsp[0]); }
+#line 1520 "parser.tab.c"
     break;
 
   case 47: /* Exp: Exp AND Exp  */
-#line 138 "parser.y"
-                  { yyval = make_shared<ast::And>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0])); }
-#line 1510 "parser.tab.c"
+#line 156 "parser.y"
+                  { yyval = tree.node(Kind::And, yyvsp[-2], yyvsp[0]); }
+#line 1526 "parser.tab.c"
     break;
 
   case 48: /* Exp: Exp OR Exp  */
-#line 139 "parser.y"
-                 { yyval = make_shared<ast::Or>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0])); }
-#line 1516 "parser.tab.c"
+#line 157 "parser.y"
+                 { yyval = tree.node(Kind::Or, yyvsp[-2], yyvsp[0]); }
+#line 1532 "parser.tab.c"
     break;
 
   case 49: /* Exp: Exp EQ Exp  */
-#line 140 "parser.y"
-                 { yyval = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::RelOpType::EQ); }
-#line 1522 "parser.tab.c"
+#line 158 "parser.y"
+                 { yyval = tree.node(Kind::RelOp, yyvsp[-2], yyvsp[0], ast::RelOpType::EQ); }
+#line 1538 "parser.tab.c"
     break;
 
   case 50: /* Exp: Exp NE Exp  */
-#line 141 "parser.y"
-                 { yyval = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::RelOpType::NE); }
-#line 1528 "parser.tab.c"
+#line 159 "parser.y"
+                 { yyval = tree.node(Kind::RelOp, yyvsp[-2], yyvsp[0], ast::RelOpType::NE); }
+#line 1544 "parser.tab.c"
     break;
 
   case 51: /* Exp: Exp LE Exp  */
-#line 142 "parser.y"
-                 { yyval = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::RelOpType::LE); }
-#line 1534 "parser.tab.c"
+#line 160 "parser.y"
+                 { yyval = tree.node(Kind::RelOp, yyvsp[-2], yyvsp[0], ast::RelOpType::LE); }
+#line 1550 "parser.tab.c"
     break;
 
   case 52: /* Exp: Exp GE Exp  */
-#line 143 "parser.y"
-                 { yyval = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::RelOpType::GE); }
-#line 1540 "parser.tab.c"
+#line 161 "parser.y"
+                 { yyval = tree.node(Kind::RelOp, yyvsp[-2], yyvsp[0], ast::RelOpType::GE); }
+#line 1556 "parser.tab.c"
     break;
 
   case 53: /* Exp: Exp LT Exp  */
-#line 144 "parser.y"
-                 { yyval = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::RelOpType::LT); }
-#line 1546 "parser.tab.c"
+#line 162 "parser.y"
+                 { yyval = tree.node(Kind::RelOp, yyvsp[-2], yyvsp[0], ast::RelOpType::LT); }
+#line 1562 "parser.tab.c"
     break;
 
   case 54: /* Exp: Exp GT Exp  */
-#line 145 "parser.y"
-                 { yyval = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>(yyvsp[-2]), dynamic_pointer_cast<ast::Exp>(yyvsp[0]), ast::RelOpType::GT); }
-#line 1552 "parser.tab.c"
+#line 163 "parser.y"
+                 { yyval = tree.node(Kind::RelOp, yyvsp[-2], yyvsp[0], ast::RelOpType::GT); }
+#line 1568 "parser.tab.c"
     break;
 
   case 55: /* Exp: LPAREN Type RPAREN Exp  */
-#line 146 "parser.y"
-                                        { yyval = make_shared<ast::Cast>(dynamic_pointer_cast<ast::Exp>(yyvsp[0]), dynamic_pointer_cast<ast::Type>(yyvsp[-2])); }
-#line 1558 "parser.tab.c"
+#line 164 "parser.y"
+                                        { yyval = tree.node(Kind::Cast, yyvsp[0], yyvsp[-2]); }
+#line 1574 "parser.tab.c"
     break;
 
 
-#line 1562 "parser.tab.c"
+#line 1578 "parser.tab.c"
 
       default: break;
     }
@@ -1605,7 +1621,7 @@ yyerrlab:
   if (!yyerrstatus)
     {
       ++yynerrs;
-      yyerror (YY_("syntax error"));
+      yyerror (scanner, tree, YY_("syntax error"));
     }
 
   if (yyerrstatus == 3)
@@ -1622,7 +1638,7 @@ yyerrlab:
       else
         {
           yydestruct ("Error: discarding",
-                      yytoken, &yylval);
+                      yytoken, &yylval, scanner, tree);
           yychar = YYEMPTY;
         }
     }
@@ -1678,7 +1694,7 @@ yyerrlab1:
 
 
       yydestruct ("Error: popping",
-                  YY_ACCESSING_SYMBOL (yystate), yyvsp);
+                  YY_ACCESSING_SYMBOL (yystate), yyvsp, scanner, tree);
       YYPOPSTACK (1);
       yystate = *yyssp;
       YY_STACK_PRINT (yyss, yyssp);
@@ -1716,7 +1732,7 @@ yyabortlab:
 | yyexhaustedlab -- YYNOMEM (memory exhaustion) comes here.  |
 `-----------------------------------------------------------*/
 yyexhaustedlab:
-  yyerror (YY_("memory exhausted"));
+  yyerror (scanner, tree, YY_("memory exhausted"));
   yyresult = 2;
   goto yyreturnlab;
 
@@ -1731,7 +1747,7 @@ yyreturnlab:
          user semantic actions for why this is necessary.  */
       yytoken = YYTRANSLATE (yychar);
       yydestruct ("Cleanup: discarding lookahead",
-                  yytoken, &yylval);
+                  yytoken, &yylval, scanner, tree);
     }
   /* Do not reclaim the symbols of the rule whose action triggered
      this YYABORT or YYACCEPT.  */
@@ -1740,7 +1756,7 @@ yyreturnlab:
   while (yyssp != yyss)
     {
       yydestruct ("Cleanup: popping",
-                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp);
+                  YY_ACCESSING_SYMBOL (+*yyssp), yyvsp, scanner, tree);
       YYPOPSTACK (1);
     }
 #ifndef yyoverflow
@@ -1751,10 +1767,10 @@ yyreturnlab:
   return yyresult;
 }
 
-#line 149 "parser.y"
+#line 167 "parser.y"
 
 
 // TODO: Place any additional code here
-void yyerror(const char* msg) {
-    output::errorSyn(yylineno);
+void yyerror(yyscan_t scanner, ast::FlatTree &tree, const char* msg) {
+    output::errorSyn(yyget_lineno(scanner));
 }
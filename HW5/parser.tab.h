@@ -44,6 +44,18 @@
 #if YYDEBUG
 extern int yydebug;
 #endif
+/* "%code requires" blocks.  */
+#line 1 "parser.y"
+
+#include "flat_ast.hpp"
+
+// State of the reentrant scanner
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+
+#line 59 "parser.tab.h"
 
 /* Token kinds.  */
 #ifndef YYTOKENTYPE
@@ -104,10 +116,9 @@ typedef int YYSTYPE;
 #endif
 
 
-extern YYSTYPE yylval;
 
 
-int yyparse (void);
+int yyparse (yyscan_t scanner, ast::FlatTree &tree);
 
 
 #endif /* !YY_YY_PARSER_TAB_H_INCLUDED  */
@@ -1,22 +1,41 @@
-%{
-
-#include "nodes.hpp"
-#include "output.hpp"
+%code requires {
+#include "flat_ast.hpp"
 
-// bison declarations
-extern int yylineno;
-extern int yylex();
+// State of the reentrant scanner
+#ifndef YY_TYPEDEF_YY_SCANNER_T
+#define YY_TYPEDEF_YY_SCANNER_T
+typedef void *yyscan_t;
+#endif
+}
 
-void yyerror(const char*);
+%{
 
-// root of the AST, set by the parser and used by other parts of the compiler
-std::shared_ptr<ast::Node> program;
+#include "flat_ast.hpp"
+#include "output.hpp"
 
 using namespace std;
+using ast::Kind;
 
 // TODO: Place any additional declarations here
 %}
 
+%code {
+// The stacks of the parser start small and double whenever the program nests deeper (YYSTYPE is trivial,
+// so bison may move them): how deep a program may nest is only limited by memory.
+#define YYMAXDEPTH (1 << 28)
+
+// bison declarations
+int yylex(YYSTYPE *yylval, yyscan_t scanner);
+int yyget_lineno(yyscan_t scanner);
+
+void yyerror(yyscan_t scanner, ast::FlatTree &tree, const char*);
+}
+
+// A pure parser: everything it uses comes with the call, the scanner and the tree it builds
+%define api.pure full
+%param {yyscan_t scanner}
+%parse-param {ast::FlatTree &tree}
+
 // TODO: Define tokens here
 %token VOID
 %token INT
@@ -64,91 +83,90 @@ using namespace std;
 %%
 
 // While reducing the start variable, set the root of the AST
-Program:  Funcs { program = dynamic_pointer_cast<ast::Funcs>($1); }
+Program:  Funcs { tree.root = $1; }
 ;
 
 // TODO: Define grammar here
-Funcs: /* empty */ { $$ = make_shared<ast::Funcs>(); }
-    | FuncDecl Funcs { $$ = dynamic_pointer_cast<ast::Funcs>($2); dynamic_pointer_cast<ast::Funcs>($$)->push_front(dynamic_pointer_cast<ast::FuncDecl>($1)); }
+Funcs: /* empty */ { $$ = tree.list(Kind::Funcs); }
+    | Funcs FuncDecl { $$ = $1; tree.push_back($$, $2); }
 ;
 
-FuncDecl: RetType ID LPAREN Formals RPAREN LBRACE Statements RBRACE
-    { $$ = make_shared<ast::FuncDecl>(dynamic_pointer_cast<ast::ID>($2), dynamic_pointer_cast<ast::Type>($1), dynamic_pointer_cast<ast::Formals>($4), dynamic_pointer_cast<ast::Statements>($7)); }
+FuncDecl: RetType ID LPAREN Formals RPAREN LBRACE Statements RBRACE { $$ = tree.node(Kind::FuncDecl, $2, {$1, $4, $7}); }
 ;
 
-RetType: VOID { $$ = make_shared<ast::Type>(ast::BuiltInType::VOID); }
-    | Type { $$ = dynamic_pointer_cast<ast::Type>($1); }
+RetType: VOID { $$ = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::VOID); }
+    | Type { $$ = $1; }
 ;
 
-Formals: /* empty */ { $$ = make_shared<ast::Formals>(); }
-    | FormalsList { $$ = dynamic_pointer_cast<ast::Formals>($1); }
+Formals: /* empty */ { $$ = tree.list(Kind::Formals); }
+    | FormalsList { $$ = $1; }
 ;
 
-FormalsList: FormalDecl { $$ = make_shared<ast::Formals>(dynamic_pointer_cast<ast::Formal>($1)); }
-    | FormalDecl COMMA FormalsList { $$ = dynamic_pointer_cast<ast::Formals>($3); dynamic_pointer_cast<ast::Formals>($$)->push_front(dynamic_pointer_cast<ast::Formal>($1)); }
+FormalsList: FormalDecl { $$ = tree.list(Kind::Formals); tree.push_back($$, $1); }
+    | FormalsList COMMA FormalDecl { $$ = $1; tree.push_back($$, $3); }
 ;
 
-FormalDecl: Type ID { $$ = make_shared<ast::Formal>(dynamic_pointer_cast<ast::ID>($2), dynamic_pointer_cast<ast::Type>($1)); }
+FormalDecl: Type ID { $$ = tree.node(Kind::Formal, $2, $1); }
 ;
 
-Statements: Statement { $$ = make_shared<ast::Statements>(dynamic_pointer_cast<ast::Statement>($1)); }
-    | Statements Statement { $$ = dynamic_pointer_cast<ast::Statements>($1); dynamic_pointer_cast<ast::Statements>($$)->push_back(dynamic_pointer_cast<ast::Statement>($2)); }
+Statements: Statement { $$ = tree.list(Kind::Statements); tree.push_back($$, $1); }
+    | Statements Statement { $$ = $1; tree.push_back($$, $2); }
 ;
 
 Statement: LBRACE Statements RBRACE { $$ = $2; }
-    | Type ID SC { $$ = make_shared<ast::VarDecl>(dynamic_pointer_cast<ast::ID>($2), dynamic_pointer_cast<ast::Type>($1)); }
-    | Type ID ASSIGN Exp SC { $$ = make_shared<ast::VarDecl>(dynamic_pointer_cast<ast::ID>($2), dynamic_pointer_cast<ast::Type>($1), dynamic_pointer_cast<ast::Exp>($4)); }
-    | ID ASSIGN Exp SC { $$ = make_shared<ast::Assign>(dynamic_pointer_cast<ast::ID>($1), dynamic_pointer_cast<ast::Exp>($3)); }
-    | Call SC { $$ = dynamic_pointer_cast<ast::Call>($1); }
-    | RETURN SC { $$ = make_shared<ast::Return>(); }
-    | RETURN Exp SC { $$ = make_shared<ast::Return>(dynamic_pointer_cast<ast::Exp>($2)); }
-    | IF LPAREN Exp RPAREN Statement %prec NELSE { $$ = make_shared<ast::If>(dynamic_pointer_cast<ast::Exp>($3), dynamic_pointer_cast<ast::Statement>($5)); }
-    | IF LPAREN Exp RPAREN Statement ELSE Statement { $$ = make_shared<ast::If>(dynamic_pointer_cast<ast::Exp>($3), dynamic_pointer_cast<ast::Statement>($5), dynamic_pointer_cast<ast::Statement>($7)); }
-    | WHILE LPAREN Exp RPAREN Statement { $$ = make_shared<ast::While>(dynamic_pointer_cast<ast::Exp>($3), dynamic_pointer_cast<ast::Statement>($5)); }
-    | BREAK SC { $$ = make_shared<ast::Break>(); }
-    | CONTINUE SC { $$ = make_shared<ast::Continue>(); }
+    | Type ID SC { $$ = tree.node(Kind::VarDecl, $2, {$1, ast::NoNode}); }
+    | Type ID ASSIGN Exp SC { $$ = tree.node(Kind::VarDecl, $2, {$1, $4}); }
+    | ID ASSIGN Exp SC { $$ = tree.node(Kind::Assign, $1, $3); }
+    | Call SC { $$ = $1; }
+    | RETURN SC { $$ = tree.node(Kind::Return); }
+    | RETURN Exp SC { $$ = tree.node(Kind::Return, $2); }
+    | IF LPAREN Exp RPAREN Statement %prec NELSE { $$ = tree.node(Kind::If, $3, {$5, ast::NoNode}); }
+    | IF LPAREN Exp RPAREN Statement ELSE Statement { $$ = tree.node(Kind::If, $3, {$5, $7}); }
+    | WHILE LPAREN Exp RPAREN Statement { $$ = tree.node(Kind::While, $3, $5); }
+    | BREAK SC { $$ = tree.node(Kind::Break); }
+    | CONTINUE SC { $$ = tree.node(Kind::Continue); }
 ;
 
-Call: ID LPAREN ExpList RPAREN { $$ = make_shared<ast::Call>(dynamic_pointer_cast<ast::ID>($1), dynamic_pointer_cast<ast::ExpList>($3)); }
-    | ID LPAREN RPAREN { $$ = make_shared<ast::Call>(dynamic_pointer_cast<ast::ID>($1)); }
+Call: ID LPAREN ExpList RPAREN { $$ = tree.node(Kind::Call, $1, $3); }
+    | ID LPAREN RPAREN { $$ = tree.node(Kind::Call, $1, tree.list(Kind::ExpList)); }
 ;
 
-ExpList: Exp { $$ = make_shared<ast::ExpList>(dynamic_pointer_cast<ast::Exp>($1)); }
-    | Exp COMMA ExpList { $$ = dynamic_pointer_cast<ast::ExpList>($3); dynamic_pointer_cast<ast::ExpList>($$)->push_front(dynamic_pointer_cast<ast::Exp>($1)); }
+ExpList: Exp { $$ = tree.list(Kind::ExpList); tree.push_back($$, $1); }
+    | ExpList COMMA Exp { $$ = $1; tree.push_back($$, $3); }
 ;
 
-Type: INT { $$ = make_shared<ast::Type>(ast::BuiltInType::INT);; }
-    | BYTE { $$ = make_shared<ast::Type>(ast::BuiltInType::BYTE);; }
-    | BOOL { $$ = make_shared<ast::Type>(ast::BuiltInType::BOOL); }
+Type: INT { $$ = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::INT); }
+    | BYTE { $$ = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::BYTE); }
+    | BOOL { $$ = tree.node(Kind::Type, ast::NoNode, ast::NoNode, ast::BuiltInType::BOOL); }
 ;
 
-Exp: LPAREN Exp RPAREN { $$ = dynamic_pointer_cast<ast::Exp>($2); }
-    | Exp ADD Exp { $$ = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::BinOpType::ADD);}
-    | Exp SUB Exp { $$ = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::BinOpType::SUB);}
-    | Exp MUL Exp { $$ = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::BinOpType::MUL);}
-    | Exp DIV Exp { $$ = make_shared<ast::BinOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::BinOpType::DIV);}
-    | ID { $$ = dynamic_pointer_cast<ast::ID>($1); }
-    | Call { $$ = dynamic_pointer_cast<ast::Call>($1); }
-    | NUM { $$ = dynamic_pointer_cast<ast::Num>($1); }
-    | NUM_B { $$ = dynamic_pointer_cast<ast::NumB>($1); }
-    | STRING { $$ = dynamic_pointer_cast<ast::String>($1); }
-    | TRUE { $$ = make_shared<ast::Bool>(true); }
-    | FALSE { $$ = make_shared<ast::Bool>(false); }
-    | NOT Exp { $$ = make_shared<ast::Not>(dynamic_pointer_cast<ast::Exp>($2)); }
-    | Exp AND Exp { $$ = make_shared<ast::And>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3)); }
-    | Exp OR Exp { $$ = make_shared<ast::Or>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3)); }
-    | Exp EQ Exp { $$ = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::RelOpType::EQ); }
-    | Exp NE Exp { $$ = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::RelOpType::NE); }
-    | Exp LE Exp { $$ = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::RelOpType::LE); }
-    | Exp GE Exp { $$ = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::RelOpType::GE); }
-    | Exp LT Exp { $$ = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::RelOpType::LT); }
-    | Exp GT Exp { $$ = make_shared<ast::RelOp>(dynamic_pointer_cast<ast::Exp>($1), dynamic_pointer_cast<ast::Exp>($3), ast::RelOpType::GT); }
-    | LPAREN Type RPAREN Exp %prec CAST { $$ = make_shared<ast::Cast>(dynamic_pointer_cast<ast::Exp>($4), dynamic_pointer_cast<ast::Type>($2)); }
+Exp: LPAREN Exp RPAREN { $$ = $2; }
+    | Exp ADD Exp { $$ = tree.node(Kind::BinOp, $1, $3, ast::BinOpType::ADD); }
+    | Exp SUB Exp { $$ = tree.node(Kind::BinOp, $1, $3, ast::BinOpType::SUB); }
+    | Exp MUL Exp { $$ = tree.node(Kind::BinOp, $1, $3, ast::BinOpType::MUL); }
+    | Exp DIV Exp { $$ = tree.node(Kind::BinOp, $1, $3, ast::BinOpType::DIV); }
+    | ID { $$ = $1; }
+    | Call { $$ = $1; }
+    | NUM { $$ = $1; }
+    | NUM_B { $$ = $1; }
+    | STRING { $$ = $1; }
+    | TRUE { $$ = tree.literal(Kind::Bool, true); }
+    | FALSE { $$ = tree.literal(Kind::Bool, false); }
+    | NOT Exp { $$ = tree.node(Kind::Not, $2); }
+    | Exp AND Exp { $$ = tree.node(Kind::And, $1, $3); }
+    | Exp OR Exp { $$ = tree.node(Kind::Or, $1, $3); }
+    | Exp EQ Exp { $$ = tree.node(Kind::RelOp, $1, $3, ast::RelOpType::EQ); }
+    | Exp NE Exp { $$ = tree.node(Kind::RelOp, $1, $3, ast::RelOpType::NE); }
+    | Exp LE Exp { $$ = tree.node(Kind::RelOp, $1, $3, ast::RelOpType::LE); }
+    | Exp GE Exp { $$ = tree.node(Kind::RelOp, $1, $3, ast::RelOpType::GE); }
+    | Exp LT Exp { $$ = tree.node(Kind::RelOp, $1, $3, ast::RelOpType::LT); }
+    | Exp GT Exp { $$ = tree.node(Kind::RelOp, $1, $3, ast::RelOpType::GT); }
+    | LPAREN Type RPAREN Exp %prec CAST { $$ = tree.node(Kind::Cast, $4, $2); }
 ;
 
 %%
 
 // TODO: Place any additional code here
-void yyerror(const char* msg) {
-    output::errorSyn(yylineno);
+void yyerror(yyscan_t scanner, ast::FlatTree &tree, const char* msg) {
+    output::errorSyn(yyget_lineno(scanner));
 }
\ No newline at end of file
@@ -0,0 +1,456 @@
+#include "sema.hpp"
+#include "output.hpp"
+#include <string>
+
+namespace sema {
+
+    using ast::BuiltInType;
+    using ast::Kind;
+    using ast::NodeId;
+    using ast::NoNode;
+    using ast::SymbolId;
+
+    static std::string type_name(BuiltInType type) {
+        switch (type) {
+            case BuiltInType::INT:
+                return "INT";
+            case BuiltInType::BOOL:
+                return "BOOL";
+            case BuiltInType::BYTE:
+                return "BYTE";
+            case BuiltInType::VOID:
+                return "VOID";
+            case BuiltInType::STRING:
+                return "STRING";
+            default:
+                return "UNKNOWN";
+        }
+    }
+
+    static bool is_numeric(BuiltInType type) {
+        return type == BuiltInType::INT || type == BuiltInType::BYTE;
+    }
+
+    // Whether a value of type `from` may be used where `to` is expected: the same type, or a byte as an int
+    static bool assignable(BuiltInType from, BuiltInType to) {
+        return from == to || (from == BuiltInType::BYTE && to == BuiltInType::INT);
+    }
+
+    size_t Annotations::memory() const {
+        size_t bytes = types.capacity() + (refs.capacity() + by_name.capacity()) * sizeof(uint32_t);
+        for (const Signature &signature : functions)
+            bytes += sizeof(Signature) + signature.params.capacity() * sizeof(BuiltInType);
+        return bytes;
+    }
+
+    /* Analyzer class
+     * Walks the tree in the order the HW3 visitor does, with a symbol table of the open scopes
+     */
+    class Analyzer {
+    public:
+        Analyzer(const ast::FlatTree &tree, ast::Interner &symbols, Annotations &annotations)
+                : tree(tree), symbols(symbols), annotations(annotations) {}
+
+        void program() {
+            SymbolId print = symbols.intern("print");
+            SymbolId printi = symbols.intern("printi");
+            SymbolId main = symbols.intern("main");
+            annotations.types.assign(tree.size(), BuiltInType::VOID);
+            annotations.refs.assign(tree.size(), NoNode);
+            annotations.functions.clear();
+            annotations.by_name.assign(symbols.size(), NoNode);
+            innermost.assign(symbols.size(), NoNode);
+
+            // Global scope: every function is declared before any body is checked
+            begin_scope();
+            declare_function(Print, print, BuiltInType::VOID, {BuiltInType::STRING});
+            declare_function(Printi, printi, BuiltInType::VOID, {BuiltInType::INT});
+            std::vector<NodeId> funcs = tree.elements(tree.root);
+            for (NodeId func : funcs) {
+                NodeId id = tree.lhs[func];
+                const uint32_t *children = &tree.extra[tree.rhs[func]];
+                if (innermost[tree.lhs[id]] != NoNode)
+                    output::errorDef(tree.lines[id], symbols.name(tree.lhs[id]));
+
+                std::vector<BuiltInType> params;
+                for (uint32_t cell = tree.lhs[children[1]]; cell != NoNode; cell = tree.extra[cell + 1])
+                    params.push_back(static_cast<BuiltInType>(tree.ops[tree.rhs[tree.extra[cell]]]));
+                declare_function(func, tree.lhs[id], static_cast<BuiltInType>(tree.ops[children[0]]),
+                                 std::move(params));
+                annotations.refs[id] = func;
+            }
+
+            NodeId main_func = innermost[main];
+            if (main_func == NoNode)
+                output::errorMainMissing();
+            const Signature &main_signature = annotations.signature(main_func);
+            if (main_signature.return_type != BuiltInType::VOID || !main_signature.params.empty())
+                output::errorMainMissing();
+
+            for (NodeId func : funcs)
+                function(func);
+            end_scope();
+        }
+
+    private:
+        const ast::FlatTree &tree;
+        ast::Interner &symbols;
+        Annotations &annotations;
+
+        /* Symbol table: the innermost declaration of every name, and what each declaration shadowed */
+        struct Shadowed {
+            SymbolId symbol;
+            NodeId previous;
+        };
+
+        struct Scope {
+            size_t undo_size;
+            int next_offset;
+        };
+
+        std::vector<NodeId> innermost;
+        std::vector<Shadowed> undo_log;
+        std::vector<Scope> scopes;
+        // Offset of the next local variable of the function
+        int next_offset = 0;
+
+        // Innermost loop last
+        std::vector<NodeId> loops;
+        BuiltInType return_type = BuiltInType::VOID;
+
+        void begin_scope() {
+            scopes.push_back({undo_log.size(), next_offset});
+        }
+
+        void end_scope() {
+            Scope scope = scopes.back();
+            scopes.pop_back();
+            for (; undo_log.size() > scope.undo_size; undo_log.pop_back())
+                innermost[undo_log.back().symbol] = undo_log.back().previous;
+            next_offset = scope.next_offset;
+        }
+
+        void bind(SymbolId symbol, NodeId declaration) {
+            undo_log.push_back({symbol, innermost[symbol]});
+            innermost[symbol] = declaration;
+        }
+
+        void declare_function(NodeId func, SymbolId name, BuiltInType return_type, std::vector<BuiltInType> params) {
+            auto index = static_cast<uint32_t>(annotations.functions.size());
+            annotations.functions.push_back({name, return_type, std::move(params)});
+            annotations.by_name[name] = index;
+            if (func != Print && func != Printi) {
+                annotations.types[func] = return_type;
+                annotations.refs[func] = index;
+            }
+            bind(name, func);
+        }
+
+        // A VarDecl or Formal, and its ID
+        void declare_variable(NodeId declaration, NodeId id, BuiltInType type) {
+            annotations.types[declaration] = type;
+            annotations.types[id] = type;
+            annotations.refs[declaration] = next_offset++;
+            annotations.refs[id] = declaration;
+            bind(tree.lhs[id], declaration);
+        }
+
+        bool is_function(NodeId declaration) const {
+            return declaration == Print || declaration == Printi || tree.kinds[declaration] == Kind::FuncDecl;
+        }
+
+        BuiltInType declared_type(NodeId declaration) const {
+            if (declaration == Print || declaration == Printi)
+                return BuiltInType::VOID;
+            return annotations.type(declaration);
+        }
+
+        void function(NodeId func) {
+            const uint32_t *children = &tree.extra[tree.rhs[func]];
+            begin_scope();
+            return_type = static_cast<BuiltInType>(tree.ops[children[0]]);
+
+            // The arguments come first in the frame. They may shadow a function, or each other.
+            for (uint32_t cell = tree.lhs[children[1]]; cell != NoNode; cell = tree.extra[cell + 1]) {
+                NodeId formal = tree.extra[cell];
+                declare_variable(formal, tree.lhs[formal], static_cast<BuiltInType>(tree.ops[tree.rhs[formal]]));
+            }
+
+            walk(children[2]);
+            end_scope();
+        }
+
+        /* Work stack: the statements and expressions being checked, the innermost last. A node is checked
+         * in steps: a step either pushes a child, and the next step of the node runs once the child is
+         * done, or finishes the node and pops it. A finished expression leaves its type in the
+         * annotations. Without recursion, a program may nest as deep as memory allows.
+         */
+        struct Frame {
+            NodeId id;
+            uint32_t step;
+            // The list cell of the current element of a Statements, or argument of a Call
+            uint32_t cell;
+            // The index of the current argument of a Call
+            uint32_t index;
+        };
+
+        std::vector<Frame> work;
+
+        // A literal or an identifier is checked right away, as it would be next: it needs no frame
+        void push(NodeId id) {
+            if (id == NoNode)
+                return;
+            if (tree.kinds[id] <= Kind::ID)
+                leaf(id);
+            else
+                work.push_back({id, 0, NoNode, 0});
+        }
+
+        void pop() {
+            work.pop_back();
+        }
+
+        // Finishes the expression on top of the work stack
+        void done(BuiltInType type) {
+            annotations.types[work.back().id] = type;
+            work.pop_back();
+        }
+
+        // Checks a statement and everything in it
+        void walk(NodeId root) {
+            push(root);
+            while (!work.empty())
+                resume(work.back());
+        }
+
+        // Runs the next step of the node of a frame. A step that pushes a child does it last, after which
+        // the frame may have moved.
+        void resume(Frame &frame) {
+            NodeId id = frame.id;
+            uint32_t lhs = tree.lhs[id], rhs = tree.rhs[id];
+            int line = tree.lines[id];
+            switch (tree.kinds[id]) {
+                case Kind::Statements:
+                    if (frame.step++ == 0) {
+                        begin_scope();
+                        frame.cell = lhs;
+                    } else {
+                        frame.cell = tree.extra[frame.cell + 1];
+                    }
+                    if (frame.cell != NoNode)
+                        return push(tree.extra[frame.cell]);
+                    end_scope();
+                    return pop();
+                case Kind::Break:
+                    if (loops.empty())
+                        output::errorUnexpectedBreak(line);
+                    annotations.refs[id] = loops.back();
+                    return pop();
+                case Kind::Continue:
+                    if (loops.empty())
+                        output::errorUnexpectedContinue(line);
+                    annotations.refs[id] = loops.back();
+                    return pop();
+                case Kind::Return:
+                    if (frame.step++ == 0)
+                        return push(lhs);
+                    if (!assignable(lhs == NoNode ? BuiltInType::VOID : annotations.type(lhs), return_type))
+                        output::errorMismatch(line);
+                    return pop();
+                case Kind::If:
+                    switch (frame.step++) {
+                        case 0:
+                            begin_scope();
+                            return push(lhs);
+                        case 1:
+                            condition(lhs, tree.lines[lhs]);
+                            return push(tree.extra[rhs]);
+                        case 2:
+                            end_scope();
+                            begin_scope();
+                            return push(tree.extra[rhs + 1]);
+                        default:
+                            end_scope();
+                            return pop();
+                    }
+                case Kind::While:
+                    switch (frame.step++) {
+                        case 0:
+                            begin_scope();
+                            return push(lhs);
+                        case 1:
+                            condition(lhs, tree.lines[lhs]);
+                            loops.push_back(id);
+                            begin_scope();
+                            return push(rhs);
+                        default:
+                            end_scope();
+                            loops.pop_back();
+                            end_scope();
+                            return pop();
+                    }
+                case Kind::VarDecl: {
+                    auto type = static_cast<BuiltInType>(tree.ops[tree.extra[rhs]]);
+                    NodeId init = tree.extra[rhs + 1];
+                    if (frame.step++ == 0) {
+                        // No name may be declared twice in the scopes that are open, functions included
+                        if (innermost[tree.lhs[lhs]] != NoNode)
+                            output::errorDef(line, symbols.name(tree.lhs[lhs]));
+                        return push(init);
+                    }
+                    if (init != NoNode && !assignable(annotations.type(init), type))
+                        output::errorMismatch(line);
+                    declare_variable(id, lhs, type);
+                    return pop();
+                }
+                case Kind::Assign:
+                    if (frame.step++ == 0) {
+                        NodeId declaration = innermost[tree.lhs[lhs]];
+                        if (declaration == NoNode)
+                            output::errorUndef(line, symbols.name(tree.lhs[lhs]));
+                        if (is_function(declaration))
+                            output::errorDefAsFunc(line, symbols.name(tree.lhs[lhs]));
+                        annotations.refs[lhs] = declaration;
+                        annotations.types[lhs] = declared_type(declaration);
+                        return push(rhs);
+                    }
+                    if (!assignable(annotations.type(rhs), annotations.type(lhs)))
+                        output::errorMismatch(line);
+                    return pop();
+                case Kind::BinOp:
+                case Kind::RelOp: {
+                    if (frame.step < 2)
+                        return push(frame.step++ == 0 ? lhs : rhs);
+                    BuiltInType left = annotations.type(lhs);
+                    BuiltInType right = annotations.type(rhs);
+                    if (!is_numeric(left) || !is_numeric(right))
+                        output::errorMismatch(line);
+                    if (tree.kinds[id] == Kind::RelOp)
+                        return done(BuiltInType::BOOL);
+                    // The type with the bigger representation
+                    return done((left == BuiltInType::INT || right == BuiltInType::INT) ? BuiltInType::INT
+                                                                                        : BuiltInType::BYTE);
+                }
+                case Kind::Not:
+                    if (frame.step++ == 0)
+                        return push(lhs);
+                    condition(lhs, line);
+                    return done(BuiltInType::BOOL);
+                case Kind::And:
+                case Kind::Or:
+                    switch (frame.step++) {
+                        case 0:
+                            return push(lhs);
+                        case 1:
+                            condition(lhs, line);
+                            return push(rhs);
+                        default:
+                            condition(rhs, line);
+                            return done(BuiltInType::BOOL);
+                    }
+                case Kind::Cast: {
+                    if (frame.step++ == 0)
+                        return push(lhs);
+                    auto target = static_cast<BuiltInType>(tree.ops[rhs]);
+                    annotations.types[rhs] = target;
+                    if (!is_numeric(annotations.type(lhs)) || !is_numeric(target))
+                        output::errorMismatch(line);
+                    return done(target);
+                }
+                case Kind::Call:
+                    return call(frame);
+                default:
+                    return done(BuiltInType::VOID);
+            }
+        }
+
+        // Checks a literal or an identifier: the kinds up to ID
+        void leaf(NodeId id) {
+            uint32_t value = tree.lhs[id];
+            BuiltInType type;
+            switch (tree.kinds[id]) {
+                case Kind::Num:
+                    type = BuiltInType::INT;
+                    break;
+                case Kind::NumB:
+                    if (static_cast<int>(value) > 255)
+                        output::errorByteTooLarge(tree.lines[id], static_cast<int>(value));
+                    type = BuiltInType::BYTE;
+                    break;
+                case Kind::String:
+                    type = BuiltInType::STRING;
+                    break;
+                case Kind::Bool:
+                    type = BuiltInType::BOOL;
+                    break;
+                case Kind::ID: {
+                    NodeId declaration = innermost[value];
+                    if (declaration == NoNode)
+                        output::errorUndef(tree.lines[id], symbols.name(value));
+                    if (is_function(declaration))
+                        output::errorDefAsFunc(tree.lines[id], symbols.name(value));
+                    annotations.refs[id] = declaration;
+                    type = declared_type(declaration);
+                    break;
+                }
+                default:
+                    type = BuiltInType::VOID;
+                    break;
+            }
+            annotations.types[id] = type;
+        }
+
+        // A bool operand of an if, a while, and, or or not, already checked. A non bool operand is
+        // reported at `line`, the line of what it is an operand of.
+        void condition(NodeId id, int line) {
+            if (annotations.type(id) != BuiltInType::BOOL)
+                output::errorMismatch(line);
+        }
+
+        // The function first, then its arguments one by one
+        void call(Frame &frame) {
+            NodeId id = frame.id;
+            NodeId func_id = tree.lhs[id];
+            int line = tree.lines[id];
+            if (frame.step++ == 0) {
+                SymbolId name = tree.lhs[func_id];
+                NodeId declaration = innermost[name];
+                if (declaration == NoNode)
+                    output::errorUndefFunc(line, symbols.name(name));
+                if (!is_function(declaration))
+                    output::errorDefAsVar(line, symbols.name(name));
+                annotations.refs[func_id] = declaration;
+
+                size_t count = 0;
+                for (uint32_t cell = tree.lhs[tree.rhs[id]]; cell != NoNode; cell = tree.extra[cell + 1])
+                    count++;
+                if (count != annotations.signature(declaration).params.size())
+                    prototype_mismatch(line, annotations.signature(declaration));
+                frame.cell = tree.lhs[tree.rhs[id]];
+            } else {
+                const Signature &signature = annotations.signature(annotations.refs[func_id]);
+                if (!assignable(annotations.type(tree.extra[frame.cell]), signature.params[frame.index]))
+                    prototype_mismatch(line, signature);
+                frame.cell = tree.extra[frame.cell + 1];
+                frame.index++;
+            }
+            if (frame.cell != NoNode)
+                return push(tree.extra[frame.cell]);
+
+            BuiltInType return_type = annotations.signature(annotations.refs[func_id]).return_type;
+            annotations.types[func_id] = return_type;
+            done(return_type);
+        }
+
+        [[noreturn]] void prototype_mismatch(int line, const Signature &signature) {
+            std::vector<std::string> expected;
+            for (BuiltInType type : signature.params)
+                expected.push_back(type_name(type));
+            output::errorPrototypeMismatch(line, symbols.name(signature.name), expected);
+        }
+    };
+
+    void analyze(const ast::FlatTree &tree, ast::Interner &symbols, Annotations &annotations) {
+        Analyzer(tree, symbols, annotations).program();
+    }
+}
@@ -0,0 +1,84 @@
+#ifndef SEMA_HPP
+#define SEMA_HPP
+
+#include <cstdint>
+#include <vector>
+#include "flat_ast.hpp"
+#include "interner.hpp"
+
+/* Semantic analysis: checks a parsed program with the rules of HW3, and records what it finds out
+ * about every node next to the tree. The code generator only reads these annotations, it checks nothing.
+ */
+namespace sema {
+
+    // Declarations of the library functions, which have no node
+    constexpr ast::NodeId Print = ast::NoNode - 1;
+    constexpr ast::NodeId Printi = ast::NoNode - 2;
+
+    /* Type of a function */
+    struct Signature {
+        ast::SymbolId name;
+        ast::BuiltInType return_type;
+        std::vector<ast::BuiltInType> params;
+    };
+
+    /* Annotations class
+     * What semantic analysis found out about a FlatTree, in arrays indexed by NodeId like the tree's own.
+     * types holds the type of every expression, and the declared type of every VarDecl, Formal and
+     * FuncDecl (the return type). What refs holds depends on the kind of the node:
+     *   ID                     the declaration it resolves to: a VarDecl, a Formal, a FuncDecl, Print or Printi
+     *   Break, Continue        the While they leave or continue
+     *   VarDecl, Formal        the offset of the variable in the frame of its function
+     *   FuncDecl               the index of its signature in functions
+     * Assign, Call and VarDecl refer to their variable or function through their ID.
+     */
+    class Annotations {
+    public:
+        std::vector<uint8_t> types;
+        std::vector<uint32_t> refs;
+        // print, printi and then the functions of the program, in order
+        std::vector<Signature> functions;
+
+        ast::BuiltInType type(ast::NodeId id) const {
+            return static_cast<ast::BuiltInType>(types[id]);
+        }
+
+        ast::NodeId declaration(ast::NodeId id) const {
+            return refs[id];
+        }
+
+        ast::NodeId loop(ast::NodeId jump) const {
+            return refs[jump];
+        }
+
+        int offset(ast::NodeId declaration) const {
+            return static_cast<int>(refs[declaration]);
+        }
+
+        const Signature &signature(ast::NodeId declaration) const {
+            if (declaration == Print || declaration == Printi)
+                return functions[ast::NoNode - declaration - 1];
+            return functions[refs[declaration]];
+        }
+
+        // The function of that name, nullptr if there is none
+        const Signature *function(ast::SymbolId name) const {
+            return (name < by_name.size() && by_name[name] != ast::NoNode) ? &functions[by_name[name]] : nullptr;
+        }
+
+        // Bytes used by the annotations
+        size_t memory() const;
+
+    private:
+        friend class Analyzer;
+
+        // Index in functions of each function, by its SymbolId
+        std::vector<uint32_t> by_name;
+    };
+
+    // Checks the program and annotates its tree. The first error found (in the order HW3 finds them)
+    // throws output::CompileError.
+    void analyze(const ast::FlatTree &tree, ast::Interner &symbols, Annotations &annotations);
+}
+
+#endif //SEMA_HPP
@@ -0,0 +1,34 @@
+#ifndef SHA256_HPP
+#define SHA256_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+/* Sha256 class
+ * SHA-256 (FIPS 180-4) of a stream of bytes: update() with the bytes, then hex() for the digest.
+ */
+class Sha256 {
+public:
+    Sha256();
+
+    void update(const void *data, size_t len);
+
+    void update(std::string_view data) {
+        update(data.data(), data.size());
+    }
+
+    // The digest as 64 hex digits. Ends the hashing.
+    std::string hex();
+
+private:
+    uint32_t state[8];
+    uint8_t block[64];
+    size_t block_used = 0;
+    uint64_t total = 0;
+
+    void compress(const uint8_t *data);
+};
+
+#endif //SHA256_HPP
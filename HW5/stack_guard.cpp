@@ -0,0 +1,80 @@
+#include "stack_guard.hpp"
+#include <exception>
+#include <memory>
+#include <pthread.h>
+#include <ucontext.h>
+
+namespace ast {
+
+    /* Call running on a stack segment */
+    struct Segment {
+        void (*function)(void *);
+        void *argument;
+        std::exception_ptr error;
+        ucontext_t caller;
+        ucontext_t callee;
+    };
+
+    // The call the thread is switching to
+    static thread_local Segment *starting = nullptr;
+
+    // The last segment the thread left, kept to be used again: a walk going up and down around the end
+    // of a segment does not allocate one each time
+    static thread_local std::unique_ptr<char[]> spare_segment;
+
+    // Where the stack of the thread ends, the lowest address it may grow to
+    static const char *thread_stack_end() {
+        pthread_attr_t attributes;
+        void *address = nullptr;
+        size_t size = 0;
+        if (pthread_getattr_np(pthread_self(), &attributes) == 0) {
+            pthread_attr_getstack(&attributes, &address, &size);
+            pthread_attr_destroy(&attributes);
+        }
+        return static_cast<const char *>(address);
+    }
+
+    static void run_segment() {
+        Segment *segment = starting;
+        try {
+            segment->function(segment->argument);
+        } catch (...) {
+            segment->error = std::current_exception();
+        }
+        // Returning resumes uc_link, the caller
+    }
+
+    void call_with_stack(void (*function)(void *), void *argument) {
+        char marker;
+        if (stack_limit == nullptr) {
+            const char *end = thread_stack_end();
+            // Without a known end the thread's stack is assumed to be of the usual 8 MiB
+            if (end == nullptr)
+                end = &marker - 8 * 1024 * 1024;
+            stack_limit = end + STACK_RED_ZONE;
+        }
+        if (&marker > stack_limit)
+            return function(argument);
+
+        std::unique_ptr<char[]> memory = std::move(spare_segment);
+        if (memory == nullptr)
+            memory.reset(new char[STACK_SEGMENT_SIZE]);
+
+        Segment segment{function, argument, nullptr, {}, {}};
+        getcontext(&segment.callee);
+        segment.callee.uc_stack.ss_sp = memory.get();
+        segment.callee.uc_stack.ss_size = STACK_SEGMENT_SIZE;
+        segment.callee.uc_link = &segment.caller;
+        makecontext(&segment.callee, run_segment, 0);
+
+        const char *limit = stack_limit;
+        stack_limit = memory.get() + STACK_RED_ZONE;
+        starting = &segment;
+        swapcontext(&segment.caller, &segment.callee);
+        stack_limit = limit;
+
+        spare_segment = std::move(memory);
+        if (segment.error)
+            std::rethrow_exception(segment.error);
+    }
+}
@@ -0,0 +1,61 @@
+#ifndef STACK_GUARD_HPP
+#define STACK_GUARD_HPP
+
+#include <cstddef>
+#include <type_traits>
+
+namespace ast {
+
+    /* Stack guard
+     * The walks over the tree are recursive, one call per level of nesting, so a deep enough program would
+     * overflow the stack of the thread. A walk calls ensure_stack() at every level: when the stack is
+     * about to run out, the rest of the walk below that level continues on a new stack segment from the
+     * heap, and comes back to the old stack when it returns. The depth of a walk is then only limited by
+     * memory, and the memory it takes is linear in the depth.
+     */
+
+    // Room left on a stack below which a walk moves to a new segment
+    constexpr size_t STACK_RED_ZONE = 256 * 1024;
+
+    // Size of a new stack segment
+    constexpr size_t STACK_SEGMENT_SIZE = 4 * 1024 * 1024;
+
+    // Lowest address the current stack of the thread may grow to before it moves to a new segment,
+    // nullptr until the thread first checks it
+    inline thread_local const char *stack_limit = nullptr;
+
+    // Calls function(argument) on a new stack segment if the current one is too short (or the thread has
+    // not found out its limit yet), and right here otherwise. An exception thrown by the function is
+    // thrown again on the calling stack.
+    void call_with_stack(void (*function)(void *), void *argument);
+
+    // Whether the stack is about to run out, so a recursive call should go through ensure_stack()
+    inline bool stack_low() {
+        char marker;
+        return stack_limit == nullptr || &marker <= stack_limit;
+    }
+
+    // Calls f() and returns its result, on a new stack segment if the current one is about to run out
+    template<typename F>
+    auto ensure_stack(F &&f) -> decltype(f()) {
+        if (!stack_low())
+            return f();
+
+        using Result = decltype(f());
+        if constexpr (std::is_void<Result>::value) {
+            call_with_stack([](void *p) { (*static_cast<std::remove_reference_t<F> *>(p))(); }, &f);
+        } else {
+            struct Call {
+                std::remove_reference_t<F> &f;
+                Result result;
+            } call{f, Result()};
+            call_with_stack([](void *p) {
+                auto *call = static_cast<Call *>(p);
+                call->result = call->f();
+            }, &call);
+            return call.result;
+        }
+    }
+}
+
+#endif //STACK_GUARD_HPP